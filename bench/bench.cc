@@ -0,0 +1,684 @@
+/*
+ * Copyright [2024] <Copyright Hopsworks AB>
+ *
+ * Author: Zhao Song
+ */
+/*
+ * Benchmark of AggInterpreter over synthetic data.
+ *
+ * Every program of the catalogue runs in its own child process over the
+ * same generated rows, and one JSON object per program is printed to stdout:
+ *
+ *   {"program": "group_a", "rows": 1000000, "groups": 1000, "skew": 0.00,
+ *    "null_fraction": 0.00, "jit": false, "result_groups": 1000,
+ *    "seconds": 0.51, "rows_per_sec": 1960784, "ns_per_row": 510.0,
+ *    "state_bytes": 128000, "peak_rss_kb": 4096}
+ *
+ * With --shared, the programs run together in one SharedScan and a single
+ * object reports all of them, named e.g. "shared:group_a+arith_int".
+ *
+ * With --perf, the object also has "perf_per_row" with the performance
+ * counters that are available, e.g. {"task-clock": 480.2, "instructions":
+ * 2051.7, ...}.
+ *
+ * Only ProcessRec() and Finish(), which merges the partitions after
+ * partitioned aggregation, are timed, as well as merging the spilled groups
+ * back with --mem-budget. The rows are generated and turned into
+ * Records in batches outside of the timed region. "partitioned" tells
+ * whether the group count made the interpreter switch to partitioned
+ * aggregation, see --partition-budget.
+ *
+ * The table has the fixed definition of Record:
+ *   a bigint        group key, Zipf distributed over --groups values
+ *   b double        uniform in [-100, 100)
+ *   c bigint unsigned  uniform in [0, 1000)
+ *   d double        uniform in [-100, 100)
+ *   e varchar(12)   second group key, uniform over 16 values
+ *   f datetime      uniform over 30 days
+ * and every column is NULL with probability --nulls.
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../interpreter.h"
+#include "../shared_scan.h"
+#include "../temporal.h"
+
+struct BenchConfig {
+  uint64_t rows;
+  uint32_t groups;
+  double skew;
+  double nulls;
+  bool jit;
+  bool perf;
+  bool shared;
+  bool sorted;
+  uint64_t mem_budget;
+  uint64_t partition_budget;
+  uint32_t seed;
+};
+
+static const uint32_t kBatchRows = 4096;
+static const uint32_t kVarcharLength = 12;
+static const uint32_t kVarcharValues = 16;
+
+/*
+ * Assembles a program: the header is built from the group by columns and
+ * the result types that were added.
+ */
+class ProgramBuilder {
+ public:
+  ProgramBuilder& GroupBy(uint32_t col, TemporalUnit unit = kUnitNone) {
+    gb_cols_.push_back(static_cast<uint32_t>(unit) << 16 | col);
+    return *this;
+  }
+  ProgramBuilder& Result(DataType type) {
+    agg_types_.push_back(type);
+    return *this;
+  }
+  ProgramBuilder& LoadCol(uint32_t reg, uint32_t col, DataType type,
+                          bool is_unsigned = false) {
+    instrs_.push_back(kOpLoadCol << 26 | RawType(type, is_unsigned) << 21 |
+                      reg << 16 | col);
+    return *this;
+  }
+  ProgramBuilder& LoadConst(uint32_t reg, DataType type, uint64_t value) {
+    instrs_.push_back(kOpLoadConst << 26 | RawType(type, false) << 21 |
+                      reg << 16);
+    instrs_.push_back(static_cast<uint32_t>(value));
+    instrs_.push_back(static_cast<uint32_t>(value >> 32));
+    return *this;
+  }
+  // Arithmetic and comparisons, the result is stored in reg1
+  ProgramBuilder& Op(InterpreterOp op, uint32_t reg1, uint32_t reg2) {
+    instrs_.push_back(op << 26 | reg1 << 12 | reg2 << 8);
+    return *this;
+  }
+  ProgramBuilder& Agg(InterpreterOp op, uint32_t reg, uint32_t agg_index) {
+    DataType type = agg_index < agg_types_.size() ?
+                    agg_types_[agg_index] : static_cast<DataType>(kTypeUnknown);
+    instrs_.push_back(op << 26 | RawType(type, false) << 21 | reg << 16 |
+                      agg_index);
+    return *this;
+  }
+
+  std::vector<uint32_t> Build() const {
+    std::vector<uint32_t> prog;
+    uint32_t len = 2 + gb_cols_.size() + agg_types_.size() + instrs_.size();
+    prog.push_back(0x0721 << 16 | len);
+    prog.push_back(static_cast<uint32_t>(gb_cols_.size()) << 16 |
+                   static_cast<uint32_t>(agg_types_.size()));
+    prog.insert(prog.end(), gb_cols_.begin(), gb_cols_.end());
+    prog.insert(prog.end(), agg_types_.begin(), agg_types_.end());
+    prog.insert(prog.end(), instrs_.begin(), instrs_.end());
+    return prog;
+  }
+
+ private:
+  std::vector<uint32_t> gb_cols_;
+  std::vector<uint32_t> agg_types_;
+  std::vector<uint32_t> instrs_;
+
+  static uint32_t RawType(DataType type, bool is_unsigned) {
+    return (is_unsigned ? 0x10 : 0) | (type & 0x0F);
+  }
+};
+
+enum BenchColumn {
+  kColA = 0,
+  kColB,
+  kColC,
+  kColD,
+  kColE,
+  kColF
+};
+
+struct BenchProgram {
+  const char* name;
+  const char* sql;
+  std::vector<uint32_t> prog;
+};
+
+static std::vector<BenchProgram> Catalogue() {
+  std::vector<BenchProgram> programs;
+
+  programs.push_back({"global_agg",
+      "select count(a), sum(a), sum(b), min(d), max(d) from t",
+      ProgramBuilder()
+        .Result(kTypeBigInt).Result(kTypeBigInt).Result(kTypeDouble)
+        .Result(kTypeDouble).Result(kTypeDouble)
+        .LoadCol(kReg1, kColA, kTypeBigInt)
+        .Agg(kOpCount, kReg1, 0)
+        .Agg(kOpSum, kReg1, 1)
+        .LoadCol(kReg2, kColB, kTypeDouble)
+        .Agg(kOpSum, kReg2, 2)
+        .LoadCol(kReg3, kColD, kTypeDouble)
+        .Agg(kOpMin, kReg3, 3)
+        .Agg(kOpMax, kReg3, 4)
+        .Build()});
+
+  programs.push_back({"group_a",
+      "select count(b), sum(b), max(d) from t group by a",
+      ProgramBuilder()
+        .GroupBy(kColA)
+        .Result(kTypeBigInt).Result(kTypeDouble).Result(kTypeDouble)
+        .LoadCol(kReg1, kColB, kTypeDouble)
+        .Agg(kOpCount, kReg1, 0)
+        .Agg(kOpSum, kReg1, 1)
+        .LoadCol(kReg2, kColD, kTypeDouble)
+        .Agg(kOpMax, kReg2, 2)
+        .Build()});
+
+  programs.push_back({"group_a_e",
+      "select count(b), sum(c) from t group by a, e",
+      ProgramBuilder()
+        .GroupBy(kColA).GroupBy(kColE)
+        .Result(kTypeBigInt).Result(kTypeBigInt)
+        .LoadCol(kReg1, kColB, kTypeDouble)
+        .Agg(kOpCount, kReg1, 0)
+        .LoadCol(kReg2, kColC, kTypeBigInt, true)
+        .Agg(kOpSum, kReg2, 1)
+        .Build()});
+
+  programs.push_back({"arith_int",
+      "select sum(a*c+c), max(a+c) from t group by a",
+      ProgramBuilder()
+        .GroupBy(kColA)
+        .Result(kTypeBigInt).Result(kTypeBigInt)
+        .LoadCol(kReg1, kColA, kTypeBigInt)
+        .LoadCol(kReg2, kColC, kTypeBigInt, true)
+        .Op(kOpMul, kReg1, kReg2)
+        .Op(kOpPlus, kReg1, kReg2)
+        .Agg(kOpSum, kReg1, 0)
+        .LoadCol(kReg1, kColA, kTypeBigInt)
+        .Op(kOpPlus, kReg1, kReg2)
+        .Agg(kOpMax, kReg1, 1)
+        .Build()});
+
+  programs.push_back({"arith_double",
+      "select sum(b*d+b), min(b/d), max((b-d)*d) from t group by a",
+      ProgramBuilder()
+        .GroupBy(kColA)
+        .Result(kTypeDouble).Result(kTypeDouble).Result(kTypeDouble)
+        .LoadCol(kReg1, kColB, kTypeDouble)
+        .LoadCol(kReg2, kColD, kTypeDouble)
+        .Op(kOpMul, kReg1, kReg2)
+        .LoadCol(kReg3, kColB, kTypeDouble)
+        .Op(kOpPlus, kReg1, kReg3)
+        .Agg(kOpSum, kReg1, 0)
+        .Op(kOpDiv, kReg3, kReg2)
+        .Agg(kOpMin, kReg3, 1)
+        .LoadCol(kReg1, kColB, kTypeDouble)
+        .Op(kOpMinus, kReg1, kReg2)
+        .Op(kOpMul, kReg1, kReg2)
+        .Agg(kOpMax, kReg1, 2)
+        .Build()});
+
+  programs.push_back({"arith_mixed",
+      "select count(a), sum(a/b+c*d), max((a+b)*c/d), min(b%c-d), "
+      "sum(a+c), count(d/c) from t group by a",
+      ProgramBuilder()
+        .GroupBy(kColA)
+        .Result(kTypeBigInt).Result(kTypeDouble).Result(kTypeDouble)
+        .Result(kTypeDouble).Result(kTypeBigInt).Result(kTypeBigInt)
+        .LoadCol(kReg1, kColA, kTypeBigInt)
+        .Agg(kOpCount, kReg1, 0)
+        .LoadCol(kReg1, kColA, kTypeBigInt)
+        .LoadCol(kReg2, kColB, kTypeDouble)
+        .Op(kOpDiv, kReg1, kReg2)
+        .LoadCol(kReg2, kColC, kTypeBigInt, true)
+        .LoadCol(kReg3, kColD, kTypeDouble)
+        .Op(kOpMul, kReg2, kReg3)
+        .Op(kOpPlus, kReg1, kReg2)
+        .Agg(kOpSum, kReg1, 1)
+        .LoadCol(kReg1, kColA, kTypeBigInt)
+        .LoadCol(kReg2, kColB, kTypeDouble)
+        .Op(kOpPlus, kReg1, kReg2)
+        .LoadCol(kReg2, kColC, kTypeBigInt, true)
+        .Op(kOpMul, kReg1, kReg2)
+        .LoadCol(kReg2, kColD, kTypeDouble)
+        .Op(kOpDiv, kReg1, kReg2)
+        .Agg(kOpMax, kReg1, 2)
+        .LoadCol(kReg1, kColB, kTypeDouble)
+        .LoadCol(kReg2, kColC, kTypeBigInt, true)
+        .Op(kOpMod, kReg1, kReg2)
+        .LoadCol(kReg2, kColD, kTypeDouble)
+        .Op(kOpMinus, kReg1, kReg2)
+        .Agg(kOpMin, kReg1, 3)
+        .LoadCol(kReg1, kColA, kTypeBigInt)
+        .LoadCol(kReg2, kColC, kTypeBigInt, true)
+        .Op(kOpPlus, kReg1, kReg2)
+        .Agg(kOpSum, kReg1, 4)
+        .LoadCol(kReg1, kColD, kTypeDouble)
+        .LoadCol(kReg2, kColC, kTypeBigInt, true)
+        .Op(kOpDiv, kReg1, kReg2)
+        .Agg(kOpCount, kReg1, 5)
+        .Build()});
+
+  DatetimeParts parts{2024, 1, 15, 0, 0, 0, 0};
+  programs.push_back({"time_hour",
+      "select count(f), min(f), max(f), sum(f >= '2024-01-15') from t "
+      "group by hour(f)",
+      ProgramBuilder()
+        .GroupBy(kColF, kUnitHour)
+        .Result(kTypeBigInt).Result(kTypeDatetime).Result(kTypeDatetime)
+        .Result(kTypeBigInt)
+        .LoadCol(kReg1, kColF, kTypeDatetime)
+        .Agg(kOpCount, kReg1, 0)
+        .Agg(kOpMin, kReg1, 1)
+        .Agg(kOpMax, kReg1, 2)
+        .LoadConst(kReg2, kTypeDate, PackDatetime(parts))
+        .Op(kOpGe, kReg1, kReg2)
+        .Agg(kOpSum, kReg1, 3)
+        .Build()});
+
+  return programs;
+}
+
+/*
+ * Generates the rows. The group key follows a Zipf distribution with
+ * exponent skew over [0, groups), where skew 0 is uniform, or with --sorted
+ * ascends with equally many rows per key and is never NULL.
+ */
+class DataGenerator {
+ public:
+  explicit DataGenerator(const BenchConfig& config)
+    : config_(config), row_(0), rng_(config.seed), uniform_(0.0, 1.0) {
+    if (config.skew > 0) {
+      cdf_.resize(config.groups);
+      double sum = 0;
+      for (uint32_t i = 0; i < config.groups; i++) {
+        sum += 1.0 / std::pow(i + 1, config.skew);
+        cdf_[i] = sum;
+      }
+      for (uint32_t i = 0; i < config.groups; i++) {
+        cdf_[i] /= sum;
+      }
+    }
+    for (uint32_t i = 0; i < kVarcharValues; i++) {
+      snprintf(varchars_[i], sizeof(varchars_[i]), "key-%07u", i);
+    }
+  }
+
+  Record* Next() {
+    int64_t a = NextKey();
+    double b = uniform_(rng_) * 200 - 100;
+    uint64_t c = rng_() % 1000;
+    double d = uniform_(rng_) * 200 - 100;
+    const char* e = varchars_[rng_() % kVarcharValues];
+    DatetimeParts parts;
+    UnpackTimestamp(kBaseTimestamp +
+                    static_cast<int64_t>(rng_() % (30 * 86400ULL)) * 1000000,
+                    &parts);
+    uint32_t null_bits = 0;
+    if (config_.nulls > 0) {
+      for (uint32_t i = 0; i < Record::n_cols; i++) {
+        if (uniform_(rng_) < config_.nulls) {
+          null_bits |= 1 << i;
+        }
+      }
+      if (config_.sorted) {
+        null_bits &= ~(1U << kColA);
+      }
+    }
+    return new Record(a, b, c, d, e, kVarcharLength, PackDatetime(parts),
+                      null_bits);
+  }
+
+ private:
+  static const int64_t kBaseTimestamp = 1704067200LL * 1000000;  // 2024-01-01
+  const BenchConfig& config_;
+  uint64_t row_;
+  std::mt19937_64 rng_;
+  std::uniform_real_distribution<double> uniform_;
+  std::vector<double> cdf_;
+  char varchars_[kVarcharValues][kVarcharLength + 1];
+
+  int64_t NextKey() {
+    if (config_.sorted) {
+      return row_++ * config_.groups / config_.rows;
+    }
+    if (cdf_.empty()) {
+      return rng_() % config_.groups;
+    }
+    return std::lower_bound(cdf_.begin(), cdf_.end(), uniform_(rng_)) -
+           cdf_.begin();
+  }
+};
+
+/*
+ * Generate the rows in batches and pass them to process, timing only the
+ * calls to process. Return the seconds spent.
+ */
+template <class Process>
+static double TimeRows(const char* name, const BenchConfig& config,
+                       Process process) {
+  DataGenerator generator(config);
+  std::vector<Record*> batch;
+  std::chrono::steady_clock::duration elapsed(0);
+  uint64_t done = 0;
+  while (done < config.rows) {
+    uint64_t n = std::min<uint64_t>(kBatchRows, config.rows - done);
+    batch.clear();
+    for (uint64_t i = 0; i < n; i++) {
+      batch.push_back(generator.Next());
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (!process(batch.data(), n)) {
+      fprintf(stderr, "%s: failed to process a row in %lu..%lu\n",
+              name, done, done + n - 1);
+      exit(1);
+    }
+    elapsed += std::chrono::steady_clock::now() - start;
+    for (uint64_t i = 0; i < n; i++) {
+      delete batch[i];
+    }
+    done += n;
+  }
+  return std::chrono::duration<double>(elapsed).count();
+}
+
+static void PrintResult(const char* name, const BenchConfig& config,
+                        bool jit, uint64_t result_groups, bool spilled,
+                        bool partitioned, double seconds, uint64_t state_bytes,
+                        const PerfCounters* perf, const PerfValues& perf_values,
+                        uint64_t perf_rows) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  printf("{\"program\": \"%s\", \"rows\": %lu, \"groups\": %u, "
+         "\"skew\": %.2f, \"null_fraction\": %.2f, \"jit\": %s, "
+         "\"result_groups\": %lu, \"spilled\": %s, \"partitioned\": %s, "
+         "\"seconds\": %.6f, \"rows_per_sec\": %.0f, \"ns_per_row\": %.2f, "
+         "\"state_bytes\": %lu, \"peak_rss_kb\": %ld",
+         name, config.rows, config.groups, config.skew, config.nulls,
+         jit ? "true" : "false", result_groups, spilled ? "true" : "false",
+         partitioned ? "true" : "false", seconds,
+         seconds > 0 ? config.rows / seconds : 0.0,
+         config.rows ? seconds * 1e9 / config.rows : 0.0,
+         state_bytes, usage.ru_maxrss);
+  if (perf != nullptr) {
+    const char* sep = "";
+    printf(", \"perf_per_row\": {");
+    for (uint32_t i = 0; i < kPerfEventTotal; i++) {
+      PerfEvent event = static_cast<PerfEvent>(i);
+      if (perf->available(event)) {
+        printf("%s\"%s\": %.2f", sep, PerfCounters::EventName(event),
+               perf_rows ? static_cast<double>(perf_values.value[i]) /
+                           perf_rows : 0.0);
+        sep = ", ";
+      }
+    }
+    printf("}");
+  }
+  printf("}\n");
+  fflush(stdout);
+}
+
+static void InitOrExit(const BenchProgram& program, AggInterpreter* agg) {
+  if (!agg->Init()) {
+    fprintf(stderr, "%s: %s\n", program.name, agg->init_error());
+    exit(1);
+  }
+}
+
+// With --sorted, only the programs grouping by a alone get sorted input.
+static bool GroupsByA(const BenchProgram& program) {
+  return program.prog[1] >> 16 == 1 && program.prog[2] == kColA;
+}
+
+static void DiscardGroup(void* /* arg */, const char* /* key */,
+                         uint32_t /* key_len */,
+                         const AggResItem* /* results */,
+                         uint32_t /* n_results */) {
+}
+
+static void SetUpOrExit(const BenchProgram& program,
+                        const BenchConfig& config, AggInterpreter* agg) {
+  agg->set_use_jit(config.jit);
+  agg->set_partition_budget(config.partition_budget);
+  if (config.sorted) {
+    agg->set_sorted_input(DiscardGroup, nullptr);
+  }
+  InitOrExit(program, agg);
+}
+
+// Return the seconds Finish() and merging the spilled groups took
+static double FinishOrExit(const char* name, AggInterpreter* agg) {
+  auto start = std::chrono::steady_clock::now();
+  if (!agg->Finish() ||
+      (agg->spilled() && !agg->ForEachGroup(DiscardGroup, nullptr))) {
+    fprintf(stderr, "%s: failed to merge the partitions\n", name);
+    exit(1);
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+static void RunProgram(const BenchProgram& program,
+                       const BenchConfig& config) {
+  AggInterpreter agg(program.prog.data(), program.prog.size(),
+                     config.mem_budget);
+  agg.set_collect_perf(config.perf);
+  SetUpOrExit(program, config, &agg);
+
+  double seconds = TimeRows(program.name, config,
+                            [&agg](Record* const* recs, uint32_t n) {
+                              return agg.ProcessRecs(recs, n);
+                            });
+  seconds += FinishOrExit(program.name, &agg);
+  PrintResult(program.name, config, agg.jit_compiled(), agg.n_groups(),
+              agg.spilled(), agg.partitioned(), seconds, agg.mem_used(),
+              agg.perf(), agg.perf_values(), agg.perf_rows());
+}
+
+/*
+ * Run the programs together in one SharedScan, which loads the columns of
+ * each batch once for all of them, and print one result for all of them.
+ */
+static void RunShared(const std::vector<const BenchProgram*>& programs,
+                      const BenchConfig& config) {
+  std::string name = "shared:";
+  std::vector<AggInterpreter*> aggs;
+  SharedScan scan;
+  for (const BenchProgram* program : programs) {
+    name += (aggs.empty() ? "" : "+") + std::string(program->name);
+    AggInterpreter* agg = new AggInterpreter(program->prog.data(),
+                                             program->prog.size(),
+                                             config.mem_budget);
+    SetUpOrExit(*program, config, agg);
+    aggs.push_back(agg);
+    scan.Attach(agg);
+  }
+
+  // The counters cover the whole scan rather than each interpreter.
+  PerfCounters perf;
+  PerfValues perf_values;
+  if (config.perf) {
+    perf.Open();
+  }
+  double seconds = TimeRows(name.c_str(), config,
+                            [&](Record* const* recs, uint32_t n) {
+                              PerfValues start, end;
+                              perf.Read(&start);
+                              bool ok = scan.ProcessRecs(recs, n);
+                              perf.Read(&end);
+                              perf_values += end - start;
+                              return ok;
+                            });
+
+  bool jit = true;
+  bool spilled = false;
+  bool partitioned = false;
+  uint64_t result_groups = 0;
+  uint64_t state_bytes = 0;
+  for (AggInterpreter* agg : aggs) {
+    seconds += FinishOrExit(name.c_str(), agg);
+    jit &= agg->jit_compiled();
+    spilled |= agg->spilled();
+    partitioned |= agg->partitioned();
+    result_groups += agg->n_groups();
+    state_bytes += agg->mem_used();
+    delete agg;
+  }
+  PrintResult(name.c_str(), config, jit, result_groups, spilled, partitioned,
+              seconds, state_bytes, config.perf ? &perf : nullptr, perf_values,
+              config.rows);
+}
+
+static void Usage(const char* argv0) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  --rows N        rows per program (default 1000000)\n"
+          "  --groups N      distinct values of the group key (default 1000)\n"
+          "  --skew S        Zipf exponent of the group key, 0 is uniform "
+          "(default 0)\n"
+          "  --nulls F       probability of each column being NULL "
+          "(default 0)\n"
+          "  --jit           compile the programs\n"
+          "  --perf          report performance counters per row\n"
+          "  --shared        run the programs together in one shared scan\n"
+          "  --sorted        generate rows sorted on a, and run the programs\n"
+          "                  that group by a alone in sorted-input mode\n"
+          "  --mem-budget N  spill the groups above N bytes (default 0, "
+          "unlimited)\n"
+          "  --partition-budget N\n"
+          "                  switch to partitioned aggregation when the "
+          "groups\n"
+          "                  take more than N bytes (default %lu, 0 never)\n"
+          "  --seed N        random seed (default 1)\n"
+          "  --program NAME  run only NAME, may be repeated\n"
+          "  --list          list the programs and exit\n",
+          argv0, kPartitionBudget);
+}
+
+int main(int argc, char** argv) {
+  BenchConfig config{1000000, 1000, 0.0, 0.0, false, false, false, false, 0,
+                     kPartitionBudget, 1};
+  std::vector<std::string> only;
+  bool list = false;
+
+  static const struct option options[] = {
+    {"rows", required_argument, nullptr, 'r'},
+    {"groups", required_argument, nullptr, 'g'},
+    {"skew", required_argument, nullptr, 's'},
+    {"nulls", required_argument, nullptr, 'n'},
+    {"jit", no_argument, nullptr, 'j'},
+    {"perf", no_argument, nullptr, 'P'},
+    {"shared", no_argument, nullptr, 'H'},
+    {"sorted", no_argument, nullptr, 'o'},
+    {"mem-budget", required_argument, nullptr, 'm'},
+    {"partition-budget", required_argument, nullptr, 'B'},
+    {"seed", required_argument, nullptr, 'S'},
+    {"program", required_argument, nullptr, 'p'},
+    {"list", no_argument, nullptr, 'l'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0}
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "", options, nullptr)) != -1) {
+    switch (opt) {
+      case 'r':
+        config.rows = strtoull(optarg, nullptr, 10);
+        break;
+      case 'g':
+        config.groups = strtoul(optarg, nullptr, 10);
+        break;
+      case 's':
+        config.skew = strtod(optarg, nullptr);
+        break;
+      case 'n':
+        config.nulls = strtod(optarg, nullptr);
+        break;
+      case 'j':
+        config.jit = true;
+        break;
+      case 'P':
+        config.perf = true;
+        break;
+      case 'o':
+        config.sorted = true;
+        break;
+      case 'H':
+        config.shared = true;
+        break;
+      case 'm':
+        config.mem_budget = strtoull(optarg, nullptr, 10);
+        break;
+      case 'B':
+        config.partition_budget = strtoull(optarg, nullptr, 10);
+        break;
+      case 'S':
+        config.seed = strtoul(optarg, nullptr, 10);
+        break;
+      case 'p':
+        only.push_back(optarg);
+        break;
+      case 'l':
+        list = true;
+        break;
+      default:
+        Usage(argv[0]);
+        return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (config.groups == 0) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  std::vector<BenchProgram> programs = Catalogue();
+  if (list) {
+    for (const BenchProgram& program : programs) {
+      printf("%-14s %s\n", program.name, program.sql);
+    }
+    return 0;
+  }
+
+  std::vector<const BenchProgram*> selected;
+  for (const BenchProgram& program : programs) {
+    if ((only.empty() ||
+         std::find(only.begin(), only.end(), program.name) != only.end()) &&
+        (!config.sorted || GroupsByA(program))) {
+      selected.push_back(&program);
+    }
+  }
+
+  /*
+   * Run each program, or all of them in a shared scan, in a child process,
+   * so that its peak RSS is its own and not that of the programs before it.
+   */
+  int ret = 0;
+  for (uint32_t i = 0; i < selected.size(); i++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      if (config.shared) {
+        RunShared(selected, config);
+      } else {
+        RunProgram(*selected[i], config);
+      }
+      _exit(0);
+    }
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0 ||
+        !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "%s: benchmark failed\n",
+              config.shared ? "shared scan" : selected[i]->name);
+      ret = 1;
+    }
+    if (config.shared) {
+      break;
+    }
+  }
+  return ret;
+}
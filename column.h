@@ -18,7 +18,10 @@ enum ColumnType {
   kTypeBigInt,
   kTypeFloat,
   kTypeDouble,
-  kTypeVarchar
+  kTypeVarchar,
+  kTypeDate,
+  kTypeDatetime,
+  kTypeTimestamp
 };
 
 class Column {
@@ -26,7 +29,7 @@ class Column {
   explicit Column(unsigned char* buf, uint32_t raw_length,
                  uint32_t encoded_length)
     : buf_(buf), raw_length_(raw_length), encoded_length_(encoded_length),
-    type_(kTypeUnknown), is_unsigned_(false) {
+    type_(kTypeUnknown), is_unsigned_(false), is_null_(false) {
     }
 
   virtual ~Column() {}
@@ -52,12 +55,21 @@ class Column {
     return is_unsigned_;
   }
 
+  // A NULL column keeps its buffer, but the value is not used.
+  bool is_null() {
+    return is_null_;
+  }
+  void set_null(bool is_null) {
+    is_null_ = is_null;
+  }
+
  protected:
   unsigned char* buf_;
   uint32_t raw_length_;
   uint32_t encoded_length_;
   ColumnType type_;
   bool is_unsigned_;
+  bool is_null_;
 };
 
 class ColumnBigInt : public Column {
@@ -114,4 +126,24 @@ class ColumnVarchar : public Column {
   }
 };
 
+/*
+ * DATE, DATETIME and TIMESTAMP columns hold an already packed int64, see
+ * temporal.h for the formats.
+ */
+class ColumnTemporal : public Column {
+ public:
+  explicit ColumnTemporal(ColumnType type, int64_t value, unsigned char* buf)
+    : Column(buf, sizeof(value), sizeof(value)) {
+      *(reinterpret_cast<int64_t*>(buf_)) = value;
+      type_ = type;
+    }
+
+  ~ColumnTemporal() override {
+  }
+
+  const unsigned char* data() override {
+    return buf_;
+  }
+};
+
 #endif  // COLUMN_H_
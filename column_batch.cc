@@ -0,0 +1,44 @@
+/*
+ * Copyright [2024] <Copyright Hopsworks AB>
+ *
+ * Author: Zhao Song
+ */
+#include "column_batch.h"
+
+#include <string.h>
+
+static bool IsFixedLength(ColumnType type) {
+  switch (type) {
+    case kTypeBigInt:
+    case kTypeDouble:
+    case kTypeDate:
+    case kTypeDatetime:
+    case kTypeTimestamp:
+      return true;
+    default:
+      return false;
+  }
+}
+
+uint32_t ColumnBatch::Load(Record* const* recs, uint32_t n_recs,
+                           uint32_t col_mask) {
+  n_rows_ = n_recs < kMaxRows ? n_recs : kMaxRows;
+  col_mask_ = col_mask;
+  for (uint32_t c = 0; c < Record::n_cols; c++) {
+    if (!((col_mask >> c) & 1)) {
+      continue;
+    }
+    bool fixed_length = IsFixedLength(Record::col_type(c));
+    // Column by column, so that each loop makes the same virtual calls
+    for (uint32_t row = 0; row < n_rows_; row++) {
+      Column* col = recs[row]->GetColumn(c);
+      nulls_[c][row] = col->is_null();
+      bufs_[c][row] = col->buf();
+      lengths_[c][row] = static_cast<uint16_t>(col->encoded_length());
+      if (fixed_length) {
+        memcpy(values_[c][row], col->data(), 8);
+      }
+    }
+  }
+  return n_rows_;
+}
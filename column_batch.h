@@ -0,0 +1,64 @@
+/*
+ * Copyright [2024] <Copyright Hopsworks AB>
+ *
+ * Author: Zhao Song
+ */
+#ifndef COLUMN_BATCH_H_
+#define COLUMN_BATCH_H_
+
+#include <cstdint>
+
+#include "record.h"
+
+/*
+ * The columns of a batch of records, loaded once so that any number of
+ * interpreters can read them without going through the Column objects
+ * again. Only the columns in the column mask (bit i is column i) are
+ * loaded. Per row and column, the batch keeps the NULL flag, the encoded
+ * column for group keys, and for the 8-byte types a copy of the value in
+ * the byte order of Column::data().
+ *
+ * The batch is about 30KB, so it should be allocated on the heap.
+ */
+class ColumnBatch {
+ public:
+  static const uint32_t kMaxRows = 256;
+
+  ColumnBatch() : n_rows_(0), col_mask_(0) {}
+
+  /*
+   * Load up to kMaxRows of the records and return the number of rows
+   * loaded. The records must outlive the use of the batch, since group
+   * keys are read from their buffers.
+   */
+  uint32_t Load(Record* const* recs, uint32_t n_recs, uint32_t col_mask);
+
+  uint32_t n_rows() const {
+    return n_rows_;
+  }
+  uint32_t col_mask() const {
+    return col_mask_;
+  }
+  bool is_null(uint32_t col, uint32_t row) const {
+    return nulls_[col][row];
+  }
+  const unsigned char* data(uint32_t col, uint32_t row) const {
+    return values_[col][row];
+  }
+  const unsigned char* buf(uint32_t col, uint32_t row) const {
+    return bufs_[col][row];
+  }
+  uint32_t encoded_length(uint32_t col, uint32_t row) const {
+    return lengths_[col][row];
+  }
+
+ private:
+  uint32_t n_rows_;
+  uint32_t col_mask_;
+  alignas(8) unsigned char values_[Record::n_cols][kMaxRows][8];
+  uint8_t nulls_[Record::n_cols][kMaxRows];
+  const unsigned char* bufs_[Record::n_cols][kMaxRows];
+  uint16_t lengths_[Record::n_cols][kMaxRows];
+};
+
+#endif  // COLUMN_BATCH_H_
@@ -424,6 +424,7 @@ int32_t RegDivReg(const Register& a, const Register& b, Register* res) {
       }
       res->type = res_type;
       res->is_unsigned = res_unsigned;
+      return res->is_null ? 1 : 0;
     }
 
     uval0 = static_cast<uint64_t>(val0_negative &&
@@ -441,9 +442,9 @@ int32_t RegDivReg(const Register& a, const Register& b, Register* res) {
     }
     // Check if res_val is overflow
     bool unsigned_flag = (a.is_unsigned != b.is_unsigned);
-    if ((unsigned_flag && !res_unsigned && res_val < 0) ||
-        (!unsigned_flag && res_unsigned &&
-         (uint64_t)res_val > (uint64_t)LLONG_MAX)) {
+    // res_val is unsigned, so it can only overflow as a signed result.
+    if (!unsigned_flag && res_unsigned &&
+        res_val > static_cast<uint64_t>(LLONG_MAX)) {
       return -1;
     } else {
       if (unsigned_flag) {
@@ -519,6 +520,7 @@ int32_t RegModReg(const Register& a, const Register& b, Register* res) {
       }
       res->type = res_type;
       res->is_unsigned = res_unsigned;
+      return res->is_null ? 1 : 0;
     }
 
     uval0 = static_cast<uint64_t>(val0_negative &&
@@ -530,9 +532,9 @@ int32_t RegModReg(const Register& a, const Register& b, Register* res) {
 
     // Check if res_val is overflow
     bool unsigned_flag = (a.is_unsigned != b.is_unsigned);
-    if ((unsigned_flag && !res_unsigned && res_val < 0) ||
-        (!unsigned_flag && res_unsigned &&
-         (uint64_t)res_val > (uint64_t)LLONG_MAX)) {
+    // res_val is unsigned, so it can only overflow as a signed result.
+    if (!unsigned_flag && res_unsigned &&
+        res_val > static_cast<uint64_t>(LLONG_MAX)) {
       return -1;
     } else {
       if (unsigned_flag) {
@@ -568,6 +570,104 @@ int32_t RegModReg(const Register& a, const Register& b, Register* res) {
   return 0;
 }
 
+/*
+ * Three-way comparison of two BIGINT registers, taking the signedness of
+ * each side into account.
+ */
+static int32_t CmpInt64(const Register& a, const Register& b) {
+  if (a.is_unsigned == b.is_unsigned) {
+    if (a.is_unsigned) {
+      return (a.value.val_uint64 > b.value.val_uint64) -
+             (a.value.val_uint64 < b.value.val_uint64);
+    }
+    return (a.value.val_int64 > b.value.val_int64) -
+           (a.value.val_int64 < b.value.val_int64);
+  }
+  if (a.is_unsigned) {
+    if (b.value.val_int64 < 0) {
+      return 1;
+    }
+    return (a.value.val_uint64 > b.value.val_uint64) -
+           (a.value.val_uint64 < b.value.val_uint64);
+  }
+  if (a.value.val_int64 < 0) {
+    return -1;
+  }
+  return (a.value.val_uint64 > b.value.val_uint64) -
+         (a.value.val_uint64 < b.value.val_uint64);
+}
+
+int32_t RegCmpReg(uint8_t op, const Register& a, const Register& b,
+                  Register* res) {
+  bool temporal = IsTemporalType(a.type) || IsTemporalType(b.type);
+  if (temporal) {
+    // DATE and DATETIME share the packed format, TIMESTAMP does not.
+    if (!IsTemporalType(a.type) || !IsTemporalType(b.type) ||
+        (a.type == kTypeTimestamp) != (b.type == kTypeTimestamp)) {
+      return -1;
+    }
+  } else {
+    assert((a.type == kTypeBigInt || a.type == kTypeDouble) &&
+           (b.type == kTypeBigInt || b.type == kTypeDouble));
+  }
+
+  if (a.is_null || b.is_null) {
+    SetRegisterNull(res);
+    res->type = kTypeBigInt;
+    // NULL
+    return 1;
+  }
+
+  int32_t cmp = 0;
+  if (temporal) {
+    cmp = (a.value.val_int64 > b.value.val_int64) -
+          (a.value.val_int64 < b.value.val_int64);
+  } else if (a.type == kTypeDouble || b.type == kTypeDouble) {
+    double val0 = (a.type == kTypeDouble) ?
+                     a.value.val_double :
+                     ((a.is_unsigned == true) ?
+                       static_cast<double>(a.value.val_uint64) :
+                       static_cast<double>(a.value.val_int64));
+    double val1 = (b.type == kTypeDouble) ?
+                     b.value.val_double :
+                     ((b.is_unsigned == true) ?
+                       static_cast<double>(b.value.val_uint64) :
+                       static_cast<double>(b.value.val_int64));
+    cmp = (val0 > val1) - (val0 < val1);
+  } else {
+    cmp = CmpInt64(a, b);
+  }
+
+  bool res_val = false;
+  switch (op) {
+    case kOpEq:
+      res_val = (cmp == 0);
+      break;
+    case kOpNe:
+      res_val = (cmp != 0);
+      break;
+    case kOpLt:
+      res_val = (cmp < 0);
+      break;
+    case kOpLe:
+      res_val = (cmp <= 0);
+      break;
+    case kOpGt:
+      res_val = (cmp > 0);
+      break;
+    case kOpGe:
+      res_val = (cmp >= 0);
+      break;
+    default:
+      assert(0);
+  }
+  res->type = kTypeBigInt;
+  res->value.val_int64 = res_val;
+  res->is_unsigned = false;
+  res->is_null = false;
+  return 0;
+}
+
 int32_t Min(const Register& a, AggResItem* res) {
   assert(res != nullptr && (a.is_null || a.type == res->type));
   // assert(res != nullptr && a.is_unsigned == res->is_unsigned);
@@ -575,7 +675,8 @@ int32_t Min(const Register& a, AggResItem* res) {
   if (a.type == kTypeDouble) {
     res_type = kTypeDouble;
   } else {
-    assert(a.type == kTypeBigInt);
+    // Packed temporal values order like signed integers.
+    assert(a.type == kTypeBigInt || IsTemporalType(a.type));
     res_type = kTypeBigInt;
   }
 
@@ -643,7 +744,8 @@ int32_t Max(const Register& a, AggResItem* res) {
   if (a.type == kTypeDouble) {
     res_type = kTypeDouble;
   } else {
-    assert(a.type == kTypeBigInt);
+    // Packed temporal values order like signed integers.
+    assert(a.type == kTypeBigInt || IsTemporalType(a.type));
     res_type = kTypeBigInt;
   }
 
@@ -817,15 +919,23 @@ bool AggInterpreter::Init() {
   if (inited_) {
     return true;
   }
+  if (init_error_[0] != '\0') {
+    return false;
+  }
 
   uint32_t value = 0;
 
   /*
    * 1. Double check the magic num and  total length of program.
    */
+  if (prog_len_ < 2) {
+    return InitError(0, "program is too short");
+  }
   value = prog_[cur_pos_++];
-  assert(((value & 0xFFFF0000) >> 16) == 0x0721);
-  assert((value & 0xFFFF) == prog_len_);
+  if (((value & 0xFFFF0000) >> 16) != 0x0721 ||
+      (value & 0xFFFF) != prog_len_) {
+    return InitError(0, "bad magic number or program length");
+  }
 
   /*
    * 2. Get num of columns for group by and num of aggregation results;
@@ -833,6 +943,9 @@ bool AggInterpreter::Init() {
   value = prog_[cur_pos_++];
   n_gb_cols_ = (value >> 16) & 0xFFFF;
   n_agg_results_ = value & 0xFFFF;
+  if (cur_pos_ + n_gb_cols_ + n_agg_results_ > prog_len_) {
+    return InitError(1, "header is longer than the program");
+  }
 
   /*
    * 3. Get all the group by columns id.
@@ -845,26 +958,118 @@ bool AggInterpreter::Init() {
       gb_cols_[i++] = prog_[cur_pos_++];
     }
 
-    gb_map_ = new std::map<Entry, Entry, EntryCmp>;
+    gb_map_ = new GroupMap(EntryCmp(stats_ ? &stats_->key_compares :
+                                             nullptr));
   }
 
   /*
    * 4. Get all aggregation results types
    */
   if (n_agg_results_) {
-    agg_results_ = new AggResItem[n_agg_results_];
+    agg_types_ = new DataType[n_agg_results_];
     uint32_t i = 0;
     while (i < n_agg_results_ && cur_pos_ < prog_len_) {
-      agg_results_[i].type = prog_[cur_pos_++];
-      agg_results_[i].inited = false;  // used by Min/Max
-      agg_results_[i++].value.val_int64 = 0;
+      agg_types_[i++] = prog_[cur_pos_++];
     }
+    agg_state_len_ = n_agg_results_ * sizeof(DataValue) +
+                     2 * ((n_agg_results_ + 7) / 8);
+    agg_results_ = new char[agg_state_len_];
+    memset(agg_results_, 0, agg_state_len_);
   }
 
-  inited_ = true;
   agg_prog_start_pos_ = cur_pos_;
   memset(registers_, 0, sizeof(registers_));
 
+  /*
+   * 5. Verify the header and the instructions once, so that executing the
+   *    program needs no checks per row.
+   */
+  if (!Verify()) {
+    return false;
+  }
+  inited_ = true;
+
+  /*
+   * 6. Record which aggregation op produces each result, so that partial
+   *    results of the same group can be merged after spilling, and which
+   *    columns the program reads, so that only those are loaded.
+   */
+  if (n_agg_results_) {
+    agg_ops_ = new uint32_t[n_agg_results_];
+    memset(agg_ops_, 0, n_agg_results_ * sizeof(uint32_t));
+  }
+  for (uint32_t i = 0; i < n_gb_cols_; i++) {
+    col_mask_ |= 1U << (gb_cols_[i] & 0xFFFF);
+  }
+  for (uint32_t pos = agg_prog_start_pos_; pos < prog_len_; pos++) {
+    uint32_t op = (prog_[pos] & 0xFC000000) >> 26;
+    uint32_t index = prog_[pos] & 0x0000FFFF;
+    if (op == kOpLoadConst) {
+      // Skip the immediate
+      pos += 2;
+    } else if (op == kOpLoadCol) {
+      col_mask_ |= 1U << index;
+    } else if (op == kOpSum || op == kOpMax || op == kOpMin ||
+               op == kOpCount) {
+      agg_ops_[index] = op;
+    }
+  }
+
+  /*
+   * 7. Allocate the buffers for the group key, and in sorted-input mode for
+   *    the current group, once rather than per record. Partitioned
+   *    aggregation only applies to a group map that is never spilled.
+   */
+  if (n_gb_cols_) {
+    max_key_len_ = n_gb_cols_ * (1 + Record::encoded_length_);
+    key_buf_ = new char[max_key_len_];
+  }
+  sorted_input_ = sorted_input_ && n_gb_cols_;
+  if (sorted_input_) {
+    cur_group_ = new char[agg_state_len_ + max_key_len_];
+  }
+  if (!n_gb_cols_ || sorted_input_ || mem_budget_) {
+    partition_budget_ = 0;
+  }
+
+  /*
+   * 8. Decode the instructions once for the interpreter.
+   */
+  Decode();
+  if (stats_) {
+    uint32_t n_instrs = 0;
+    while (code_[n_instrs].dispatch != kDispatchEnd) {
+      n_instrs++;
+    }
+    stats_->instr_count.assign(n_instrs, 0);
+    stats_->instr_cycles.assign(n_instrs, 0);
+  }
+
+  /*
+   * 9. Optionally compile the program, keeping the interpreter as the
+   *    fallback for programs that the JIT can't handle.
+   */
+  if (use_jit_) {
+    jit_ = new AggJit;
+    if (jit_->Compile(this)) {
+      jit_cols_ = new const unsigned char*[jit_->n_col_slots()];
+      memset(jit_cols_, 0, jit_->n_col_slots() * sizeof(unsigned char*));
+      jit_nulls_ = new uint8_t[jit_->n_col_slots()];
+      memset(jit_nulls_, 0, jit_->n_col_slots());
+    } else {
+      delete jit_;
+      jit_ = nullptr;
+    }
+  }
+
+  /*
+   * 10. Optionally open the performance counters. If none are available,
+   *     processing goes on and PrintPerf() says so.
+   */
+  if (perf_) {
+    perf_->Open();
+  }
+
   return true;
 }
 
@@ -878,8 +1083,12 @@ DataType CeilType(DataType type) {
     case kTypeFloat:
     case kTypeDouble:
       return kTypeDouble;
+    case kTypeDate:
+    case kTypeDatetime:
+    case kTypeTimestamp:
+      return type;
     default:
-      assert(0);
+      return kTypeUnknown;
   }
 }
 
@@ -888,288 +1097,1645 @@ bool DecodeRawType(uint8_t type, DataType* res) {
   return type & 0x10;
 }
 
-bool AggInterpreter::ProcessRec(Record* rec) {
-  AggResItem* agg_res_ptr = nullptr;
+bool AggInterpreter::InitError(uint32_t pos, const char* msg) {
+  snprintf(init_error_, sizeof(init_error_), "word %u: %s", pos, msg);
+  return false;
+}
 
-  if (n_gb_cols_) {
-    uint32_t agg_rec_len = 0;
-    for (uint32_t i = 0; i < n_gb_cols_; i++) {
-      Column* col = rec->GetColumn(i);
-      agg_rec_len += col->encoded_length();
-    }
-    agg_rec_len += (n_agg_results_ * sizeof(AggResItem));
-    char* agg_rec = new char[agg_rec_len];
-    memset(agg_rec, 0, agg_rec_len);
-
-    uint32_t pos = 0;
-    for (uint32_t i = 0; i < n_gb_cols_; i++) {
-      Column* col = rec->GetColumn(i);
-      memcpy(agg_rec + pos, col->buf(), col->encoded_length());
-      pos += col->encoded_length();
-    }
-    Entry entry{agg_rec, pos};
-    auto iter = gb_map_->find(entry);
-    if (iter != gb_map_->end()) {
-      agg_res_ptr = reinterpret_cast<AggResItem*>(iter->second.ptr);
-      delete[] agg_rec;
-    } else {
-      gb_map_->insert(std::make_pair<Entry, Entry>(std::move(entry),
-          std::move(Entry{agg_rec + pos,
-            static_cast<uint32_t>(n_agg_results_ * sizeof(AggResItem))})));
-      n_groups_ = gb_map_->size();
-      agg_res_ptr = reinterpret_cast<AggResItem*>(agg_rec + pos);
-
-      for (uint32_t i = 0; i < n_agg_results_; i++) {
-        agg_res_ptr[i].type = agg_results_[i].type;
-      }
+static bool IsLoadableType(DataType type) {
+  return type == kTypeBigInt || type == kTypeDouble || IsTemporalType(type);
+}
+
+/*
+ * Check everything that executing the program would otherwise assert per
+ * row. Besides the bounds of every index, the register types are tracked
+ * through the program: a register must be written before it is read within
+ * the same program, and each op must get the types its kernel expects.
+ * A register keeps the type of its non-NULL value, since the kernels only
+ * look at types of non-NULL values.
+ */
+bool AggInterpreter::Verify() {
+  for (uint32_t i = 0; i < n_gb_cols_; i++) {
+    uint32_t col_index = gb_cols_[i] & 0xFFFF;
+    uint32_t unit = (gb_cols_[i] >> 16) & 0xFFFF;
+    if (col_index >= Record::n_cols) {
+      return InitError(2 + i, "group by column out of range");
+    }
+    if (unit >= kUnitTotal ||
+        (unit != kUnitNone && !IsTemporalType(Record::col_type(col_index)))) {
+      return InitError(2 + i, "bad group by truncation");
+    }
+  }
+  for (uint32_t i = 0; i < n_agg_results_; i++) {
+    if (!IsLoadableType(agg_types_[i])) {
+      return InitError(2 + n_gb_cols_ + i, "bad aggregation result type");
     }
-  } else {
-    agg_res_ptr = agg_results_;
   }
 
-  Column* col;
-  uint32_t value;
-  uint8_t raw_type;
-  DataType type;
-  bool is_unsigned;
-  uint32_t reg_index;
-
-  uint8_t raw_type2;
-  DataType type2;
-  bool is_unsigned2;
-  uint32_t reg_index2;
-
-  uint32_t agg_index;
-  uint32_t col_index;
+  DataType reg_types[kRegTotal];
+  for (uint32_t i = 0; i < kRegTotal; i++) {
+    reg_types[i] = kTypeUnknown;
+  }
 
-  uint32_t exec_pos = agg_prog_start_pos_;
-  while (exec_pos < prog_len_) {
-    value = prog_[exec_pos++];
+  uint32_t pos = agg_prog_start_pos_;
+  while (pos < prog_len_) {
+    uint32_t ins_pos = pos;
+    uint32_t value = prog_[pos++];
     uint8_t op = (value & 0xFC000000) >> 26;
-    int ret = 0;
+    DataType type;
+    bool is_unsigned = DecodeRawType((value & 0x03E00000) >> 21, &type);
+    uint32_t reg = (value & 0x000F0000) >> 16;
+    uint32_t reg1 = (value & 0x0000F000) >> 12;
+    uint32_t reg2 = (value & 0x00000F00) >> 8;
+    uint32_t index = value & 0x0000FFFF;
+    (void)is_unsigned;
+
     switch (op) {
       case kOpPlus:
-        raw_type = (value & 0x03E00000) >> 21;
-        raw_type2 = (value & 0x001F0000) >> 16;
-        is_unsigned = DecodeRawType(raw_type, &type);
-        is_unsigned2 = DecodeRawType(raw_type2, &type2);
-
-        reg_index = (value & 0x0000F000) >> 12;
-        reg_index2 = (value & 0x00000F00) >> 8;
-
-        assert(registers_[reg_index].type == kTypeBigInt ||
-              registers_[reg_index].type == kTypeDouble);
-        assert(registers_[reg_index2].type == kTypeBigInt ||
-              registers_[reg_index2].type == kTypeDouble);
-
-        ret = RegPlusReg(registers_[reg_index], registers_[reg_index2],
-                              &registers_[reg_index]);
-        assert(ret >= 0);
+      case kOpMinus:
+      case kOpMul:
+      case kOpDiv:
+      case kOpMod:
+        if (reg1 >= kRegTotal || reg2 >= kRegTotal) {
+          return InitError(ins_pos, "register out of range");
+        }
+        if ((reg_types[reg1] != kTypeBigInt &&
+             reg_types[reg1] != kTypeDouble) ||
+            (reg_types[reg2] != kTypeBigInt &&
+             reg_types[reg2] != kTypeDouble)) {
+          return InitError(ins_pos, "bad operand types");
+        }
+        if (reg_types[reg2] == kTypeDouble) {
+          reg_types[reg1] = kTypeDouble;
+        }
         break;
 
-      case kOpMinus:
-        raw_type = (value & 0x03E00000) >> 21;
-        raw_type2 = (value & 0x001F0000) >> 16;
-        is_unsigned = DecodeRawType(raw_type, &type);
-        is_unsigned2 = DecodeRawType(raw_type2, &type2);
-
-        reg_index = (value & 0x0000F000) >> 12;
-        reg_index2 = (value & 0x00000F00) >> 8;
-
-        assert(registers_[reg_index].type == kTypeBigInt ||
-              registers_[reg_index].type == kTypeDouble);
-        assert(registers_[reg_index2].type == kTypeBigInt ||
-              registers_[reg_index2].type == kTypeDouble);
-
-        ret = RegMinusReg(registers_[reg_index], registers_[reg_index2],
-                              &registers_[reg_index]);
-        assert(ret >= 0);
+      case kOpEq:
+      case kOpNe:
+      case kOpLt:
+      case kOpLe:
+      case kOpGt:
+      case kOpGe: {
+        if (reg1 >= kRegTotal || reg2 >= kRegTotal) {
+          return InitError(ins_pos, "register out of range");
+        }
+        DataType a = reg_types[reg1];
+        DataType b = reg_types[reg2];
+        bool numeric = (a == kTypeBigInt || a == kTypeDouble) &&
+                       (b == kTypeBigInt || b == kTypeDouble);
+        bool temporal = IsTemporalType(a) && IsTemporalType(b) &&
+                        (a == kTypeTimestamp) == (b == kTypeTimestamp);
+        if (!numeric && !temporal) {
+          return InitError(ins_pos, "bad operand types");
+        }
+        reg_types[reg1] = kTypeBigInt;
         break;
+      }
 
-      case kOpMul:
-        raw_type = (value & 0x03E00000) >> 21;
-        raw_type2 = (value & 0x001F0000) >> 16;
-        is_unsigned = DecodeRawType(raw_type, &type);
-        is_unsigned2 = DecodeRawType(raw_type2, &type2);
-
-        reg_index = (value & 0x0000F000) >> 12;
-        reg_index2 = (value & 0x00000F00) >> 8;
-
-        assert(registers_[reg_index].type == kTypeBigInt ||
-              registers_[reg_index].type == kTypeDouble);
-        assert(registers_[reg_index2].type == kTypeBigInt ||
-              registers_[reg_index2].type == kTypeDouble);
-
-        ret = RegMulReg(registers_[reg_index], registers_[reg_index2],
-                              &registers_[reg_index]);
-        assert(ret >= 0);
+      case kOpLoadCol:
+        if (reg >= kRegTotal) {
+          return InitError(ins_pos, "register out of range");
+        }
+        if (index >= Record::n_cols) {
+          return InitError(ins_pos, "column out of range");
+        }
+        if (!IsLoadableType(type) ||
+            type != CeilType(Record::col_type(index))) {
+          return InitError(ins_pos, "bad column type");
+        }
+        reg_types[reg] = type;
         break;
 
-      case kOpDiv:
-        raw_type = (value & 0x03E00000) >> 21;
-        raw_type2 = (value & 0x001F0000) >> 16;
-        is_unsigned = DecodeRawType(raw_type, &type);
-        is_unsigned2 = DecodeRawType(raw_type2, &type2);
-
-        reg_index = (value & 0x0000F000) >> 12;
-        reg_index2 = (value & 0x00000F00) >> 8;
-
-        assert(registers_[reg_index].type == kTypeBigInt ||
-              registers_[reg_index].type == kTypeDouble);
-        assert(registers_[reg_index2].type == kTypeBigInt ||
-              registers_[reg_index2].type == kTypeDouble);
-
-        ret = RegDivReg(registers_[reg_index], registers_[reg_index2],
-                              &registers_[reg_index]);
-        assert(ret >= 0);
+      case kOpLoadConst:
+        if (reg >= kRegTotal) {
+          return InitError(ins_pos, "register out of range");
+        }
+        if (!IsLoadableType(type)) {
+          return InitError(ins_pos, "bad constant type");
+        }
+        if (pos + 2 > prog_len_) {
+          return InitError(ins_pos, "constant is truncated");
+        }
+        pos += 2;
+        reg_types[reg] = type;
         break;
 
-      case kOpMod:
-        raw_type = (value & 0x03E00000) >> 21;
-        raw_type2 = (value & 0x001F0000) >> 16;
-        is_unsigned = DecodeRawType(raw_type, &type);
-        is_unsigned2 = DecodeRawType(raw_type2, &type2);
+      case kOpCount:
+      case kOpSum:
+      case kOpMax:
+      case kOpMin:
+        if (reg >= kRegTotal) {
+          return InitError(ins_pos, "register out of range");
+        }
+        if (index >= n_agg_results_) {
+          return InitError(ins_pos, "aggregation result out of range");
+        }
+        if (reg_types[reg] == kTypeUnknown) {
+          return InitError(ins_pos, "register is read before it is written");
+        }
+        if (op == kOpCount) {
+          if (agg_types_[index] != kTypeBigInt) {
+            return InitError(ins_pos, "bad aggregation result type");
+          }
+        } else if (op == kOpSum) {
+          if (type != agg_types_[index] ||
+              (reg_types[reg] != kTypeBigInt &&
+               reg_types[reg] != kTypeDouble) ||
+              (reg_types[reg] == kTypeDouble && type != kTypeDouble)) {
+            return InitError(ins_pos, "bad aggregation type");
+          }
+        } else if (type != agg_types_[index] ||
+                   reg_types[reg] != agg_types_[index]) {
+          return InitError(ins_pos, "bad aggregation type");
+        }
+        break;
+
+      default:
+        return InitError(ins_pos, "unsupported instruction");
+    }
+  }
+  return true;
+}
 
-        reg_index = (value & 0x0000F000) >> 12;
-        reg_index2 = (value & 0x00000F00) >> 8;
+bool AggInterpreter::ProcessRec(Record* rec) {
+  return ProcessRecs(&rec, 1);
+}
+
+bool AggInterpreter::ProcessRecs(Record* const* recs, uint32_t n_recs) {
+  if (batch_ == nullptr) {
+    batch_ = new ColumnBatch;
+  }
+  PerfValues start;
+  if (perf_) {
+    perf_->Read(&start);
+  }
+  uint32_t done = 0;
+  bool ok = true;
+  while (ok && done < n_recs) {
+    uint32_t n = batch_->Load(recs + done, n_recs - done, col_mask_);
+    uint32_t processed = ProcessRows(*batch_);
+    done += processed;
+    ok = processed == n;
+  }
+  if (perf_) {
+    PerfValues end;
+    perf_->Read(&end);
+    perf_values_ += end - start;
+    perf_rows_ += done;
+  }
+  return ok;
+}
 
-        assert(registers_[reg_index].type == kTypeBigInt ||
-              registers_[reg_index].type == kTypeDouble);
-        assert(registers_[reg_index2].type == kTypeBigInt ||
-              registers_[reg_index2].type == kTypeDouble);
+bool AggInterpreter::ProcessBatch(const ColumnBatch& batch) {
+  PerfValues start;
+  if (perf_) {
+    perf_->Read(&start);
+  }
+  uint32_t processed = ProcessRows(batch);
+  if (perf_) {
+    PerfValues end;
+    perf_->Read(&end);
+    perf_values_ += end - start;
+    perf_rows_ += processed;
+  }
+  return processed == batch.n_rows();
+}
 
-        ret = RegModReg(registers_[reg_index], registers_[reg_index2],
-                              &registers_[reg_index]);
-        assert(ret >= 0);
+uint32_t AggInterpreter::ProcessRows(const ColumnBatch& batch) {
+  uint32_t row = 0;
+  while (row < batch.n_rows() && ProcessRow(batch, row)) {
+    row++;
+  }
+  return row;
+}
 
-        break;
+bool AggInterpreter::ProcessRow(const ColumnBatch& batch, uint32_t row) {
+  char* agg_state = nullptr;
+  uint32_t part = kNoPartition;
+  uint64_t start_cycles = stats_ ? ReadCycleCounter() : 0;
 
-      case kOpLoadCol:
-        raw_type = (value & 0x03E00000) >> 21;
-        is_unsigned = DecodeRawType(raw_type, &type);
-        reg_index = (value & 0x000F0000) >> 16;
-        col_index = (value & 0x0000FFFF);
-
-        col = rec->GetColumn(col_index);
-        assert(type == CeilType(col->type()) &&
-            col->raw_length() == sizeof(Register::value));
-
-        ResetRegister(&registers_[reg_index]);
-        registers_[reg_index].type = type;
-        registers_[reg_index].is_unsigned = is_unsigned;
-        // TODO(zhao song): registers_[reg_index].is_null = col->is_null();
-        registers_[reg_index].is_null = false;
-        switch (type) {
-          case kTypeBigInt:
-            registers_[reg_index].value.val_int64 = longlongget(col->data());
-            break;
-          case kTypeDouble:
-            registers_[reg_index].value.val_double = doubleget(col->data());
-          default:
-            break;
+  if (n_gb_cols_) {
+    uint32_t key_len = BuildGroupKey(batch, row, key_buf_);
+    if (sorted_input_) {
+      agg_state = SortedGroup(key_len);
+    } else if (partitioned_) {
+      agg_state = FindTuple(key_len, &part);
+    } else {
+      Entry entry{key_buf_, key_len};
+      auto iter = gb_map_->find(entry);
+      if (iter != gb_map_->end()) {
+        agg_state = iter->second.ptr;
+      } else {
+        /*
+         * The aggregation state is placed before the group key in the same
+         * allocation, which keeps the 8-byte accumulators aligned.
+         */
+        uint32_t agg_rec_len = agg_state_len_ + key_len;
+        char* agg_rec = new char[agg_rec_len];
+        memset(agg_rec, 0, agg_state_len_);
+        memcpy(agg_rec + agg_state_len_, key_buf_, key_len);
+        gb_map_->insert(std::make_pair<Entry, Entry>(
+            Entry{agg_rec + agg_state_len_, key_len},
+            Entry{agg_rec, agg_state_len_}));
+        n_groups_ = gb_map_->size();
+        mem_used_ += agg_rec_len + kGroupOverhead;
+        agg_state = agg_rec;
+        if (stats_) {
+          stats_->group_inserts++;
         }
-        break;
+      }
+    }
+    if (stats_) {
+      stats_->group_probes++;
+      stats_->group_cycles += ReadCycleCounter() - start_cycles;
+    }
+  } else {
+    agg_state = agg_results_;
+  }
 
-      case kOpCount:
-        raw_type = (value & 0x03E00000) >> 21;
-        is_unsigned = DecodeRawType(raw_type, &type);
-        reg_index = (value & 0x000F0000) >> 16;
-        agg_index = (value & 0x0000FFFF);
-        assert(agg_results_[agg_index].type == kTypeUnknown ||
-               agg_results_[agg_index].type == kTypeBigInt);
-        ret = Count(registers_[reg_index], &agg_res_ptr[agg_index]);
-        assert(ret >= 0);
-        break;
+  bool ok;
+  if (stats_) {
+    ok = InterpretWithStats(batch, row, agg_state);
+  } else if (jit_) {
+    ok = RunJit(batch, row, agg_state);
+  } else {
+    ok = Interpret(batch, row, agg_state);
+  }
+  if (!ok) {
+    return false;
+  }
+
+  /*
+   * Merge, partition or spill only after the record has been processed,
+   * since agg_state points into a tuple buffer or the group map. The
+   * partitions are split when the merges have grown them over the budget.
+   */
+  if (part != kNoPartition &&
+      partitions_[part].tuples_len + max_tuple_len_ >
+      partitions_[part].tuples.size()) {
+    if (!MergeTuples(part)) {
+      return false;
+    }
+    if (radix_bits_ < kMaxRadixBits &&
+        mem_used_ > partition_budget_ << radix_bits_) {
+      return SplitPartitions(radix_bits_ + 1);
+    }
+    return true;
+  }
+  if (partition_budget_ && !partitioned_ && mem_used_ > partition_budget_) {
+    PartitionGroups();
+  }
+  if (mem_budget_ && mem_used_ > mem_budget_ && !sorted_input_) {
+    return SpillGroups();
+  }
+  return true;
+}
 
-       case kOpSum:
-        raw_type = (value & 0x03E00000) >> 21;
-        is_unsigned = DecodeRawType(raw_type, &type);
-        reg_index = (value & 0x000F0000) >> 16;
-        agg_index = (value & 0x0000FFFF);
-        assert(type == agg_results_[agg_index].type);
+/*
+ * Each key column starts with a NULL indicator byte, and its value follows
+ * only when it is not NULL, so that all NULLs form one group. Return the
+ * length of the key.
+ */
+uint32_t AggInterpreter::BuildGroupKey(const ColumnBatch& batch, uint32_t row,
+                                       char* key) {
+  uint32_t pos = 0;
+  for (uint32_t i = 0; i < n_gb_cols_; i++) {
+    uint32_t col = gb_cols_[i] & 0xFFFF;
+    TemporalUnit unit = static_cast<TemporalUnit>((gb_cols_[i] >> 16) & 0xF);
+    key[pos++] = batch.is_null(col, row);
+    if (batch.is_null(col, row)) {
+      continue;
+    } else if (unit != kUnitNone) {
+      int8store(key + pos,
+                TruncateTemporal(Record::col_type(col),
+                                 longlongget(batch.data(col, row)), unit));
+    } else {
+      memcpy(key + pos, batch.buf(col, row), batch.encoded_length(col, row));
+    }
+    pos += batch.encoded_length(col, row);
+  }
+  return pos;
+}
 
-        ret = Sum(registers_[reg_index], &agg_res_ptr[agg_index]);
+/*
+ * Sorted-input mode: return the state of the group with the key in
+ * key_buf_, which is the current group unless the key has changed.
+ */
+char* AggInterpreter::SortedGroup(uint32_t key_len) {
+  char* key = cur_group_ + agg_state_len_;
+  if (key_len == cur_key_len_ && memcmp(key, key_buf_, key_len) == 0) {
+    return cur_group_;
+  }
+  Finish();
+  memset(cur_group_, 0, agg_state_len_);
+  memcpy(key, key_buf_, key_len);
+  cur_key_len_ = key_len;
+  n_groups_++;
+  mem_used_ = agg_state_len_ + key_len;
+  if (stats_) {
+    stats_->group_inserts++;
+  }
+  return cur_group_;
+}
 
-        assert(ret >= 0);
-        break;
+bool AggInterpreter::Finish() {
+  if (partitioned_) {
+    return MergeAllTuples();
+  }
+  if (!sorted_input_ || cur_key_len_ == 0) {
+    return true;
+  }
+  EmitGroup(cur_group_ + agg_state_len_, cur_key_len_, cur_group_, sink_,
+            sink_arg_);
+  cur_key_len_ = 0;
+  return true;
+}
+
+bool AggInterpreter::ForEachGroup(GroupSink sink, void* arg) {
+  if (spilled_) {
+    return MergeSpilled(sink, arg);
+  }
+  if (partitioned_ && !MergeAllTuples()) {
+    return false;
+  }
+  for (uint32_t i = 0; i < n_partitions(); i++) {
+    const GroupTable& groups = partitions_[i].groups;
+    for (uint32_t j = 0; j < groups.capacity(); j++) {
+      const GroupSlot& slot = groups.slot(j);
+      if (slot.key) {
+        EmitGroup(slot.key, slot.key_len, slot.key - agg_state_len_, sink,
+                  arg);
+      }
+    }
+  }
+  if (gb_map_) {
+    for (auto iter = gb_map_->begin(); iter != gb_map_->end(); iter++) {
+      EmitGroup(iter->first.ptr, iter->first.len, iter->second.ptr, sink,
+                arg);
+    }
+  }
+  return true;
+}
+
+void AggInterpreter::EmitGroup(const char* key, uint32_t key_len,
+                               const char* state, GroupSink sink, void* arg) {
+  if (sink == nullptr) {
+    PrintGroup(key, key_len, state);
+    return;
+  }
+  AggResItem* items = emit_items_;
+  if (items == nullptr) {
+    emit_items_ = items = new AggResItem[n_agg_results_ ? n_agg_results_ : 1];
+  }
+  for (uint32_t i = 0; i < n_agg_results_; i++) {
+    LoadAggRes(state, i, &items[i]);
+  }
+  sink(arg, key, key_len, items, n_agg_results_);
+}
 
-       case kOpMax:
-        raw_type = (value & 0x03E00000) >> 21;
-        is_unsigned = DecodeRawType(raw_type, &type);
-        reg_index = (value & 0x000F0000) >> 16;
-        agg_index = (value & 0x0000FFFF);
-        assert(type == agg_results_[agg_index].type);
+// Return false if the compiled program reports an overflow
+bool AggInterpreter::RunJit(const ColumnBatch& batch, uint32_t row,
+                            char* agg_state) {
+  const std::vector<uint32_t>& cols = jit_->cols();
+  for (uint32_t i = 0; i < cols.size(); i++) {
+    jit_cols_[cols[i]] = batch.data(cols[i], row);
+    jit_nulls_[cols[i]] = batch.is_null(cols[i], row);
+  }
+  return jit_->func()(jit_cols_, jit_nulls_, agg_state) >= 0;
+}
 
-        ret = Max(registers_[reg_index], &agg_res_ptr[agg_index]);
+int32_t AggInterpreter::JitAggregate(AggInterpreter* self, char* agg_state,
+                                     uint32_t op, uint32_t agg_index,
+                                     const Register* reg) {
+  AggResItem agg_res;
+  int32_t ret = 0;
+  self->LoadAggRes(agg_state, agg_index, &agg_res);
+  switch (op) {
+    case kOpSum:
+      ret = Sum(*reg, &agg_res);
+      break;
+    case kOpMax:
+      ret = Max(*reg, &agg_res);
+      break;
+    case kOpMin:
+      ret = Min(*reg, &agg_res);
+      break;
+    default:
+      assert(0);
+  }
+  self->StoreAggRes(agg_res, agg_state, agg_index);
+  return ret;
+}
 
-        assert(ret >= 0);
+/*
+ * Decode the program into code_, one entry per instruction, and pick the
+ * handler of every entry.
+ */
+void AggInterpreter::Decode() {
+  code_ = new DecodedInstr[prog_len_ - agg_prog_start_pos_ + 1];
+  memset(code_, 0, (prog_len_ - agg_prog_start_pos_ + 1) *
+                   sizeof(DecodedInstr));
+
+  uint32_t n_instrs = 0;
+  uint32_t pos = agg_prog_start_pos_;
+  while (pos < prog_len_) {
+    uint32_t value = prog_[pos++];
+    DecodedInstr* ins = &code_[n_instrs++];
+    ins->op = (value & 0xFC000000) >> 26;
+    switch (ins->op) {
+      case kOpPlus:
+      case kOpMinus:
+      case kOpMul:
+      case kOpDiv:
+      case kOpMod:
+        ins->dispatch = kDispatchArith;
+        ins->reg = (value & 0x0000F000) >> 12;
+        ins->reg2 = (value & 0x00000F00) >> 8;
+        ins->arith = ins->op == kOpPlus ? RegPlusReg :
+                     ins->op == kOpMinus ? RegMinusReg :
+                     ins->op == kOpMul ? RegMulReg :
+                     ins->op == kOpDiv ? RegDivReg : RegModReg;
         break;
 
-       case kOpMin:
-        raw_type = (value & 0x03E00000) >> 21;
-        is_unsigned = DecodeRawType(raw_type, &type);
-        reg_index = (value & 0x000F0000) >> 16;
-        agg_index = (value & 0x0000FFFF);
-        assert(type == agg_results_[agg_index].type);
+      case kOpEq:
+      case kOpNe:
+      case kOpLt:
+      case kOpLe:
+      case kOpGt:
+      case kOpGe:
+        ins->dispatch = kDispatchCmp;
+        ins->reg = (value & 0x0000F000) >> 12;
+        ins->reg2 = (value & 0x00000F00) >> 8;
+        break;
 
-        ret = Min(registers_[reg_index], &agg_res_ptr[agg_index]);
+      case kOpLoadCol:
+      case kOpLoadConst:
+        ins->dispatch = ins->op == kOpLoadCol ? kDispatchLoadCol :
+                                                kDispatchLoadConst;
+        ins->is_unsigned = DecodeRawType((value & 0x03E00000) >> 21,
+                                         &ins->type);
+        ins->reg = (value & 0x000F0000) >> 16;
+        ins->index = (value & 0x0000FFFF);
+        if (ins->op == kOpLoadConst) {
+          ins->imm = static_cast<uint64_t>(prog_[pos]) |
+                     static_cast<uint64_t>(prog_[pos + 1]) << 32;
+          pos += 2;
+        }
+        break;
 
-        assert(ret >= 0);
+      case kOpCount:
+      case kOpSum:
+      case kOpMax:
+      case kOpMin:
+        ins->dispatch = kDispatchAgg;
+        ins->is_unsigned = DecodeRawType((value & 0x03E00000) >> 21,
+                                         &ins->type);
+        ins->reg = (value & 0x000F0000) >> 16;
+        ins->index = (value & 0x0000FFFF);
+        ins->agg = ins->op == kOpCount ? Count :
+                   ins->op == kOpSum ? Sum :
+                   ins->op == kOpMax ? Max : Min;
         break;
 
       default:
+        ins->dispatch = kDispatchNop;
         break;
     }
   }
-  return true;
+  code_[n_instrs].dispatch = kDispatchEnd;
+
+  FuseInstructions(n_instrs);
 }
 
-void AggInterpreter::Print() {
-  if (n_gb_cols_) {
-    if (gb_map_) {
-      printf("Group by columns: [");
-      for (int i = 0; i < n_gb_cols_; i++) {
-        printf("%u ", gb_cols_[i]);
+/*
+ * Peephole pass that replaces the handler of the first instruction of each
+ * run matching a superinstruction, trying the longest runs first. The
+ * instructions of a run are still executed one after the other, so that
+ * fusing never depends on which registers they use.
+ */
+void AggInterpreter::FuseInstructions(uint32_t n_instrs) {
+  static const struct {
+    DispatchOp fused;
+    uint32_t len;
+    DispatchOp seq[4];
+  } kPatterns[] = {
+    {kDispatchLoad2ArithAgg, 4,
+      {kDispatchLoadCol, kDispatchLoadCol, kDispatchArith, kDispatchAgg}},
+    {kDispatchLoad2Arith, 3,
+      {kDispatchLoadCol, kDispatchLoadCol, kDispatchArith}},
+    {kDispatchLoadArithAgg, 3,
+      {kDispatchLoadCol, kDispatchArith, kDispatchAgg}},
+    {kDispatchLoadArith, 2, {kDispatchLoadCol, kDispatchArith}},
+    {kDispatchArithAgg, 2, {kDispatchArith, kDispatchAgg}},
+    {kDispatchLoadAgg, 2, {kDispatchLoadCol, kDispatchAgg}},
+  };
+
+  uint32_t i = 0;
+  while (i < n_instrs) {
+    uint32_t len = 1;
+    for (const auto& pattern : kPatterns) {
+      if (i + pattern.len > n_instrs) {
+        continue;
       }
-      printf("]\n");
-
-      for (auto iter = gb_map_->begin(); iter != gb_map_->end(); iter++) {
-        printf("Group [%p, %u], Aggregation result: [\n",
-            reinterpret_cast<void*>(iter->first.ptr), iter->first.len);
-        AggResItem* item = reinterpret_cast<AggResItem*>(iter->second.ptr);
-        for (int i = 0; i < n_agg_results_; i++) {
-          switch (item[i].type) {
-            case kTypeBigInt:
-              printf("    (kTypeBigInt: %ld)\n", item[i].value.val_int64);
-              break;
-
-            case kTypeDouble:
-              printf("    (kTypeDouble: %.16f)\n", item[i].value.val_double);
-              break;
-            default:
-              assert(0);
-          }
-        }
-        printf("]\n");
+      uint32_t j = 0;
+      while (j < pattern.len && code_[i + j].dispatch == pattern.seq[j]) {
+        j++;
       }
-    }
-  } else {
-    printf("Aggregation result: [\n");
-    AggResItem* item = agg_results_;
-    for (int i = 0; i < n_agg_results_; i++) {
-      switch (item[i].type) {
-        case kTypeBigInt:
-          printf("    (kTypeBigInt: %ld)\n", item[i].value.val_int64);
-          break;
-
-        case kTypeDouble:
-          printf("    (kTypeDouble: %.16f)\n", item[i].value.val_double);
-          break;
-        default:
-          assert(0);
+      if (j == pattern.len) {
+        code_[i].dispatch = pattern.fused;
+        len = pattern.len;
+        break;
       }
     }
-    printf("]\n");
+    i += len;
+  }
+}
+
+inline void AggInterpreter::ExecLoadCol(const ColumnBatch& batch,
+                                        uint32_t row,
+                                        const DecodedInstr& ins) {
+  const unsigned char* data = batch.data(ins.index, row);
+  Register* reg = &registers_[ins.reg];
+  ResetRegister(reg);
+  reg->type = ins.type;
+  reg->is_unsigned = ins.is_unsigned;
+  reg->is_null = batch.is_null(ins.index, row);
+  switch (ins.type) {
+    case kTypeBigInt:
+      reg->value.val_int64 = longlongget(data);
+      break;
+    case kTypeDouble:
+      reg->value.val_double = doubleget(data);
+      break;
+    case kTypeDate:
+    case kTypeDatetime:
+    case kTypeTimestamp:
+      reg->value.val_int64 = longlongget(data);
+      break;
+    default:
+      break;
   }
 }
 
+inline void AggInterpreter::ExecLoadConst(const DecodedInstr& ins) {
+  Register* reg = &registers_[ins.reg];
+  ResetRegister(reg);
+  reg->type = ins.type;
+  reg->is_unsigned = ins.is_unsigned;
+  reg->is_null = false;
+  reg->value.val_uint64 = ins.imm;
+}
+
+// A negative result of a kernel is an overflow, which depends on the data.
+inline bool AggInterpreter::ExecArith(const DecodedInstr& ins) {
+  return ins.arith(registers_[ins.reg], registers_[ins.reg2],
+                   &registers_[ins.reg]) >= 0;
+}
+
+inline void AggInterpreter::ExecCmp(const DecodedInstr& ins) {
+  RegCmpReg(ins.op, registers_[ins.reg], registers_[ins.reg2],
+            &registers_[ins.reg]);
+}
+
+inline bool AggInterpreter::ExecAgg(const DecodedInstr& ins,
+                                    char* agg_state) {
+  AggResItem agg_res;
+  LoadAggRes(agg_state, ins.index, &agg_res);
+  int32_t ret = ins.agg(registers_[ins.reg], &agg_res);
+  StoreAggRes(agg_res, agg_state, ins.index);
+  return ret >= 0;
+}
+
+/*
+ * With GCC and Clang every handler jumps directly to the next one through a
+ * table of label addresses (threaded dispatch), which gives the branch
+ * predictor one indirect branch per handler instead of one shared by all.
+ * Other compilers use a switch in a loop.
+ */
+#if defined(__GNUC__)
+#define AGG_THREADED_DISPATCH
+#endif
+
+#ifdef AGG_THREADED_DISPATCH
+#define TARGET(name) target_##name:
+#define DISPATCH() goto *targets[ins->dispatch]
+#else
+#define TARGET(name) case name:
+#define DISPATCH() continue
+#endif
+
+// Return false if an operation or aggregation overflows
+bool AggInterpreter::Interpret(const ColumnBatch& batch, uint32_t row,
+                               char* agg_state) {
+  const DecodedInstr* ins = code_;
+
+#ifdef AGG_THREADED_DISPATCH
+  static const void* const targets[kDispatchTotal] = {
+    &&target_kDispatchEnd,
+    &&target_kDispatchNop,
+    &&target_kDispatchLoadCol,
+    &&target_kDispatchLoadConst,
+    &&target_kDispatchArith,
+    &&target_kDispatchCmp,
+    &&target_kDispatchAgg,
+    &&target_kDispatchLoadAgg,
+    &&target_kDispatchArithAgg,
+    &&target_kDispatchLoadArith,
+    &&target_kDispatchLoadArithAgg,
+    &&target_kDispatchLoad2Arith,
+    &&target_kDispatchLoad2ArithAgg,
+  };
+  DISPATCH();
+#else
+  for (;;) {
+    switch (ins->dispatch) {
+#endif
+      TARGET(kDispatchEnd)
+        return true;
+
+      TARGET(kDispatchNop)
+        ins++;
+        DISPATCH();
+
+      TARGET(kDispatchLoadCol)
+        ExecLoadCol(batch, row, ins[0]);
+        ins++;
+        DISPATCH();
+
+      TARGET(kDispatchLoadConst)
+        ExecLoadConst(ins[0]);
+        ins++;
+        DISPATCH();
+
+      TARGET(kDispatchArith)
+        if (!ExecArith(ins[0])) {
+          return false;
+        }
+        ins++;
+        DISPATCH();
+
+      TARGET(kDispatchCmp)
+        ExecCmp(ins[0]);
+        ins++;
+        DISPATCH();
+
+      TARGET(kDispatchAgg)
+        if (!ExecAgg(ins[0], agg_state)) {
+          return false;
+        }
+        ins++;
+        DISPATCH();
+
+      TARGET(kDispatchLoadAgg)
+        ExecLoadCol(batch, row, ins[0]);
+        if (!ExecAgg(ins[1], agg_state)) {
+          return false;
+        }
+        ins += 2;
+        DISPATCH();
+
+      TARGET(kDispatchArithAgg)
+        if (!ExecArith(ins[0])) {
+          return false;
+        }
+        if (!ExecAgg(ins[1], agg_state)) {
+          return false;
+        }
+        ins += 2;
+        DISPATCH();
+
+      TARGET(kDispatchLoadArith)
+        ExecLoadCol(batch, row, ins[0]);
+        if (!ExecArith(ins[1])) {
+          return false;
+        }
+        ins += 2;
+        DISPATCH();
+
+      TARGET(kDispatchLoadArithAgg)
+        ExecLoadCol(batch, row, ins[0]);
+        if (!ExecArith(ins[1])) {
+          return false;
+        }
+        if (!ExecAgg(ins[2], agg_state)) {
+          return false;
+        }
+        ins += 3;
+        DISPATCH();
+
+      TARGET(kDispatchLoad2Arith)
+        ExecLoadCol(batch, row, ins[0]);
+        ExecLoadCol(batch, row, ins[1]);
+        if (!ExecArith(ins[2])) {
+          return false;
+        }
+        ins += 3;
+        DISPATCH();
+
+      TARGET(kDispatchLoad2ArithAgg)
+        ExecLoadCol(batch, row, ins[0]);
+        ExecLoadCol(batch, row, ins[1]);
+        if (!ExecArith(ins[2])) {
+          return false;
+        }
+        if (!ExecAgg(ins[3], agg_state)) {
+          return false;
+        }
+        ins += 4;
+        DISPATCH();
+#ifndef AGG_THREADED_DISPATCH
+      default:
+        assert(0);
+        return false;
+    }
+  }
+#endif
+}
+
+#undef TARGET
+#undef DISPATCH
+
+/*
+ * Execute the decoded instructions one at a time, ignoring fusion, and add
+ * the cycles of each to its counters. Return false if an operation or
+ * aggregation overflows.
+ */
+bool AggInterpreter::InterpretWithStats(const ColumnBatch& batch,
+                                        uint32_t row, char* agg_state) {
+  uint64_t program_start = ReadCycleCounter();
+  uint32_t i = 0;
+  bool ok = true;
+  for (const DecodedInstr* ins = code_;
+       ok && ins->dispatch != kDispatchEnd; ins++, i++) {
+    uint64_t start = ReadCycleCounter();
+    switch (ins->op) {
+      case kOpLoadCol:
+        ExecLoadCol(batch, row, *ins);
+        break;
+      case kOpLoadConst:
+        ExecLoadConst(*ins);
+        break;
+      case kOpPlus:
+      case kOpMinus:
+      case kOpMul:
+      case kOpDiv:
+      case kOpMod:
+        ok = ExecArith(*ins);
+        break;
+      case kOpEq:
+      case kOpNe:
+      case kOpLt:
+      case kOpLe:
+      case kOpGt:
+      case kOpGe:
+        ExecCmp(*ins);
+        break;
+      case kOpCount:
+      case kOpSum:
+      case kOpMax:
+      case kOpMin:
+        ok = ExecAgg(*ins, agg_state);
+        break;
+      default:
+        break;
+    }
+    stats_->instr_cycles[i] += ReadCycleCounter() - start;
+    stats_->instr_count[i]++;
+  }
+  stats_->program_cycles += ReadCycleCounter() - program_start;
+  stats_->rows++;
+  if (mem_used_ > stats_->peak_state_bytes) {
+    stats_->peak_state_bytes = mem_used_;
+  }
+  return ok;
+}
+
+uint32_t HashEntry(const Entry& entry) {
+  // FNV-1a
+  uint32_t hash = 2166136261U;
+  for (uint32_t i = 0; i < entry.len; i++) {
+    hash ^= static_cast<unsigned char>(entry.ptr[i]);
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+/*
+ * Hash of a group key for radix partitioning, which takes the key 8 bytes at
+ * a time and mixes the result with the murmur3 64-bit finalizer. The top bits
+ * pick the partition and the low bits the slot in its tables.
+ */
+static uint32_t HashKey(const char* key, uint32_t len) {
+  uint64_t hash = len * 0x9E3779B97F4A7C15ULL;
+  uint64_t word;
+  uint32_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    memcpy(&word, key + i, sizeof(word));
+    hash = (hash ^ word) * 0x87C37B91114253D5ULL;
+    hash ^= hash >> 29;
+  }
+  if (i < len) {
+    word = 0;
+    memcpy(&word, key + i, len - i);
+    hash = (hash ^ word) * 0x87C37B91114253D5ULL;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  hash *= 0xC4CEB9FE1A85EC53ULL;
+  hash ^= hash >> 33;
+  return static_cast<uint32_t>(hash);
+}
+
+static inline uint32_t Align8(uint32_t len) {
+  return (len + 7) & ~7U;
+}
+
+static uint32_t RoundUpPow2(uint32_t n) {
+  uint32_t pow2 = 1;
+  while (pow2 < n) {
+    pow2 <<= 1;
+  }
+  return pow2;
+}
+
+void GroupTable::Init(uint32_t capacity, uint64_t* key_compares) {
+  slots_.assign(capacity, GroupSlot{nullptr, 0, 0});
+  n_groups_ = 0;
+  key_compares_ = key_compares;
+}
+
+GroupSlot* GroupTable::Find(const char* key, uint32_t key_len,
+                            uint32_t hash) {
+  uint32_t mask = slots_.size() - 1;
+  for (uint32_t i = hash & mask; ; i = (i + 1) & mask) {
+    GroupSlot* slot = &slots_[i];
+    if (slot->key == nullptr) {
+      return slot;
+    }
+    if (slot->hash == hash && slot->key_len == key_len) {
+      if (key_compares_) {
+        (*key_compares_)++;
+      }
+      if (memcmp(slot->key, key, key_len) == 0) {
+        return slot;
+      }
+    }
+  }
+}
+
+void GroupTable::Insert(GroupSlot* slot, char* key, uint32_t key_len,
+                        uint32_t hash) {
+  *slot = GroupSlot{key, key_len, hash};
+  if (++n_groups_ * 2 > slots_.size()) {
+    Grow();
+  }
+}
+
+void GroupTable::Grow() {
+  std::vector<GroupSlot> old(slots_.size() * 2, GroupSlot{nullptr, 0, 0});
+  old.swap(slots_);
+  uint32_t mask = slots_.size() - 1;
+  for (uint32_t i = 0; i < old.size(); i++) {
+    if (old[i].key == nullptr) {
+      continue;
+    }
+    uint32_t pos = old[i].hash & mask;
+    while (slots_[pos].key) {
+      pos = (pos + 1) & mask;
+    }
+    slots_[pos] = old[i];
+  }
+}
+
+/*
+ * Switch to partitioned aggregation: move the groups of the group map to the
+ * table of their partition, with enough partitions that each is about half
+ * the partition budget. Each group is moved as its allocation, so nothing is
+ * copied.
+ */
+void AggInterpreter::PartitionGroups() {
+  uint32_t radix_bits = 1;
+  while (radix_bits < kMaxRadixBits &&
+         mem_used_ > partition_budget_ << (radix_bits - 1)) {
+    radix_bits++;
+  }
+  max_tuple_len_ = 8 + Align8(agg_state_len_) + Align8(max_key_len_);
+  partitions_ = NewPartitions(radix_bits);
+  radix_bits_ = radix_bits;
+  mem_used_ = 0;
+  for (auto iter = gb_map_->begin(); iter != gb_map_->end(); iter++) {
+    const Entry& key = iter->first;
+    uint32_t hash = HashKey(key.ptr, key.len);
+    GroupTable& groups = partitions_[hash >> (32 - radix_bits_)].groups;
+    groups.Insert(groups.Find(key.ptr, key.len, hash), key.ptr, key.len,
+                  hash);
+    mem_used_ += agg_state_len_ + key.len + kSlotOverhead;
+  }
+  gb_map_->clear();
+  partitioned_ = true;
+}
+
+/*
+ * Allocate 1 << radix_bits empty partitions, with tables sized for an even
+ * share of the current groups. The tuple buffers share kTupleBufferBytes,
+ * but each is at most half the partition budget and at least one tuple with
+ * the longest key, and the tuple index of each is large enough for a buffer
+ * full of tuples with the shortest keys.
+ */
+RadixPartition* AggInterpreter::NewPartitions(uint32_t radix_bits) {
+  uint32_t n_partitions = 1U << radix_bits;
+  uint32_t buffer_len = kTupleBufferBytes >> radix_bits;
+  if (buffer_len > partition_budget_ / 2) {
+    buffer_len = partition_budget_ / 2;
+  }
+  if (buffer_len < kMinTupleBufferBytes) {
+    buffer_len = kMinTupleBufferBytes;
+  }
+  // FindTuple() appends to an empty buffer unchecked, so any tuple must fit
+  if (buffer_len < max_tuple_len_) {
+    buffer_len = max_tuple_len_;
+  }
+  uint32_t min_tuple_len = 8 + Align8(agg_state_len_) + 8;
+  uint32_t index_len = RoundUpPow2(2 * (buffer_len / min_tuple_len + 1));
+  uint32_t table_len = RoundUpPow2(4 * (n_groups_ >> radix_bits) + 16);
+  RadixPartition* partitions = new RadixPartition[n_partitions];
+  for (uint32_t i = 0; i < n_partitions; i++) {
+    partitions[i].tuples.resize(buffer_len);
+    partitions[i].tuples_len = 0;
+    partitions[i].tuple_index.assign(index_len, 0);
+    partitions[i].groups.Init(table_len,
+                              stats_ ? &stats_->key_compares : nullptr);
+  }
+  return partitions;
+}
+
+/*
+ * Split the groups into 1 << radix_bits partitions once the tuples have been
+ * merged. The groups move by the key hash kept in their slot, so nothing is
+ * copied or hashed again. Return false if a result overflows.
+ */
+bool AggInterpreter::SplitPartitions(uint32_t radix_bits) {
+  if (!MergeAllTuples()) {
+    return false;
+  }
+  RadixPartition* old = partitions_;
+  uint32_t n_old = n_partitions();
+  partitions_ = NewPartitions(radix_bits);
+  radix_bits_ = radix_bits;
+  for (uint32_t i = 0; i < n_old; i++) {
+    const GroupTable& old_groups = old[i].groups;
+    for (uint32_t j = 0; j < old_groups.capacity(); j++) {
+      const GroupSlot& slot = old_groups.slot(j);
+      if (slot.key == nullptr) {
+        continue;
+      }
+      GroupTable& groups = partitions_[slot.hash >> (32 - radix_bits_)].groups;
+      groups.Insert(groups.Find(slot.key, slot.key_len, slot.hash), slot.key,
+                    slot.key_len, slot.hash);
+    }
+  }
+  delete[] old;
+  if (stats_) {
+    stats_->partition_splits++;
+  }
+  return true;
+}
+
+/*
+ * Return the aggregation state of the tuple with the key in key_buf_ in the
+ * buffer of its partition, appending the tuple with an empty state if the
+ * buffer has none yet.
+ */
+char* AggInterpreter::FindTuple(uint32_t key_len, uint32_t* part) {
+  uint32_t hash = HashKey(key_buf_, key_len);
+  *part = hash >> (32 - radix_bits_);
+  RadixPartition& partition = partitions_[*part];
+  uint32_t state_len = Align8(agg_state_len_);
+  uint32_t mask = partition.tuple_index.size() - 1;
+  uint32_t i = hash & mask;
+  for (; partition.tuple_index[i]; i = (i + 1) & mask) {
+    char* tuple = partition.tuples.data() + partition.tuple_index[i] - 1;
+    uint32_t tuple_key_len, tuple_hash;
+    memcpy(&tuple_key_len, tuple, sizeof(uint32_t));
+    memcpy(&tuple_hash, tuple + 4, sizeof(uint32_t));
+    if (tuple_hash == hash && tuple_key_len == key_len &&
+        memcmp(tuple + 8 + state_len, key_buf_, key_len) == 0) {
+      if (stats_) {
+        stats_->tuple_hits++;
+      }
+      return tuple + 8;
+    }
+  }
+  char* tuple = partition.tuples.data() + partition.tuples_len;
+  partition.tuple_index[i] = partition.tuples_len + 1;
+  partition.tuples_len += 8 + state_len + Align8(key_len);
+  memcpy(tuple, &key_len, sizeof(uint32_t));
+  memcpy(tuple + 4, &hash, sizeof(uint32_t));
+  memset(tuple + 8, 0, agg_state_len_);
+  memcpy(tuple + 8 + state_len, key_buf_, key_len);
+  return tuple + 8;
+}
+
+/*
+ * Merge the tuples in the buffer of a partition into its groups and empty
+ * the buffer. Return false if a result overflows.
+ */
+bool AggInterpreter::MergeTuples(uint32_t part) {
+  RadixPartition& partition = partitions_[part];
+  if (partition.tuples_len == 0) {
+    return true;
+  }
+  uint32_t state_len = Align8(agg_state_len_);
+  const char* tuple = partition.tuples.data();
+  const char* end = tuple + partition.tuples_len;
+  bool ok = true;
+  if (stats_) {
+    stats_->tuple_merges++;
+  }
+  while (tuple < end) {
+    uint32_t key_len, hash;
+    memcpy(&key_len, tuple, sizeof(uint32_t));
+    memcpy(&hash, tuple + 4, sizeof(uint32_t));
+    const char* state = tuple + 8;
+    const char* key = state + state_len;
+    GroupSlot* slot = partition.groups.Find(key, key_len, hash);
+    if (slot->key) {
+      ok = MergeAggResults(state, slot->key - agg_state_len_) && ok;
+    } else {
+      uint32_t agg_rec_len = agg_state_len_ + key_len;
+      char* agg_rec = new char[agg_rec_len];
+      memcpy(agg_rec, state, agg_state_len_);
+      memcpy(agg_rec + agg_state_len_, key, key_len);
+      partition.groups.Insert(slot, agg_rec + agg_state_len_, key_len, hash);
+      n_groups_++;
+      mem_used_ += agg_rec_len + kSlotOverhead;
+      if (stats_) {
+        stats_->group_inserts++;
+      }
+    }
+    tuple = key + Align8(key_len);
+  }
+  partition.tuples_len = 0;
+  memset(partition.tuple_index.data(), 0,
+         partition.tuple_index.size() * sizeof(uint32_t));
+  return ok;
+}
+
+bool AggInterpreter::MergeAllTuples() {
+  bool ok = true;
+  for (uint32_t i = 0; i < n_partitions(); i++) {
+    ok = MergeTuples(i) && ok;
+  }
+  return ok;
+}
+
+// Whether some rows are still to be merged by MergeAllTuples()
+bool AggInterpreter::PartitionsPending() const {
+  for (uint32_t i = 0; i < n_partitions(); i++) {
+    if (partitions_[i].tuples_len) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Return the aggregation state of the group with the key, if any
+const char* AggInterpreter::FindGroup(const Entry& key) const {
+  if (partitioned_) {
+    uint32_t hash = HashKey(key.ptr, key.len);
+    GroupSlot* slot = partitions_[hash >> (32 - radix_bits_)].groups.Find(
+        key.ptr, key.len, hash);
+    return slot->key ? slot->key - agg_state_len_ : nullptr;
+  }
+  auto iter = gb_map_->find(key);
+  return iter != gb_map_->end() ? iter->second.ptr : nullptr;
+}
+
+/*
+ * Spill partition of a group key at the given level of splitting. The
+ * murmur3 finalizer mixes the level into the hash, so that the keys of one
+ * partition spread over all partitions of the next level.
+ */
+static uint32_t SpillPartitionOf(const Entry& key, uint32_t level) {
+  uint32_t hash = HashEntry(key) ^ (level * 0x9E3779B9U);
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6BU;
+  hash ^= hash >> 13;
+  hash *= 0xC2B2AE35U;
+  hash ^= hash >> 16;
+  return hash % kSpillPartitions;
+}
+
+// Each group is written as its key length (uint32_t), the key and the state.
+static bool WriteSpilledGroup(FILE* file, const char* key, uint32_t key_len,
+                              const char* state, uint32_t agg_len) {
+  return fwrite(&key_len, sizeof(uint32_t), 1, file) == 1 &&
+         fwrite(key, 1, key_len, file) == key_len &&
+         fwrite(state, 1, agg_len, file) == agg_len;
+}
+
+/*
+ * Read the next group of a spill file into a new allocation laid out as in
+ * the group map, the state followed by the key. Return 1 if a group was
+ * read, 0 at the end of the file and -1 if it could not be read.
+ */
+static int ReadSpilledGroup(FILE* file, uint32_t agg_len, char** agg_rec,
+                            uint32_t* key_len) {
+  if (fread(key_len, sizeof(uint32_t), 1, file) != 1) {
+    return ferror(file) ? -1 : 0;
+  }
+  *agg_rec = new char[agg_len + *key_len];
+  if (fread(*agg_rec + agg_len, 1, *key_len, file) != *key_len ||
+      fread(*agg_rec, 1, agg_len, file) != agg_len) {
+    delete[] *agg_rec;
+    return -1;
+  }
+  return 1;
+}
+
+/*
+ * Write all in-memory groups to the spill file of their hash partition and
+ * release them.
+ */
+bool AggInterpreter::SpillGroups() {
+  if (stats_) {
+    stats_->spills++;
+  }
+  for (auto iter = gb_map_->begin(); iter != gb_map_->end(); iter++) {
+    uint32_t part = SpillPartitionOf(iter->first, 0);
+    if (spill_files_[part] == nullptr) {
+      spill_files_[part] = tmpfile();
+      if (spill_files_[part] == nullptr) {
+        return false;
+      }
+    }
+    if (!WriteSpilledGroup(spill_files_[part], iter->first.ptr,
+                           iter->first.len, iter->second.ptr,
+                           agg_state_len_)) {
+      return false;
+    }
+  }
+  FreeGroups(gb_map_);
+  gb_map_->clear();
+  n_groups_ = 0;
+  mem_used_ = 0;
+  spilled_ = true;
+  return true;
+}
+
+/*
+ * Move the remaining in-memory groups to disk as well, then merge the
+ * spilled groups one partition at a time and pass them to sink, or print
+ * them without a sink. n_groups_ counts the merged groups.
+ */
+bool AggInterpreter::MergeSpilled(GroupSink sink, void* arg) {
+  if (!SpillGroups()) {
+    return false;
+  }
+  for (uint32_t part = 0; part < kSpillPartitions; part++) {
+    FILE* file = spill_files_[part];
+    if (file == nullptr) {
+      continue;
+    }
+    rewind(file);
+    bool ok = MergeSpillFile(file, 1, sink, arg);
+    // Later spills append to the end of the file.
+    fseek(file, 0, SEEK_END);
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Merge the groups of a spill file, which holds the partial results of a
+ * group once per spill, and pass them to sink. If the merged groups
+ * outgrow the memory budget, split the file by the hash of the next level
+ * instead and merge each part on its own.
+ */
+bool AggInterpreter::MergeSpillFile(FILE* file, uint32_t level,
+                                    GroupSink sink, void* arg) {
+  GroupMap map(EntryCmp(stats_ ? &stats_->key_compares : nullptr));
+  uint64_t used = 0;
+  bool split = false;
+  char* agg_rec;
+  uint32_t key_len;
+  int ret;
+  while ((ret = ReadSpilledGroup(file, agg_state_len_, &agg_rec,
+                                 &key_len)) > 0) {
+    Entry entry{agg_rec + agg_state_len_, key_len};
+    auto iter = map.find(entry);
+    if (iter != map.end()) {
+      bool merged = MergeAggResults(agg_rec, iter->second.ptr);
+      delete[] agg_rec;
+      if (!merged) {
+        ret = -1;
+        break;
+      }
+      continue;
+    }
+    map.insert(std::make_pair(entry, Entry{agg_rec, agg_state_len_}));
+    used += agg_state_len_ + key_len + kGroupOverhead;
+    if (used > mem_budget_ && level < kMaxSpillLevels) {
+      split = true;
+      break;
+    }
+  }
+  if (ret == 0) {
+    for (auto iter = map.begin(); iter != map.end(); iter++) {
+      EmitGroup(iter->first.ptr, iter->first.len, iter->second.ptr, sink,
+                arg);
+      n_groups_++;
+    }
+  }
+  FreeGroups(&map);
+  if (!split) {
+    return ret == 0;
+  }
+  FILE* parts[kSpillPartitions];
+  rewind(file);
+  bool ok = SplitSpillFile(file, level, parts);
+  for (uint32_t i = 0; i < kSpillPartitions; i++) {
+    if (parts[i]) {
+      ok = ok && MergeSpillFile(parts[i], level + 1, sink, arg);
+      fclose(parts[i]);
+    }
+  }
+  return ok;
+}
+
+/*
+ * Write each group of a spill file to the part file of its partition at
+ * the given level, creating the part files as needed, and rewind them.
+ * The caller closes the part files, also on failure.
+ */
+bool AggInterpreter::SplitSpillFile(FILE* file, uint32_t level,
+                                    FILE** parts) {
+  memset(parts, 0, kSpillPartitions * sizeof(FILE*));
+  if (stats_) {
+    stats_->spills++;
+  }
+  char* agg_rec;
+  uint32_t key_len;
+  int ret;
+  while ((ret = ReadSpilledGroup(file, agg_state_len_, &agg_rec,
+                                 &key_len)) > 0) {
+    Entry key{agg_rec + agg_state_len_, key_len};
+    FILE*& part = parts[SpillPartitionOf(key, level)];
+    if (part == nullptr) {
+      part = tmpfile();
+    }
+    bool ok = part != nullptr &&
+              WriteSpilledGroup(part, key.ptr, key_len, agg_rec,
+                                agg_state_len_);
+    delete[] agg_rec;
+    if (!ok) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < kSpillPartitions; i++) {
+    if (parts[i]) {
+      rewind(parts[i]);
+    }
+  }
+  return ret == 0;
+}
+
+bool AggInterpreter::MergeAggResults(const char* src, char* dst) {
+  AggResItem src_item;
+  AggResItem dst_item;
+  for (uint32_t i = 0; i < n_agg_results_; i++) {
+    LoadAggRes(src, i, &src_item);
+    LoadAggRes(dst, i, &dst_item);
+    Register reg;
+    reg.type = src_item.type;
+    reg.value = src_item.value;
+    reg.is_unsigned = src_item.is_unsigned;
+    reg.is_null = false;
+    int32_t ret = 0;
+    switch (agg_ops_[i]) {
+      case kOpCount:
+        dst_item.value.val_uint64 += src_item.value.val_uint64;
+        // Set by Count() once it has counted a row
+        dst_item.is_unsigned |= src_item.is_unsigned;
+        break;
+      case kOpSum:
+        ret = Sum(reg, &dst_item);
+        break;
+      case kOpMax:
+        if (src_item.type == kTypeDouble || src_item.inited) {
+          ret = Max(reg, &dst_item);
+        }
+        break;
+      case kOpMin:
+        if (src_item.type == kTypeDouble || src_item.inited) {
+          ret = Min(reg, &dst_item);
+        }
+        break;
+      default:
+        break;
+    }
+    if (ret < 0) {
+      return false;
+    }
+    StoreAggRes(dst_item, dst, i);
+  }
+  return true;
+}
+
+void AggInterpreter::LoadAggRes(const char* state, uint32_t i,
+                                AggResItem* item) {
+  const uint8_t* inited_bits = reinterpret_cast<const uint8_t*>(state) +
+                               n_agg_results_ * sizeof(DataValue);
+  const uint8_t* unsigned_bits = inited_bits + (n_agg_results_ + 7) / 8;
+  item->type = agg_types_[i];
+  item->value = reinterpret_cast<const DataValue*>(state)[i];
+  item->inited = (inited_bits[i >> 3] >> (i & 7)) & 1;
+  item->is_unsigned = (unsigned_bits[i >> 3] >> (i & 7)) & 1;
+}
+
+void AggInterpreter::StoreAggRes(const AggResItem& item, char* state,
+                                 uint32_t i) {
+  uint8_t* inited_bits = reinterpret_cast<uint8_t*>(state) +
+                         n_agg_results_ * sizeof(DataValue);
+  uint8_t* unsigned_bits = inited_bits + (n_agg_results_ + 7) / 8;
+  uint8_t mask = 1 << (i & 7);
+  reinterpret_cast<DataValue*>(state)[i] = item.value;
+  inited_bits[i >> 3] = item.inited ? (inited_bits[i >> 3] | mask) :
+                                      (inited_bits[i >> 3] & ~mask);
+  unsigned_bits[i >> 3] = item.is_unsigned ? (unsigned_bits[i >> 3] | mask) :
+                                             (unsigned_bits[i >> 3] & ~mask);
+}
+
+bool AggInterpreter::SameResults(const AggInterpreter& other) const {
+  if (spilled_ || other.spilled_ || n_gb_cols_ != other.n_gb_cols_ ||
+      agg_state_len_ != other.agg_state_len_) {
+    return false;
+  }
+  if (n_gb_cols_ == 0) {
+    return memcmp(agg_results_, other.agg_results_, agg_state_len_) == 0;
+  }
+  /*
+   * The groups may be held differently, e.g. when only one of the two
+   * switched to partitioned aggregation, so they are looked up by key.
+   */
+  if (PartitionsPending() || other.PartitionsPending() ||
+      n_groups_ != other.n_groups_) {
+    return false;
+  }
+  for (uint32_t i = 0; i < n_partitions(); i++) {
+    const GroupTable& groups = partitions_[i].groups;
+    for (uint32_t j = 0; j < groups.capacity(); j++) {
+      const GroupSlot& slot = groups.slot(j);
+      if (slot.key == nullptr) {
+        continue;
+      }
+      const char* other_state = other.FindGroup(Entry{slot.key,
+                                                      slot.key_len});
+      if (other_state == nullptr ||
+          memcmp(slot.key - agg_state_len_, other_state, agg_state_len_)) {
+        return false;
+      }
+    }
+  }
+  for (auto iter = gb_map_->begin(); iter != gb_map_->end(); iter++) {
+    const char* other_state = other.FindGroup(iter->first);
+    if (other_state == nullptr ||
+        memcmp(iter->second.ptr, other_state, agg_state_len_)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void AggInterpreter::FreeGroups(GroupMap* map) {
+  // The group key and its aggregation state share one allocation.
+  for (auto iter = map->begin(); iter != map->end(); iter++) {
+    delete[] iter->second.ptr;
+  }
+}
+
+void AggInterpreter::FreePartitions() {
+  for (uint32_t i = 0; i < n_partitions(); i++) {
+    const GroupTable& groups = partitions_[i].groups;
+    for (uint32_t j = 0; j < groups.capacity(); j++) {
+      if (groups.slot(j).key) {
+        delete[] (groups.slot(j).key - agg_state_len_);
+      }
+    }
+  }
+  delete[] partitions_;
+}
+
+void PrintAggResItem(const AggResItem& item) {
+  char buf[32];
+  switch (item.type) {
+    case kTypeBigInt:
+      printf("    (kTypeBigInt: %ld)\n", item.value.val_int64);
+      break;
+
+    case kTypeDouble:
+      printf("    (kTypeDouble: %.16f)\n", item.value.val_double);
+      break;
+
+    case kTypeDate:
+      FormatTemporal(item.type, item.value.val_int64, buf, sizeof(buf));
+      printf("    (kTypeDate: %s)\n", buf);
+      break;
+
+    case kTypeDatetime:
+      FormatTemporal(item.type, item.value.val_int64, buf, sizeof(buf));
+      printf("    (kTypeDatetime: %s)\n", buf);
+      break;
+
+    case kTypeTimestamp:
+      FormatTemporal(item.type, item.value.val_int64, buf, sizeof(buf));
+      printf("    (kTypeTimestamp: %s)\n", buf);
+      break;
+    default:
+      assert(0);
+  }
+}
+
+void AggInterpreter::Print() {
+  if (n_gb_cols_) {
+    if (gb_map_) {
+      printf("Group by columns: [");
+      for (uint32_t i = 0; i < n_gb_cols_; i++) {
+        TemporalUnit unit =
+          static_cast<TemporalUnit>((gb_cols_[i] >> 16) & 0xF);
+        if (unit != kUnitNone) {
+          printf("%s(%u) ", TemporalUnitName(unit), gb_cols_[i] & 0xFFFF);
+        } else {
+          printf("%u ", gb_cols_[i]);
+        }
+      }
+      printf("]\n");
+
+      if (sorted_input_) {
+        Finish();
+        return;
+      }
+      if (partitioned_ && !MergeAllTuples()) {
+        printf("Failed to merge partitioned group by results\n");
+        return;
+      }
+      if (!spilled_) {
+        for (uint32_t i = 0; i < n_partitions(); i++) {
+          PrintPartition(partitions_[i]);
+        }
+        PrintGroups(gb_map_);
+        return;
+      }
+      if (!MergeSpilled(nullptr, nullptr)) {
+        printf("Failed to merge spilled group by results\n");
+      }
+    }
+  } else {
+    printf("Aggregation result: [\n");
+    AggResItem item;
+    for (uint32_t i = 0; i < n_agg_results_; i++) {
+      LoadAggRes(agg_results_, i, &item);
+      PrintAggResItem(item);
+    }
+    printf("]\n");
+  }
+}
+
+void AggInterpreter::PrintGroups(GroupMap* map) {
+  for (auto iter = map->begin(); iter != map->end(); iter++) {
+    PrintGroup(iter->first.ptr, iter->first.len, iter->second.ptr);
+  }
+}
+
+void AggInterpreter::PrintPartition(const RadixPartition& partition) {
+  for (uint32_t i = 0; i < partition.groups.capacity(); i++) {
+    const GroupSlot& slot = partition.groups.slot(i);
+    if (slot.key) {
+      PrintGroup(slot.key, slot.key_len, slot.key - agg_state_len_);
+    }
+  }
+}
+
+void AggInterpreter::PrintGroup(const char* key, uint32_t key_len,
+                                const char* state) {
+  printf("Group [%p, %u], Aggregation result: [\n",
+      reinterpret_cast<const void*>(key), key_len);
+  AggResItem item;
+  for (uint32_t i = 0; i < n_agg_results_; i++) {
+    LoadAggRes(state, i, &item);
+    PrintAggResItem(item);
+  }
+  printf("]\n");
+}
+
+static const char* OpName(uint8_t op) {
+  static const char* names[kOpTotal] = {
+    "UNKNOWN", "PLUS", "MINUS", "MUL", "DIV", "MOD", "LOADCOL", "STORE",
+    "SUM", "MAX", "MIN", "COUNT", "LOADCONST", "EQ", "NE", "LT", "LE", "GT",
+    "GE"
+  };
+  return op < kOpTotal ? names[op] : "UNKNOWN";
+}
+
+static double Percent(uint64_t part, uint64_t total) {
+  return total ? 100.0 * part / total : 0.0;
+}
+
+static double PerRow(uint64_t value, uint64_t rows) {
+  return rows ? static_cast<double>(value) / rows : 0.0;
+}
+
+void AggInterpreter::PrintPerf() {
+  if (perf_ == nullptr) {
+    printf("Performance counters are not collected\n");
+    return;
+  }
+  printf("-> Aggregate: %lu rows, %u groups%s\n", perf_rows_, n_groups_,
+         jit_ ? ", compiled" : "");
+  perf_->Print(perf_values_, perf_rows_, "   ");
+}
+
+void AggInterpreter::PrintStats() {
+  if (stats_ == nullptr) {
+    printf("Statistics are not collected\n");
+    return;
+  }
+  const AggStats& st = *stats_;
+  uint64_t total = st.group_cycles + st.program_cycles;
+  uint64_t instr_total = 0;
+  for (uint32_t i = 0; i < st.instr_cycles.size(); i++) {
+    instr_total += st.instr_cycles[i];
+  }
+
+  printf("-> Aggregate: %lu rows, %u groups, %lu bytes of group state "
+         "(peak %lu), %lu spills, %lu cycles (%.1f/row)\n",
+         st.rows, n_groups_, mem_used_, st.peak_state_bytes, st.spills,
+         total, PerRow(total, st.rows));
+  if (partitioned_) {
+    printf("   -> Partitioned: %u partitions after %lu splits, %lu merges "
+           "of tuple buffers, %lu rows (%.1f%%) pre-aggregated\n",
+           n_partitions(), st.partition_splits, st.tuple_merges,
+           st.tuple_hits, Percent(st.tuple_hits, st.rows));
+  }
+  if (n_gb_cols_) {
+    printf("   -> Group lookup: %lu probes, %lu inserts, %lu key compares "
+           "(%.1f/probe), %lu cycles (%.1f/row, %.1f%%)\n",
+           st.group_probes, st.group_inserts, st.key_compares,
+           PerRow(st.key_compares, st.group_probes), st.group_cycles,
+           PerRow(st.group_cycles, st.rows),
+           Percent(st.group_cycles, total));
+  }
+  printf("   -> Program: %lu instructions, %lu cycles (%.1f/row, %.1f%%), "
+         "of which dispatch and timing %lu\n",
+         static_cast<uint64_t>(st.instr_cycles.size()), st.program_cycles,
+         PerRow(st.program_cycles, st.rows),
+         Percent(st.program_cycles, total),
+         st.program_cycles > instr_total ? st.program_cycles - instr_total : 0);
+  for (uint32_t i = 0; i < st.instr_cycles.size(); i++) {
+    const DecodedInstr& ins = code_[i];
+    char operands[32];
+    switch (ins.op) {
+      case kOpLoadCol:
+        snprintf(operands, sizeof(operands), "r%u, col %u", ins.reg,
+                 ins.index);
+        break;
+      case kOpLoadConst:
+        snprintf(operands, sizeof(operands), "r%u, 0x%lx", ins.reg, ins.imm);
+        break;
+      case kOpCount:
+      case kOpSum:
+      case kOpMax:
+      case kOpMin:
+        snprintf(operands, sizeof(operands), "res %u, r%u", ins.index,
+                 ins.reg);
+        break;
+      default:
+        snprintf(operands, sizeof(operands), "r%u, r%u", ins.reg, ins.reg2);
+        break;
+    }
+    printf("      #%-3u %-9s %-22s count=%lu cycles=%lu (%.1f/row, %.1f%%)\n",
+           i, OpName(ins.op), operands, st.instr_count[i],
+           st.instr_cycles[i], PerRow(st.instr_cycles[i], st.rows),
+           Percent(st.instr_cycles[i], total));
+  }
+
+  // Totals per op, to tell load-, arithmetic- and aggregation-bound apart
+  uint64_t op_count[kOpTotal] = {0};
+  uint64_t op_cycles[kOpTotal] = {0};
+  for (uint32_t i = 0; i < st.instr_cycles.size(); i++) {
+    op_count[code_[i].op] += st.instr_count[i];
+    op_cycles[code_[i].op] += st.instr_cycles[i];
+  }
+  printf("   -> By op:\n");
+  for (uint32_t op = 0; op < kOpTotal; op++) {
+    if (op_count[op]) {
+      printf("      %-9s count=%lu cycles=%lu (%.1f/execution, %.1f%%)\n",
+             OpName(op), op_count[op], op_cycles[op],
+             PerRow(op_cycles[op], op_count[op]),
+             Percent(op_cycles[op], total));
+    }
+  }
+}
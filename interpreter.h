@@ -7,10 +7,17 @@
 #define INTERPRETER_H_
 
 #include <math.h>
+#include <stdio.h>
 #include <map>
+#include <vector>
 
+#include "column_batch.h"
+#include "jit.h"
 #include "my_byteorder.h"
 #include "record.h"
+#include "perf_counters.h"
+#include "stats.h"
+#include "temporal.h"
 
 struct Entry {
   char *ptr;
@@ -30,6 +37,22 @@ enum InterpreterOp {
   kOpMax,
   kOpMin,
   kOpCount,
+  /*
+   * LOADCONST is followed by two words holding the low and high 32 bits of
+   * a 64-bit immediate of the given type.
+   */
+  kOpLoadConst,
+  /*
+   * Comparisons use the same encoding as the arithmetic ops and store 1, 0
+   * or NULL as a BIGINT in the first register. Temporal values are compared
+   * as their packed integers.
+   */
+  kOpEq,
+  kOpNe,
+  kOpLt,
+  kOpLe,
+  kOpGt,
+  kOpGe,
   kOpTotal
 };
 
@@ -46,7 +69,16 @@ enum InterpreterRegisters {
 };
 
 struct EntryCmp {
+  // Counts the comparisons when not null, see AggStats::key_compares
+  uint64_t* n_compares;
+
+  EntryCmp() : n_compares(nullptr) {}
+  explicit EntryCmp(uint64_t* counter) : n_compares(counter) {}
+
   bool operator() (const Entry& n1, const Entry& n2) const {
+    if (n_compares) {
+      (*n_compares)++;
+    }
     uint32_t len = n1.len > n2.len ?
                     n2.len : n1.len;
 
@@ -74,6 +106,10 @@ struct Register {
   bool is_null;
 };
 
+/*
+ * Unpacked view of one aggregation result, used while updating it. The
+ * results are stored packed, see AggInterpreter::LoadAggRes().
+ */
 struct AggResItem {
   DataType type;
   DataValue value;
@@ -81,45 +117,537 @@ struct AggResItem {
   bool inited;  // used by Min/Max
 };
 
+/*
+ * The kernels return 0 on success, 1 if the result is NULL and -1 on
+ * overflow or a type error.
+ */
+int32_t RegPlusReg(const Register& a, const Register& b, Register* res);
+int32_t RegMinusReg(const Register& a, const Register& b, Register* res);
+int32_t RegMulReg(const Register& a, const Register& b, Register* res);
+int32_t RegDivReg(const Register& a, const Register& b, Register* res);
+int32_t RegModReg(const Register& a, const Register& b, Register* res);
+int32_t RegCmpReg(uint8_t op, const Register& a, const Register& b,
+                  Register* res);
+int32_t Min(const Register& a, AggResItem* res);
+int32_t Max(const Register& a, AggResItem* res);
+int32_t Count(const Register& a, AggResItem* res);
+int32_t Sum(const Register& a, AggResItem* res);
+bool DecodeRawType(uint8_t type, DataType* res);
+
+typedef int32_t (*ArithFunc)(const Register& a, const Register& b,
+                             Register* res);
+typedef int32_t (*AggFunc)(const Register& a, AggResItem* res);
+
+/*
+ * Handlers of the threaded interpreter. Besides one handler per kind of
+ * instruction there are superinstructions that execute a run of adjacent
+ * instructions with a single dispatch, where L is a LOADCOL, A an arithmetic
+ * op and G an aggregation: e.g. kDispatchLoad2ArithAgg executes the LLAG of
+ * sum(a+c).
+ */
+enum DispatchOp {
+  kDispatchEnd = 0,
+  kDispatchNop,
+  kDispatchLoadCol,
+  kDispatchLoadConst,
+  kDispatchArith,
+  kDispatchCmp,
+  kDispatchAgg,
+  kDispatchLoadAgg,
+  kDispatchArithAgg,
+  kDispatchLoadArith,
+  kDispatchLoadArithAgg,
+  kDispatchLoad2Arith,
+  kDispatchLoad2ArithAgg,
+  kDispatchTotal
+};
+
+/*
+ * An instruction decoded once in Init(), so that the interpreter does not
+ * decode the packed words for every row. A superinstruction is dispatched
+ * through its first instruction and reads the operands of the following
+ * ones from their own entries.
+ */
+struct DecodedInstr {
+  uint8_t dispatch;
+  uint8_t op;
+  uint8_t reg;   // LOADCOL/LOADCONST/aggregation register, or first operand
+  uint8_t reg2;  // second operand of arithmetic and comparisons
+  bool is_unsigned;
+  DataType type;
+  uint32_t index;  // column or aggregation result
+  union {
+    ArithFunc arith;
+    AggFunc agg;
+    uint64_t imm;  // LOADCONST
+  };
+};
+
+typedef std::map<Entry, Entry, EntryCmp> GroupMap;
+
+/*
+ * Receives a group: its key as stored in the group map, i.e. per group by
+ * column a NULL indicator byte followed by the value unless it is NULL, and
+ * its aggregation results.
+ */
+typedef void (*GroupSink)(void* arg, const char* key, uint32_t key_len,
+                          const AggResItem* results, uint32_t n_results);
+
+/*
+ * Number of partitions the group map is split into when it exceeds the memory
+ * budget. Each partition is spilled to its own temporary file and merged back
+ * separately, so merging needs roughly 1/kSpillPartitions of the total state.
+ * A partition whose groups still exceed the budget is split again the same
+ * way with another hash seed, at most kMaxSpillLevels levels deep, below
+ * which it is merged whatever its size.
+ */
+static const uint32_t kSpillPartitions = 16;
+static const uint32_t kMaxSpillLevels = 6;
+/*
+ * Estimated bookkeeping cost of one std::map node on top of the group key and
+ * the aggregation results (red-black node header plus malloc overhead).
+ */
+static const uint32_t kGroupOverhead =
+  sizeof(std::pair<const Entry, Entry>) + 4 * sizeof(void*) + 16;
+/*
+ * Partitioned aggregation splits the groups by the top bits of their key
+ * hash, see AggInterpreter::set_partition_budget(). The number of bits is
+ * picked from the size of the groups so that each partition stays within the
+ * partition budget, and raised as the groups grow, up to kMaxRadixBits.
+ */
+static const uint32_t kMaxRadixBits = 10;
+static const uint32_t kNoPartition = ~0U;  // A row not in a tuple buffer
+/*
+ * Default size of the groups of one partition, about what stays in the L2
+ * cache. The group map switches to partitioned once it is this large.
+ */
+static const uint64_t kPartitionBudget = 1ULL << 20;
+/*
+ * Size of the tuple buffers of all partitions together, each of which is
+ * merged into the groups of its partition when it is full. A buffer takes at
+ * most half the partition budget, but at least kMinTupleBufferBytes however
+ * many partitions there are, and never less than the longest tuple.
+ */
+static const uint32_t kTupleBufferBytes = 1 << 20;
+static const uint32_t kMinTupleBufferBytes = 4 << 10;
+
+/*
+ * A group of a radix partition: its key, which follows the aggregation state
+ * in one allocation like in the group map, and the hash of the key.
+ */
+struct GroupSlot {
+  char* key;  // nullptr if the slot is free
+  uint32_t key_len;
+  uint32_t hash;
+};
+/*
+ * Estimated bookkeeping cost of a group of a radix partition on top of the
+ * group key and the aggregation results: its slots at a load between 1/4 and
+ * 1/2, plus malloc overhead.
+ */
+static const uint32_t kSlotOverhead = 3 * sizeof(GroupSlot) + 16;
+
+/*
+ * Open-addressing hash table of the groups of a radix partition, probed
+ * linearly from the low bits of the key hash. The capacity is a power of
+ * two, and the table doubles once half full so that probes stay short.
+ */
+class GroupTable {
+ public:
+  GroupTable() : n_groups_(0), key_compares_(nullptr) {}
+  // key_compares, if not nullptr, counts the key comparisons of Find()
+  void Init(uint32_t capacity, uint64_t* key_compares);
+  // The slot holding the key, or the free slot where it belongs
+  GroupSlot* Find(const char* key, uint32_t key_len, uint32_t hash);
+  // Fill the free slot returned by Find(), which invalidates other slots
+  void Insert(GroupSlot* slot, char* key, uint32_t key_len, uint32_t hash);
+  uint32_t capacity() const {
+    return slots_.size();
+  }
+  const GroupSlot& slot(uint32_t i) const {
+    return slots_[i];
+  }
+
+ private:
+  std::vector<GroupSlot> slots_;
+  uint32_t n_groups_;
+  uint64_t* key_compares_;
+  void Grow();
+};
+
+struct RadixPartition {
+  /*
+   * The rows not merged yet, each as a tuple of 8-byte aligned parts: the
+   * key length and key hash (uint32_t each), the aggregation state and the
+   * key. Rows with the key of a tuple in the buffer are aggregated into it,
+   * found through tuple_index, an open-addressing table of the offsets + 1
+   * of the tuples (0 if free) that is never more than half full.
+   */
+  std::vector<char> tuples;
+  uint32_t tuples_len;
+  std::vector<uint32_t> tuple_index;
+  GroupTable groups;
+};
+
 class AggInterpreter {
  public:
-  AggInterpreter(const uint32_t* prog, uint32_t prog_len):
+  /*
+   * mem_budget is the maximum number of bytes the group map may occupy before
+   * it is spilled to disk. 0 means unlimited.
+   */
+  AggInterpreter(const uint32_t* prog, uint32_t prog_len,
+                 uint64_t mem_budget = 0):
     prog_(prog), prog_len_(prog_len), cur_pos_(0),
     inited_(false), n_gb_cols_(0), gb_cols_(nullptr),
     n_agg_results_(0),
-    agg_results_(nullptr), agg_prog_start_pos_(0),
-    gb_map_(nullptr), n_groups_(0) {
+    agg_types_(nullptr), agg_state_len_(0),
+    agg_results_(nullptr), agg_ops_(nullptr), agg_prog_start_pos_(0),
+    gb_map_(nullptr), n_groups_(0), key_buf_(nullptr), max_key_len_(0),
+    sorted_input_(false), sink_(nullptr), sink_arg_(nullptr),
+    cur_group_(nullptr), cur_key_len_(0), emit_items_(nullptr),
+    partition_budget_(kPartitionBudget), partitioned_(false),
+    partitions_(nullptr), radix_bits_(0), max_tuple_len_(0),
+    mem_budget_(mem_budget), mem_used_(0), spilled_(false),
+    col_mask_(0), batch_(nullptr), code_(nullptr),
+    use_jit_(false), jit_(nullptr), jit_cols_(nullptr), jit_nulls_(nullptr),
+    stats_(nullptr), perf_(nullptr), perf_rows_(0) {
+    memset(spill_files_, 0, sizeof(spill_files_));
+    init_error_[0] = '\0';
   }
   ~AggInterpreter() {
     delete[] gb_cols_;
+    delete[] agg_types_;
     delete[] agg_results_;
+    delete[] agg_ops_;
+    delete[] key_buf_;
+    delete[] cur_group_;
+    delete[] emit_items_;
+    delete batch_;
+    delete[] code_;
+    delete jit_;
+    delete[] jit_cols_;
+    delete[] jit_nulls_;
+    delete stats_;
+    delete perf_;
     if (gb_map_) {
-      for (auto iter = gb_map_->begin(); iter != gb_map_->end(); iter++) {
-        delete[] iter->first.ptr;
-      }
+      FreeGroups(gb_map_);
       delete gb_map_;
     }
+    if (partitions_) {
+      FreePartitions();
+    }
+    for (uint32_t i = 0; i < kSpillPartitions; i++) {
+      if (spill_files_[i]) {
+        fclose(spill_files_[i]);
+      }
+    }
   }
 
+  /*
+   * Parse and verify the program. Return false if it is malformed, see
+   * init_error(). ProcessRec() may only be called after Init() succeeded.
+   */
   bool Init();
+  bool inited() {
+    return inited_;
+  }
+  const char* init_error() {
+    return init_error_;
+  }
 
+  /*
+   * Aggregate a record. Return false if an operation or aggregation
+   * overflows, in the JIT too, after which the results are not valid.
+   */
   bool ProcessRec(Record* rec);
+  /*
+   * Process a batch of records, stopping at the first failure. Same as
+   * calling ProcessRec() on each, but the columns are loaded a
+   * ColumnBatch at a time, and the performance counters, if collected,
+   * are read once per call instead of once per record.
+   */
+  bool ProcessRecs(Record* const* recs, uint32_t n_recs);
+  /*
+   * Process the rows of a batch loaded by the caller, e.g. a SharedScan.
+   * The batch must have loaded the columns in col_mask().
+   */
+  bool ProcessBatch(const ColumnBatch& batch);
+  /*
+   * Print the results. In sorted-input mode, the groups have already been
+   * emitted, and Print() only finishes the last one. Partitioned and spilled
+   * groups are printed one partition at a time.
+   */
   void Print();
+  /*
+   * Pass each group to sink, in key order, or in key order within each
+   * partition after partitioned aggregation or spilling. Spilled groups are
+   * merged back from disk one partition at a time, so the key and results
+   * passed to sink are only valid during the call. Return false if merging
+   * the partitions failed.
+   */
+  bool ForEachGroup(GroupSink sink, void* arg);
+  /*
+   * Call it after the last record. In sorted-input mode, emit the current
+   * group. After switching to partitioned aggregation, merge the rows that
+   * are still buffered, which returns false if a result overflows.
+   */
+  bool Finish();
+  /*
+   * EXPLAIN ANALYZE style report of where the time went, per instruction
+   * and for the group lookups. Requires set_collect_stats().
+   */
+  void PrintStats();
+  /*
+   * Report of the performance counters per processed row. Requires
+   * set_collect_perf().
+   */
+  void PrintPerf();
+
+  /*
+   * With partitioned aggregation, valid after Finish(). Once spilled, only
+   * the groups in memory are counted until ForEachGroup() or Print() has
+   * merged the spilled ones.
+   */
+  uint32_t n_groups() {
+    return n_groups_;
+  }
+  // Bit i is set if the program reads column i, valid after Init()
+  uint32_t col_mask() {
+    return col_mask_;
+  }
+  uint64_t mem_used() {
+    return mem_used_;
+  }
+  bool spilled() {
+    return spilled_;
+  }
+  /*
+   * Compile the program to native code in Init() instead of interpreting
+   * it. Init() falls back to the interpreter if the program can't be
+   * compiled, see jit_compiled().
+   */
+  void set_use_jit(bool use_jit) {
+    use_jit_ = use_jit;
+  }
+  bool jit_compiled() {
+    return jit_ != nullptr;
+  }
+  /*
+   * Collect AggStats, which must be enabled before Init(). While collecting,
+   * the instructions are timed one by one with the cycle counter instead of
+   * running fused or compiled, so the numbers show the relative cost of
+   * each instruction rather than the fastest execution. When disabled, the
+   * cost is a few predictable branches per row.
+   */
+  void set_collect_stats(bool collect_stats) {
+    if (inited_) {
+      return;
+    }
+    if (collect_stats && stats_ == nullptr) {
+      stats_ = new AggStats;
+    } else if (!collect_stats) {
+      delete stats_;
+      stats_ = nullptr;
+    }
+  }
+  const AggStats* stats() {
+    return stats_;
+  }
+  /*
+   * Sorted-input mode, which must be enabled before Init(). The records
+   * must arrive ordered by the group by columns, e.g. from an ordered index
+   * scan. Only the state of the current group is kept, and it is passed to
+   * sink as soon as a record with another key arrives, or by Finish() for
+   * the last group. Without a sink, the groups are printed as by Print().
+   * Memory use doesn't grow with the number of groups, and nothing is
+   * spilled. If the records are not sorted, a group is emitted once for
+   * each run of records with its key. No effect without group by columns.
+   */
+  void set_sorted_input(GroupSink sink, void* arg) {
+    if (inited_) {
+      return;
+    }
+    sorted_input_ = true;
+    sink_ = sink;
+    sink_arg_ = arg;
+  }
+  bool sorted_input() {
+    return sorted_input_;
+  }
+  /*
+   * Size in bytes the group map may grow to before aggregation switches to
+   * radix partitioning, which must be set before Init(). 0 keeps a single
+   * group map. With more groups than fit in the cache, nearly every lookup
+   * in one big map misses it. After switching, the groups are split by the
+   * top bits of their key hash into enough hash tables that each holds
+   * about half the budget, and the tables are split again whenever they
+   * average more than the budget. Each row is aggregated into a tuple in
+   * the buffer of its partition, which rows with the same key share. When
+   * the buffer is full, all its tuples are merged into the table of the
+   * partition in one go, so that the table stays in the cache meanwhile.
+   * Not used in sorted-input mode, nor with a memory budget, where spilling
+   * partitions the groups instead.
+   */
+  void set_partition_budget(uint64_t partition_budget) {
+    if (inited_) {
+      return;
+    }
+    partition_budget_ = partition_budget;
+  }
+  bool partitioned() {
+    return partitioned_;
+  }
+  /*
+   * Count hardware events such as cycles, instructions, branch and cache
+   * misses while processing records, which must be enabled before Init().
+   * The counters belong to the calling thread, so all ProcessRec() calls
+   * must be made from the thread that called Init().
+   */
+  void set_collect_perf(bool collect_perf) {
+    if (inited_) {
+      return;
+    }
+    if (collect_perf && perf_ == nullptr) {
+      perf_ = new PerfCounters;
+    } else if (!collect_perf) {
+      delete perf_;
+      perf_ = nullptr;
+    }
+  }
+  const PerfCounters* perf() {
+    return perf_;
+  }
+  const PerfValues& perf_values() {
+    return perf_values_;
+  }
+  uint64_t perf_rows() {
+    return perf_rows_;
+  }
+  /*
+   * Compare the results with those of another interpreter running the same
+   * program, e.g. one with and one without the JIT. Spilled results are not
+   * compared, and partitioned ones only after Finish().
+   */
+  bool SameResults(const AggInterpreter& other) const;
 
  private:
   const uint32_t* prog_;
   uint32_t prog_len_;
   uint32_t cur_pos_;
   bool inited_;
+  char init_error_[64];
   Register registers_[kRegTotal];
 
   uint32_t n_gb_cols_;
+  /*
+   * Bits 0-15 are the column index and bits 16-19 a TemporalUnit that the
+   * column is truncated to before grouping, e.g. kUnitDay to group by date.
+   */
   uint32_t* gb_cols_;
   uint32_t n_agg_results_;
-  AggResItem* agg_results_;
+  /*
+   * The result types are fixed by the program header and kept here once.
+   * The aggregation state of a group (and of agg_results_ when there is no
+   * group by) is agg_state_len_ bytes:
+   *   DataValue values[n_agg_results_];
+   *   uint8_t inited_bits[(n_agg_results_ + 7) / 8];    // used by Min/Max
+   *   uint8_t unsigned_bits[(n_agg_results_ + 7) / 8];
+   */
+  DataType* agg_types_;
+  uint32_t agg_state_len_;
+  char* agg_results_;
+  uint32_t* agg_ops_;  // Aggregation op of each result, used to merge spills
   uint32_t agg_prog_start_pos_;
 
-  std::map<Entry, Entry, EntryCmp>* gb_map_;
+  GroupMap* gb_map_;
   uint32_t n_groups_;
+  // The key of the current record, of at most max_key_len_ bytes
+  char* key_buf_;
+  uint32_t max_key_len_;
+
+  bool sorted_input_;
+  GroupSink sink_;
+  void* sink_arg_;
+  // Sorted-input mode: state and key of the current group, like in gb_map_
+  char* cur_group_;
+  uint32_t cur_key_len_;  // 0 if there is no current group
+  AggResItem* emit_items_;
+
+  uint64_t partition_budget_;
+  bool partitioned_;
+  RadixPartition* partitions_;  // 1 << radix_bits_, once partitioned
+  uint32_t radix_bits_;
+  uint32_t max_tuple_len_;  // Longest tuple, with a key of max_key_len_
+
+  uint64_t mem_budget_;
+  uint64_t mem_used_;
+  bool spilled_;
+  FILE* spill_files_[kSpillPartitions];
+
+  uint32_t col_mask_;
+  // Loads the records of ProcessRecs(), allocated on first use
+  ColumnBatch* batch_;
+
+  // Decoded program, terminated by a kDispatchEnd entry
+  DecodedInstr* code_;
+
+  bool use_jit_;
+  AggJit* jit_;
+  const unsigned char** jit_cols_;
+  uint8_t* jit_nulls_;
+
+  AggStats* stats_;
+
+  PerfCounters* perf_;
+  PerfValues perf_values_;
+  uint64_t perf_rows_;
+
+  friend class AggJit;
+  static int32_t JitAggregate(AggInterpreter* self, char* agg_state,
+                              uint32_t op, uint32_t agg_index,
+                              const Register* reg);
+  bool InitError(uint32_t pos, const char* msg);
+  bool Verify();
+  uint32_t ProcessRows(const ColumnBatch& batch);
+  uint32_t BuildGroupKey(const ColumnBatch& batch, uint32_t row, char* key);
+  char* SortedGroup(uint32_t key_len);
+  void EmitGroup(const char* key, uint32_t key_len, const char* state,
+                 GroupSink sink, void* arg);
+  bool ProcessRow(const ColumnBatch& batch, uint32_t row);
+  void Decode();
+  void FuseInstructions(uint32_t n_instrs);
+  bool Interpret(const ColumnBatch& batch, uint32_t row, char* agg_state);
+  bool InterpretWithStats(const ColumnBatch& batch, uint32_t row,
+                          char* agg_state);
+  inline void ExecLoadCol(const ColumnBatch& batch, uint32_t row,
+                          const DecodedInstr& ins);
+  inline void ExecLoadConst(const DecodedInstr& ins);
+  inline bool ExecArith(const DecodedInstr& ins);
+  inline void ExecCmp(const DecodedInstr& ins);
+  inline bool ExecAgg(const DecodedInstr& ins, char* agg_state);
+  bool RunJit(const ColumnBatch& batch, uint32_t row, char* agg_state);
+  void PartitionGroups();
+  RadixPartition* NewPartitions(uint32_t radix_bits);
+  bool SplitPartitions(uint32_t radix_bits);
+  char* FindTuple(uint32_t key_len, uint32_t* part);
+  bool MergeTuples(uint32_t part);
+  bool MergeAllTuples();
+  bool PartitionsPending() const;
+  uint32_t n_partitions() const {
+    return partitioned_ ? 1U << radix_bits_ : 0;
+  }
+  const char* FindGroup(const Entry& key) const;
+  bool SpillGroups();
+  bool MergeSpilled(GroupSink sink, void* arg);
+  bool MergeSpillFile(FILE* file, uint32_t level, GroupSink sink, void* arg);
+  bool SplitSpillFile(FILE* file, uint32_t level, FILE** parts);
+  bool MergeAggResults(const char* src, char* dst);
+  void LoadAggRes(const char* state, uint32_t i, AggResItem* item);
+  void StoreAggRes(const AggResItem& item, char* state, uint32_t i);
+  void PrintGroups(GroupMap* map);
+  void PrintPartition(const RadixPartition& partition);
+  void PrintGroup(const char* key, uint32_t key_len, const char* state);
+  void FreeGroups(GroupMap* map);
+  void FreePartitions();
 };
 #endif  // INTERPRETER_H_
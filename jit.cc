@@ -0,0 +1,597 @@
+/*
+ * Copyright [2024] <Copyright Hopsworks AB>
+ *
+ * Author: Zhao Song
+ */
+#include <assert.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "jit.h"
+#include "interpreter.h"
+
+// x86-64 register numbers
+static const uint8_t kRax = 0;
+static const uint8_t kRcx = 1;
+static const uint8_t kRdx = 2;
+static const uint8_t kRsi = 6;
+static const uint8_t kRdi = 7;
+static const uint8_t kR8 = 8;
+static const uint8_t kR9 = 9;
+
+// x86-64 condition codes
+static const uint8_t kCcO = 0x0;
+static const uint8_t kCcNe = 0x5;
+static const uint8_t kCcE = 0x4;
+static const uint8_t kCcAe = 0x3;
+static const uint8_t kCcS = 0x8;
+static const uint8_t kCcL = 0xC;
+static const uint8_t kCcGe = 0xD;
+static const uint8_t kCcLe = 0xE;
+static const uint8_t kCcG = 0xF;
+// Passed to AggJit::EmitJump() for an unconditional jump
+static const uint8_t kJmp = 0xFF;
+
+// Displacements of the Register fields
+static const uint8_t kRegType = offsetof(Register, type);
+static const uint8_t kRegValue = offsetof(Register, value);
+static const uint8_t kRegUnsigned = offsetof(Register, is_unsigned);
+static const uint8_t kRegNull = offsetof(Register, is_null);
+static_assert(offsetof(Register, is_null) ==
+              offsetof(Register, is_unsigned) + 1,
+              "is_unsigned and is_null are tested as one word");
+
+AggJit::~AggJit() {
+  if (code_) {
+    munmap(code_, code_len_);
+  }
+}
+
+void AggJit::Emit(std::initializer_list<uint8_t> bytes) {
+  buf_.insert(buf_.end(), bytes);
+}
+
+void AggJit::EmitU32(uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    buf_.push_back((value >> (8 * i)) & 0xFF);
+  }
+}
+
+void AggJit::EmitU64(uint64_t value) {
+  EmitU32(static_cast<uint32_t>(value));
+  EmitU32(static_cast<uint32_t>(value >> 32));
+}
+
+// mov reg, imm64
+void AggJit::EmitMovImm64(uint8_t reg, uint64_t value) {
+  Emit({static_cast<uint8_t>(0x48 | (reg >> 3)),
+        static_cast<uint8_t>(0xB8 + (reg & 7))});
+  EmitU64(value);
+}
+
+// mov reg32, imm32, which zero extends to the 64-bit register
+void AggJit::EmitMovImm32(uint8_t reg, uint32_t value) {
+  if (reg >> 3) {
+    Emit({0x41});
+  }
+  Emit({static_cast<uint8_t>(0xB8 + (reg & 7))});
+  EmitU32(value);
+}
+
+/*
+ * Emit a jump, conditional unless cc is kJmp, whose target is set later by
+ * BindJump() with the returned position.
+ */
+uint32_t AggJit::EmitJump(uint8_t cc) {
+  if (cc == kJmp) {
+    Emit({0xE9});                       // jmp rel32
+  } else {
+    Emit({0x0F, static_cast<uint8_t>(0x80 | cc)});  // jcc rel32
+  }
+  uint32_t jump = buf_.size();
+  EmitU32(0);
+  return jump;
+}
+
+// Make the jump emitted at position jump continue at the current position.
+void AggJit::BindJump(uint32_t jump) {
+  uint32_t rel = buf_.size() - (jump + 4);
+  memcpy(&buf_[jump], &rel, sizeof(rel));
+}
+
+// Leave the program with -1 if the condition holds.
+void AggJit::EmitErrorJump(uint8_t cc) {
+  error_jumps_.push_back(EmitJump(cc));
+}
+
+/*
+ * Call func with the arguments already in place and leave the program with
+ * -1 if it returns a negative value.
+ */
+void AggJit::EmitCall(const void* func) {
+  EmitMovImm64(kRax, reinterpret_cast<uint64_t>(func));
+  Emit({0xFF, 0xD0});                   // call rax
+  Emit({0x85, 0xC0});                   // test eax, eax
+  EmitErrorJump(kCcS);
+}
+
+/*
+ * Leave the program with -1 unless the double in rax is finite, i.e. its
+ * exponent is not all ones, like the std::isfinite() of the kernels.
+ */
+void AggJit::EmitCheckFinite() {
+  Emit({0x49, 0x89, 0xC0});             // mov r8, rax
+  Emit({0x49, 0xD1, 0xE0});             // shl r8, 1
+  EmitMovImm64(kR9, 0xFFE0000000000000ULL);
+  Emit({0x4D, 0x39, 0xC8});             // cmp r8, r9
+  EmitErrorJump(kCcAe);
+}
+
+/*
+ * Store rax as the value of the register that rcx points to, with the given
+ * type, and mark it not NULL.
+ */
+void AggJit::EmitSetRegister(int32_t type, bool is_unsigned) {
+  Emit({0x48, 0x89, 0x41, kRegValue});  // mov [rcx + value], rax
+  Emit({0xC7, 0x41, kRegType});
+  EmitU32(type);                        // mov dword [rcx + type], type
+  Emit({0xC6, 0x41, kRegUnsigned,
+        static_cast<uint8_t>(is_unsigned)});  // mov byte [rcx + is_unsigned]
+  Emit({0xC6, 0x41, kRegNull, 0x00});   // mov byte [rcx + is_null], 0
+}
+
+/*
+ * reg1 = reg1 op reg2. Two signed BIGINTs or two DOUBLEs that are not NULL
+ * are computed inline with the checks of the kernel, everything else calls
+ * the kernel. rdi and rsi point to the operands on the inline path.
+ */
+void AggJit::EmitArith(uint8_t op, DataType type1, DataType type2,
+                       uint64_t reg1, uint64_t reg2) {
+  const void* kernel =
+      op == kOpPlus ? reinterpret_cast<const void*>(&RegPlusReg) :
+      op == kOpMinus ? reinterpret_cast<const void*>(&RegMinusReg) :
+      op == kOpMul ? reinterpret_cast<const void*>(&RegMulReg) :
+      op == kOpDiv ? reinterpret_cast<const void*>(&RegDivReg) :
+                     reinterpret_cast<const void*>(&RegModReg);
+  bool inline_op = (op == kOpPlus || op == kOpMinus || op == kOpMul) &&
+                   type1 == type2 &&
+                   (type1 == kTypeBigInt || type1 == kTypeDouble);
+  uint32_t slow1 = 0, slow2 = 0, done = 0;
+
+  if (inline_op) {
+    EmitMovImm64(kRdi, reg1);
+    EmitMovImm64(kRsi, reg2);
+    if (type1 == kTypeBigInt) {
+      // The unsigned combinations take the kernel's slow path.
+      Emit({0x66, 0x83, 0x7F, kRegUnsigned, 0x00});
+                                        // cmp word [rdi + is_unsigned], 0
+      slow1 = EmitJump(kCcNe);
+      Emit({0x66, 0x83, 0x7E, kRegUnsigned, 0x00});
+                                        // cmp word [rsi + is_unsigned], 0
+      slow2 = EmitJump(kCcNe);
+      Emit({0x48, 0x8B, 0x47, kRegValue});  // mov rax, [rdi + value]
+      if (op == kOpPlus) {
+        Emit({0x48, 0x03, 0x46, kRegValue});  // add rax, [rsi + value]
+        EmitErrorJump(kCcO);
+        Emit({0x48, 0x89, 0x47, kRegValue});  // mov [rdi + value], rax
+      } else if (op == kOpMinus) {
+        // Like RegMinusReg(), which checks only when a side is unsigned
+        Emit({0x48, 0x2B, 0x46, kRegValue});  // sub rax, [rsi + value]
+        Emit({0x48, 0x89, 0x47, kRegValue});  // mov [rdi + value], rax
+      } else {
+        // RegMulReg() leaves the first operand as is if either is 0.
+        Emit({0x48, 0x8B, 0x56, kRegValue});  // mov rdx, [rsi + value]
+        Emit({0x48, 0x85, 0xC0});       // test rax, rax
+        uint32_t zero1 = EmitJump(kCcE);
+        Emit({0x48, 0x85, 0xD2});       // test rdx, rdx
+        uint32_t zero2 = EmitJump(kCcE);
+        Emit({0x48, 0x89, 0xC1});       // mov rcx, rax
+        Emit({0x48, 0x0F, 0xAF, 0xC2});  // imul rax, rdx
+        EmitErrorJump(kCcO);
+        /*
+         * The kernel multiplies magnitudes, so a product of INT64_MIN only
+         * fits when it is INT64_MIN * 1.
+         */
+        EmitMovImm64(kR8, 0x8000000000000000ULL);
+        Emit({0x4C, 0x39, 0xC0});       // cmp rax, r8
+        uint32_t store1 = EmitJump(kCcNe);
+        Emit({0x4C, 0x39, 0xC1});       // cmp rcx, r8
+        uint32_t store2 = EmitJump(kCcE);
+        Emit({0x4C, 0x39, 0xC2});       // cmp rdx, r8
+        EmitErrorJump(kCcNe);
+        BindJump(store1);
+        BindJump(store2);
+        Emit({0x48, 0x89, 0x47, kRegValue});  // mov [rdi + value], rax
+        BindJump(zero1);
+        BindJump(zero2);
+      }
+      done = EmitJump(kJmp);
+    } else {
+      Emit({0x80, 0x7F, kRegNull, 0x00});  // cmp byte [rdi + is_null], 0
+      slow1 = EmitJump(kCcNe);
+      Emit({0x80, 0x7E, kRegNull, 0x00});  // cmp byte [rsi + is_null], 0
+      slow2 = EmitJump(kCcNe);
+      Emit({0xF2, 0x0F, 0x10, 0x47, kRegValue});  // movsd xmm0, [rdi + value]
+      Emit({0xF2, 0x0F,
+            static_cast<uint8_t>(op == kOpPlus ? 0x58 :
+                                 op == kOpMinus ? 0x5C : 0x59),
+            0x46, kRegValue});          // addsd/subsd/mulsd xmm0, [rsi + value]
+      Emit({0x66, 0x48, 0x0F, 0x7E, 0xC0});  // movq rax, xmm0
+      EmitCheckFinite();
+      Emit({0x48, 0x89, 0x47, kRegValue});  // mov [rdi + value], rax
+      if (op == kOpPlus) {
+        Emit({0xC6, 0x47, kRegUnsigned, 0x00});  // mov byte [rdi + ...], 0
+      }
+      done = EmitJump(kJmp);
+    }
+    BindJump(slow1);
+    BindJump(slow2);
+  }
+
+  EmitMovImm64(kRdi, reg1);
+  EmitMovImm64(kRsi, reg2);
+  EmitMovImm64(kRdx, reg1);
+  EmitCall(kernel);
+  if (inline_op) {
+    BindJump(done);
+  }
+}
+
+/*
+ * reg1 = reg1 op reg2 for the comparisons. Operands of the same kind that
+ * are not NULL, and signed if BIGINT, are compared inline.
+ */
+void AggJit::EmitCmp(uint8_t op, DataType type1, DataType type2,
+                     uint64_t reg1, uint64_t reg2) {
+  bool temporal = IsTemporalType(type1) && IsTemporalType(type2);
+  bool inline_op = temporal || (type1 == type2 &&
+                   (type1 == kTypeBigInt || type1 == kTypeDouble));
+  uint32_t slow1 = 0, slow2 = 0, done = 0;
+
+  if (inline_op) {
+    EmitMovImm64(kRdi, reg1);
+    EmitMovImm64(kRsi, reg2);
+    if (type1 == kTypeBigInt) {
+      Emit({0x66, 0x83, 0x7F, kRegUnsigned, 0x00});
+                                        // cmp word [rdi + is_unsigned], 0
+      slow1 = EmitJump(kCcNe);
+      Emit({0x66, 0x83, 0x7E, kRegUnsigned, 0x00});
+                                        // cmp word [rsi + is_unsigned], 0
+      slow2 = EmitJump(kCcNe);
+    } else {
+      Emit({0x80, 0x7F, kRegNull, 0x00});  // cmp byte [rdi + is_null], 0
+      slow1 = EmitJump(kCcNe);
+      Emit({0x80, 0x7E, kRegNull, 0x00});  // cmp byte [rsi + is_null], 0
+      slow2 = EmitJump(kCcNe);
+    }
+    if (type1 == kTypeDouble) {
+      /*
+       * cl = a > b and dl = a < b, both false if either is NaN, so that a
+       * NaN compares equal like in RegCmpReg().
+       */
+      Emit({0xF2, 0x0F, 0x10, 0x47, kRegValue});  // movsd xmm0, [rdi + value]
+      Emit({0xF2, 0x0F, 0x10, 0x4E, kRegValue});  // movsd xmm1, [rsi + value]
+      Emit({0x66, 0x0F, 0x2E, 0xC1});   // ucomisd xmm0, xmm1
+      Emit({0x0F, 0x97, 0xC1});         // seta cl
+      Emit({0x66, 0x0F, 0x2E, 0xC8});   // ucomisd xmm1, xmm0
+      Emit({0x0F, 0x97, 0xC2});         // seta dl
+      switch (op) {
+        case kOpEq:
+          Emit({0x08, 0xD1});           // or cl, dl
+          Emit({0x0F, 0x94, 0xC0});     // sete al
+          break;
+        case kOpNe:
+          Emit({0x08, 0xD1});           // or cl, dl
+          Emit({0x0F, 0x95, 0xC0});     // setne al
+          break;
+        case kOpLt:
+          Emit({0x88, 0xD0});           // mov al, dl
+          break;
+        case kOpLe:
+          Emit({0x84, 0xC9});           // test cl, cl
+          Emit({0x0F, 0x94, 0xC0});     // sete al
+          break;
+        case kOpGt:
+          Emit({0x88, 0xC8});           // mov al, cl
+          break;
+        default:
+          assert(op == kOpGe);
+          Emit({0x84, 0xD2});           // test dl, dl
+          Emit({0x0F, 0x94, 0xC0});     // sete al
+          break;
+      }
+    } else {
+      // Signed BIGINTs and packed temporal values compare as int64_t.
+      uint8_t cc = op == kOpEq ? kCcE : op == kOpNe ? kCcNe :
+                   op == kOpLt ? kCcL : op == kOpLe ? kCcLe :
+                   op == kOpGt ? kCcG : kCcGe;
+      Emit({0x48, 0x8B, 0x47, kRegValue});  // mov rax, [rdi + value]
+      Emit({0x48, 0x3B, 0x46, kRegValue});  // cmp rax, [rsi + value]
+      Emit({0x0F, static_cast<uint8_t>(0x90 | cc), 0xC0});  // setcc al
+    }
+    Emit({0x0F, 0xB6, 0xC0});           // movzx eax, al
+    Emit({0x48, 0x89, 0x47, kRegValue});  // mov [rdi + value], rax
+    Emit({0xC7, 0x47, kRegType});
+    EmitU32(kTypeBigInt);               // mov dword [rdi + type], BIGINT
+    Emit({0xC6, 0x47, kRegUnsigned, 0x00});  // mov byte [rdi + ...], 0
+    done = EmitJump(kJmp);
+    BindJump(slow1);
+    BindJump(slow2);
+  }
+
+  EmitMovImm32(kRdi, op);
+  EmitMovImm64(kRsi, reg1);
+  EmitMovImm64(kRdx, reg2);
+  EmitMovImm64(kRcx, reg1);
+  EmitCall(reinterpret_cast<const void*>(&RegCmpReg));
+  if (inline_op) {
+    BindJump(done);
+  }
+}
+
+/*
+ * SUM, MAX or MIN of reg into aggregation result index, updated in place in
+ * the packed state. A NULL register leaves it as is. A DOUBLE result, or a
+ * signed BIGINT or temporal one fed by a signed register, is updated inline
+ * and the other combinations go through AggInterpreter::JitAggregate().
+ */
+void AggJit::EmitAggregate(AggInterpreter* interp, uint8_t op,
+                           DataType reg_type, uint32_t index, uint64_t reg) {
+  uint32_t n_agg = interp->n_agg_results_;
+  uint32_t slot = index * sizeof(DataValue);
+  uint32_t inited_pos = n_agg * sizeof(DataValue) + (index >> 3);
+  uint32_t unsigned_pos = inited_pos + (n_agg + 7) / 8;
+  uint8_t mask = 1 << (index & 7);
+  DataType agg_type = interp->agg_types_[index];
+  bool inline_op = reg_type == agg_type;
+  uint32_t null = 0, slow1 = 0, slow2 = 0, done = 0;
+
+  if (inline_op) {
+    EmitMovImm64(kRcx, reg);
+    Emit({0x4C, 0x89, 0xE2});           // mov rdx, r12
+    Emit({0x80, 0x79, kRegNull, 0x00});  // cmp byte [rcx + is_null], 0
+    null = EmitJump(kCcNe);
+    if (agg_type == kTypeDouble) {
+      Emit({0xF2, 0x0F, 0x10, 0x41, kRegValue});  // movsd xmm0, [rcx + value]
+      if (op == kOpSum) {
+        Emit({0xF2, 0x0F, 0x58, 0x82});  // addsd xmm0, [rdx + slot]
+        EmitU32(slot);
+        Emit({0x66, 0x48, 0x0F, 0x7E, 0xC0});  // movq rax, xmm0
+        EmitCheckFinite();
+        Emit({0x48, 0x89, 0x82});       // mov [rdx + slot], rax
+        EmitU32(slot);
+        Emit({0x80, 0xA2});             // and byte [rdx + unsigned bit], ~mask
+        EmitU32(unsigned_pos);
+        Emit({static_cast<uint8_t>(~mask)});
+      } else {
+        // minsd and maxsd pick the second operand on NaN, like Min() and Max()
+        Emit({0xF2, 0x0F, static_cast<uint8_t>(op == kOpMin ? 0x5D : 0x5F),
+              0x82});                   // minsd/maxsd xmm0, [rdx + slot]
+        EmitU32(slot);
+        Emit({0xF2, 0x0F, 0x11, 0x82});  // movsd [rdx + slot], xmm0
+        EmitU32(slot);
+      }
+    } else {
+      Emit({0x80, 0x79, kRegUnsigned, 0x00});
+                                        // cmp byte [rcx + is_unsigned], 0
+      slow1 = EmitJump(kCcNe);
+      Emit({0xF6, 0x82});               // test byte [rdx + unsigned bit], mask
+      EmitU32(unsigned_pos);
+      Emit({mask});
+      slow2 = EmitJump(kCcNe);
+      Emit({0x48, 0x8B, 0x41, kRegValue});  // mov rax, [rcx + value]
+      if (op == kOpSum) {
+        Emit({0x48, 0x03, 0x82});       // add rax, [rdx + slot]
+        EmitU32(slot);
+        EmitErrorJump(kCcO);
+        Emit({0x48, 0x89, 0x82});       // mov [rdx + slot], rax
+        EmitU32(slot);
+      } else {
+        Emit({0xF6, 0x82});             // test byte [rdx + inited bit], mask
+        EmitU32(inited_pos);
+        Emit({mask});
+        uint32_t first = EmitJump(kCcE);
+        Emit({0x48, 0x3B, 0x82});       // cmp rax, [rdx + slot]
+        EmitU32(slot);
+        uint32_t keep = EmitJump(op == kOpMin ? kCcGe : kCcLe);
+        BindJump(first);
+        Emit({0x48, 0x89, 0x82});       // mov [rdx + slot], rax
+        EmitU32(slot);
+        Emit({0x80, 0x8A});             // or byte [rdx + inited bit], mask
+        EmitU32(inited_pos);
+        Emit({mask});
+        BindJump(keep);
+      }
+      done = EmitJump(kJmp);
+      BindJump(slow1);
+      BindJump(slow2);
+    }
+  }
+
+  if (!inline_op || agg_type != kTypeDouble) {
+    EmitMovImm64(kRdi, reinterpret_cast<uint64_t>(interp));
+    Emit({0x4C, 0x89, 0xE6});           // mov rsi, r12
+    EmitMovImm32(kRdx, op);
+    EmitMovImm32(kRcx, index);
+    EmitMovImm64(kR8, reg);
+    EmitCall(reinterpret_cast<const void*>(&AggInterpreter::JitAggregate));
+  }
+  if (inline_op) {
+    if (agg_type != kTypeDouble) {
+      BindJump(done);
+    }
+    BindJump(null);
+  }
+}
+
+bool AggJit::Compile(AggInterpreter* interp) {
+#if defined(__x86_64__)
+  const uint32_t* prog = interp->prog_;
+  uint32_t n_agg = interp->n_agg_results_;
+  uint32_t unsigned_bits_pos = n_agg * sizeof(DataValue) + (n_agg + 7) / 8;
+
+  buf_.clear();
+  error_jumps_.clear();
+  cols_.clear();
+  n_col_slots_ = 0;
+
+  /*
+   * The type of each register's non-NULL value, tracked like in
+   * AggInterpreter::Verify(), which has accepted the program, to pick the
+   * inline code of each op.
+   */
+  DataType reg_types[kRegTotal];
+  for (uint32_t i = 0; i < kRegTotal; i++) {
+    reg_types[i] = kTypeUnknown;
+  }
+
+  /*
+   * Keep cols in rbx, nulls in r13 and the aggregation state in r12. Three
+   * pushes also keep the stack 16-byte aligned for the calls.
+   */
+  Emit({0x53});                         // push rbx
+  Emit({0x41, 0x54});                   // push r12
+  Emit({0x41, 0x55});                   // push r13
+  Emit({0x48, 0x89, 0xFB});             // mov rbx, rdi
+  Emit({0x49, 0x89, 0xF5});             // mov r13, rsi
+  Emit({0x49, 0x89, 0xD4});             // mov r12, rdx
+
+  uint32_t pos = interp->agg_prog_start_pos_;
+  while (pos < interp->prog_len_) {
+    uint32_t value = prog[pos++];
+    uint8_t op = (value & 0xFC000000) >> 26;
+    DataType type;
+    bool is_unsigned = DecodeRawType((value & 0x03E00000) >> 21, &type);
+    uint32_t reg_no = (value & 0x000F0000) >> 16;
+    uint32_t reg1_no = (value & 0x0000F000) >> 12;
+    uint32_t reg2_no = (value & 0x00000F00) >> 8;
+    // Register addresses, only used by the ops that have that operand
+    uint64_t regs = reinterpret_cast<uint64_t>(interp->registers_);
+    uint64_t reg = regs + reg_no * sizeof(Register);
+    uint64_t reg1 = regs + reg1_no * sizeof(Register);
+    uint64_t reg2 = regs + reg2_no * sizeof(Register);
+    uint32_t index = value & 0x0000FFFF;
+
+    switch (op) {
+      case kOpPlus:
+      case kOpMinus:
+      case kOpMul:
+      case kOpDiv:
+      case kOpMod:
+        EmitArith(op, reg_types[reg1_no], reg_types[reg2_no], reg1, reg2);
+        if (reg_types[reg2_no] == kTypeDouble) {
+          reg_types[reg1_no] = kTypeDouble;
+        }
+        break;
+
+      case kOpEq:
+      case kOpNe:
+      case kOpLt:
+      case kOpLe:
+      case kOpGt:
+      case kOpGe:
+        EmitCmp(op, reg_types[reg1_no], reg_types[reg2_no], reg1, reg2);
+        reg_types[reg1_no] = kTypeBigInt;
+        break;
+
+      case kOpLoadCol:
+        if (type != kTypeBigInt && type != kTypeDouble &&
+            !IsTemporalType(type)) {
+          return false;
+        }
+        Emit({0x48, 0x8B, 0x83});       // mov rax, [rbx + 8 * col]
+        EmitU32(index * sizeof(void*));
+        Emit({0x48, 0x8B, 0x00});       // mov rax, [rax]
+        EmitMovImm64(kRcx, reg);
+        EmitSetRegister(type, is_unsigned);
+        Emit({0x41, 0x0F, 0xB6, 0x85});  // movzx eax, byte [r13 + col]
+        EmitU32(index);
+        Emit({0x88, 0x41, kRegNull});   // mov [rcx + is_null], al
+        cols_.push_back(index);
+        if (index + 1 > n_col_slots_) {
+          n_col_slots_ = index + 1;
+        }
+        reg_types[reg_no] = type;
+        break;
+
+      case kOpLoadConst:
+        if (pos + 2 > interp->prog_len_) {
+          return false;
+        }
+        EmitMovImm64(kRax, static_cast<uint64_t>(prog[pos]) |
+                           static_cast<uint64_t>(prog[pos + 1]) << 32);
+        pos += 2;
+        EmitMovImm64(kRcx, reg);
+        EmitSetRegister(type, is_unsigned);
+        reg_types[reg_no] = type;
+        break;
+
+      case kOpCount:
+        // Add one and set the unsigned bit unless the register is NULL.
+        EmitMovImm64(kRcx, reg);
+        Emit({0x80, 0x79, kRegNull, 0x00});  // cmp byte [rcx + is_null], 0
+        Emit({0x75, 0x12});             // jne +18
+        Emit({0x4C, 0x89, 0xE2});       // mov rdx, r12
+        Emit({0x48, 0x83, 0x82});       // add qword [rdx + 8 * index], 1
+        EmitU32(index * sizeof(DataValue));
+        Emit({0x01});
+        Emit({0x80, 0x8A});             // or byte [rdx + unsigned bit], mask
+        EmitU32(unsigned_bits_pos + (index >> 3));
+        Emit({static_cast<uint8_t>(1 << (index & 7))});
+        break;
+
+      case kOpSum:
+      case kOpMax:
+      case kOpMin:
+        if (index >= n_agg) {
+          return false;
+        }
+        EmitAggregate(interp, op, reg_types[reg_no], index, reg);
+        break;
+
+      default:
+        return false;
+    }
+  }
+
+  Emit({0x31, 0xC0});                   // xor eax, eax
+  Emit({0xEB, 0x05});                   // jmp +5
+  uint32_t error_pos = buf_.size();
+  Emit({0xB8});                         // mov eax, -1
+  EmitU32(0xFFFFFFFF);
+  Emit({0x41, 0x5D});                   // pop r13
+  Emit({0x41, 0x5C});                   // pop r12
+  Emit({0x5B});                         // pop rbx
+  Emit({0xC3});                         // ret
+
+  for (uint32_t jump : error_jumps_) {
+    uint32_t rel = error_pos - (jump + 4);
+    memcpy(&buf_[jump], &rel, sizeof(rel));
+  }
+  return Install();
+#else
+  (void)interp;
+  return false;
+#endif
+}
+
+/*
+ * Copy the code into its own mapping, which is made executable and read
+ * only once written.
+ */
+bool AggJit::Install() {
+  code_len_ = buf_.size();
+  void* code = mmap(nullptr, code_len_, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (code == MAP_FAILED) {
+    return false;
+  }
+  memcpy(code, buf_.data(), code_len_);
+  if (mprotect(code, code_len_, PROT_READ | PROT_EXEC) != 0) {
+    munmap(code, code_len_);
+    return false;
+  }
+  code_ = code;
+  buf_.clear();
+  return true;
+}
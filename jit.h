@@ -0,0 +1,91 @@
+/*
+ * Copyright [2024] <Copyright Hopsworks AB>
+ *
+ * Author: Zhao Song
+ */
+#ifndef JIT_H_
+#define JIT_H_
+
+#include <stddef.h>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+class AggInterpreter;
+
+/*
+ * Native code for the aggregation part of a program. cols[i] points to the
+ * data of column i of the current record and nulls[i] is 1 if it is NULL,
+ * for every column the program loads. Return 0 on success and -1 if an
+ * arithmetic op or aggregation failed (e.g. overflowed), which the
+ * interpreter treats as an assertion.
+ */
+typedef int32_t (*JitFunc)(const unsigned char* const* cols,
+                           const uint8_t* nulls, char* agg_state);
+
+/*
+ * Translates the instructions of an initialized AggInterpreter into x86-64
+ * machine code in an mmap'd buffer, so that the decoding and dispatch of
+ * every instruction for every row disappear while the results stay
+ * identical. Column loads, constants and COUNT are emitted inline, and so
+ * are +, -, *, the comparisons, SUM, MAX and MIN for signed BIGINT and
+ * DOUBLE values that are not NULL, which update the packed aggregation
+ * state in place. Everything else (NULLs, unsigned values, / and %, mixed
+ * types) calls the same kernels as the interpreter (RegPlusReg(), Min(),
+ * ...) with the operands' addresses baked into the code.
+ *
+ * The code refers to the interpreter's registers by address, so the
+ * interpreter must not be moved after it has been compiled.
+ */
+class AggJit {
+ public:
+  AggJit() : code_(nullptr), code_len_(0), n_col_slots_(0) {}
+  ~AggJit();
+
+  /*
+   * Return false if the program uses an op or a type that the JIT does not
+   * handle, or if the platform is not x86-64. The caller then keeps
+   * interpreting the program.
+   */
+  bool Compile(AggInterpreter* interp);
+
+  JitFunc func() {
+    return reinterpret_cast<JitFunc>(code_);
+  }
+  // Columns loaded by the program, and the size cols and nulls must have
+  const std::vector<uint32_t>& cols() {
+    return cols_;
+  }
+  uint32_t n_col_slots() {
+    return n_col_slots_;
+  }
+
+ private:
+  std::vector<uint8_t> buf_;
+  std::vector<uint32_t> error_jumps_;
+  void* code_;
+  size_t code_len_;
+  std::vector<uint32_t> cols_;
+  uint32_t n_col_slots_;
+
+  void Emit(std::initializer_list<uint8_t> bytes);
+  void EmitU32(uint32_t value);
+  void EmitU64(uint64_t value);
+  void EmitMovImm64(uint8_t reg, uint64_t value);
+  void EmitMovImm32(uint8_t reg, uint32_t value);
+  uint32_t EmitJump(uint8_t cc);
+  void BindJump(uint32_t jump);
+  void EmitErrorJump(uint8_t cc);
+  void EmitCall(const void* func);
+  void EmitCheckFinite();
+  void EmitSetRegister(int32_t type, bool is_unsigned);
+  void EmitArith(uint8_t op, int32_t type1, int32_t type2, uint64_t reg1,
+                 uint64_t reg2);
+  void EmitCmp(uint8_t op, int32_t type1, int32_t type2, uint64_t reg1,
+               uint64_t reg2);
+  void EmitAggregate(AggInterpreter* interp, uint8_t op, int32_t reg_type,
+                     uint32_t index, uint64_t reg);
+  bool Install();
+};
+
+#endif  // JIT_H_
@@ -1,7 +1,14 @@
 #include <stdlib.h>
 #include <assert.h>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
 
 #include "interpreter.h"
+#include "shared_scan.h"
+#include "temporal.h"
 
 /*
  * Table definition
@@ -11,7 +18,8 @@
  *   `b` double DEFAULT NULL,
  *   `c` bigint unsigned DEFAULT NULL,
  *   `d` double DEFAULT NULL,
- *   `e` varchar(20) DEFAULT NULL
+ *   `e` varchar(20) DEFAULT NULL,
+ *   `f` datetime(6) DEFAULT NULL
  * ) ENGINE=ndbcluster DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_0900_ai_ci
  *
  */
@@ -19,6 +27,9 @@
  * Aggregation
  *
  * select count(a), sum(a/b+c*d), max((a+b)*c/d), min(b%c-d), sum(a+c), count(d/c) from t group by a;
+ *
+ * select count(f), min(f), max(f), sum(f >= DATE'2024-03-02') from t
+ *   group by date(f);
  */
 
 const char* g_chars = "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz";
@@ -27,6 +38,371 @@ const uint32_t g_prog_len = 41;
 const uint32_t ins_pos = 9;
 uint32_t program[g_prog_len];
 
+const uint32_t g_prog2_len = 16;
+uint32_t program2[g_prog2_len];
+
+int64_t Datetime(uint32_t year, uint32_t month, uint32_t day, uint32_t hour,
+                 uint32_t minute, uint32_t second, uint32_t microsecond) {
+  DatetimeParts parts{year, month, day, hour, minute, second, microsecond};
+  return PackDatetime(parts);
+}
+
+/*
+ * Run a program over the same pseudo-random records, some with a NULL
+ * column, with and without the JIT, and check that both produce exactly the
+ * same aggregation state.
+ */
+bool CheckJit(const uint32_t* prog, uint32_t prog_len, uint32_t n_recs) {
+  AggInterpreter interpreted(prog, prog_len);
+  AggInterpreter compiled(prog, prog_len);
+  compiled.set_use_jit(true);
+  if (!interpreted.Init() || !compiled.Init()) {
+    printf("Init failed: %s\n", interpreted.init_error());
+    return false;
+  }
+  srand(1);
+  for (uint32_t i = 0; i < n_recs; i++) {
+    Record rec(rand() % 8, (rand() % 2001 - 1000) / 100.0, rand() % 10,
+               (rand() % 2001 - 1000) / 100.0, g_chars + (rand() % 40), 12,
+               Datetime(2024, 3, 1 + rand() % 3, rand() % 24, rand() % 60,
+                        rand() % 60, 0),
+               rand() % 8 == 0 ? 1 << (rand() % Record::n_cols) : 0);
+    interpreted.ProcessRec(&rec);
+    compiled.ProcessRec(&rec);
+  }
+  bool same = interpreted.SameResults(compiled);
+  printf("JIT %s, %u records, results %s\n",
+         compiled.jit_compiled() ? "compiled" : "not supported", n_recs,
+         same ? "match the interpreter" : "DIFFER from the interpreter");
+  return same;
+}
+
+/*
+ * Run select sum(a) and select sum(a+a) over records where a is INT64_MAX
+ * with the interpreter, with statistics and with the JIT, and check that
+ * the overflow makes ProcessRec() fail in each case.
+ */
+bool CheckOverflow() {
+  const uint32_t sum_a[] = {
+    ((uint16_t)0x0721) << 16 | (uint16_t)5,
+    ((uint16_t)0) << 16 | (uint16_t)1,
+    kTypeBigInt,
+    ((uint8_t)kOpLoadCol) << 26 | (uint8_t)(kTypeBigInt << 4) << 17 |
+      ((uint8_t)kReg1 & 0x0F) << 16 | (uint16_t)0,
+    ((uint8_t)kOpSum) << 26 | (uint8_t)(kTypeBigInt << 4) << 17 |
+      ((uint8_t)kReg1 & 0x0F) << 16 | (uint16_t)0
+  };
+  const uint32_t sum_a_plus_a[] = {
+    ((uint16_t)0x0721) << 16 | (uint16_t)7,
+    ((uint16_t)0) << 16 | (uint16_t)1,
+    kTypeBigInt,
+    ((uint8_t)kOpLoadCol) << 26 | (uint8_t)(kTypeBigInt << 4) << 17 |
+      ((uint8_t)kReg1 & 0x0F) << 16 | (uint16_t)0,
+    ((uint8_t)kOpLoadCol) << 26 | (uint8_t)(kTypeBigInt << 4) << 17 |
+      ((uint8_t)kReg2 & 0x0F) << 16 | (uint16_t)0,
+    ((uint8_t)kOpPlus) << 26 | (uint8_t)(kTypeBigInt << 4) << 17 |
+      (uint8_t)(kTypeBigInt << 4) << 12 |
+      ((uint8_t)kReg1 & 0x0F) << 12 | ((uint8_t)kReg2 & 0xF) << 8,
+    ((uint8_t)kOpSum) << 26 | (uint8_t)(kTypeBigInt << 4) << 17 |
+      ((uint8_t)kReg1 & 0x0F) << 16 | (uint16_t)0
+  };
+  const uint32_t* progs[] = {sum_a, sum_a_plus_a};
+  const uint32_t prog_lens[] = {5, 7};
+  bool all_failed = true;
+  for (uint32_t i = 0; i < 6; i++) {
+    AggInterpreter agg(progs[i / 3], prog_lens[i / 3]);
+    agg.set_collect_stats(i % 3 == 1);
+    agg.set_use_jit(i % 3 == 2);
+    if (!agg.Init()) {
+      printf("Init failed: %s\n", agg.init_error());
+      return false;
+    }
+    bool ok = true;
+    for (uint32_t j = 0; ok && j < 3; j++) {
+      Record rec(std::numeric_limits<int64_t>::max(), 1.0, 1, 1.0, g_chars,
+                 12, Datetime(2024, 3, 1, 0, 0, 0, 0));
+      ok = agg.ProcessRec(&rec);
+    }
+    all_failed = all_failed && !ok && (i % 3 != 2 || agg.jit_compiled());
+  }
+  printf("Overflow, results %s\n", all_failed ? "rejected" : "NOT rejected");
+  return all_failed;
+}
+
+/*
+ * Run two programs over pseudo-random records in one shared scan, with
+ * interpreters attached and detached mid-scan, and check that each has
+ * the same results as a separate scan over the records it saw.
+ */
+bool CheckSharedScan(const uint32_t* prog, uint32_t prog_len,
+                     const uint32_t* prog2, uint32_t prog2_len,
+                     uint32_t n_batches) {
+  const uint32_t batch_size = 100;
+  // From the start to the end, from the middle, from the start to 3/4
+  AggInterpreter whole(prog, prog_len), whole_ref(prog, prog_len);
+  AggInterpreter late(prog2, prog2_len), late_ref(prog2, prog2_len);
+  AggInterpreter early(prog, prog_len), early_ref(prog, prog_len);
+  late.set_use_jit(true);
+  if (!whole.Init() || !whole_ref.Init() || !late.Init() ||
+      !late_ref.Init() || !early.Init() || !early_ref.Init()) {
+    printf("Init failed\n");
+    return false;
+  }
+  SharedScan scan;
+  scan.Attach(&whole);
+  scan.Attach(&early);
+  srand(2);
+  Record* recs[batch_size];
+  for (uint32_t b = 0; b < n_batches; b++) {
+    if (b == n_batches / 2) {
+      scan.Attach(&late);
+    }
+    if (b == n_batches * 3 / 4) {
+      scan.Detach(&early);
+    }
+    for (uint32_t i = 0; i < batch_size; i++) {
+      recs[i] = new Record(rand() % 8, (rand() % 2001 - 1000) / 100.0,
+                           rand() % 10, (rand() % 2001 - 1000) / 100.0,
+                           g_chars + (rand() % 40), 12,
+                           Datetime(2024, 3, 1 + rand() % 3, rand() % 24,
+                                    rand() % 60, rand() % 60, 0),
+                           rand() % 8 == 0 ?
+                             1 << (rand() % Record::n_cols) : 0);
+    }
+    scan.ProcessRecs(recs, batch_size);
+    whole_ref.ProcessRecs(recs, batch_size);
+    if (scan.attached(&late)) {
+      late_ref.ProcessRecs(recs, batch_size);
+    }
+    if (scan.attached(&early)) {
+      early_ref.ProcessRecs(recs, batch_size);
+    }
+    for (uint32_t i = 0; i < batch_size; i++) {
+      delete recs[i];
+    }
+  }
+  bool same = whole.SameResults(whole_ref) && late.SameResults(late_ref) &&
+              early.SameResults(early_ref);
+  printf("Shared scan, %lu records, results %s\n", scan.rows_scanned(),
+         same ? "match separate scans" : "DIFFER from separate scans");
+  return same;
+}
+
+typedef std::map<std::string, std::vector<AggResItem>> CollectedGroups;
+
+// A GroupSink that collects the groups, counting any key seen twice.
+static uint32_t g_repeated_groups = 0;
+static void CollectGroup(void* arg, const char* key, uint32_t key_len,
+                         const AggResItem* results, uint32_t n_results) {
+  CollectedGroups* groups = static_cast<CollectedGroups*>(arg);
+  std::string k(key, key_len);
+  if (groups->count(k)) {
+    g_repeated_groups++;
+  }
+  (*groups)[k].assign(results, results + n_results);
+}
+
+static bool SameItems(const std::vector<AggResItem>& a,
+                      const std::vector<AggResItem>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (uint32_t i = 0; i < a.size(); i++) {
+    if (a[i].type != b[i].type || a[i].is_unsigned != b[i].is_unsigned ||
+        a[i].inited != b[i].inited ||
+        a[i].value.val_int64 != b[i].value.val_int64) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Run a program that groups by column 0 over records sorted on it, once in
+ * sorted-input mode and once with the group map, and check that every
+ * group is emitted once with the same results.
+ */
+bool CheckSortedInput(const uint32_t* prog, uint32_t prog_len,
+                      uint32_t n_keys) {
+  CollectedGroups streamed, hashed;
+  AggInterpreter sorted(prog, prog_len);
+  AggInterpreter grouped(prog, prog_len);
+  sorted.set_sorted_input(CollectGroup, &streamed);
+  if (!sorted.Init() || !grouped.Init()) {
+    printf("Init failed: %s\n", sorted.init_error());
+    return false;
+  }
+  g_repeated_groups = 0;
+  srand(3);
+  uint64_t n_recs = 0;
+  for (uint32_t key = 0; key < n_keys; key++) {
+    uint32_t n = 1 + rand() % 20;
+    for (uint32_t i = 0; i < n; i++, n_recs++) {
+      // NULLs in any column but the group by column
+      Record rec(key, (rand() % 2001 - 1000) / 100.0, rand() % 10,
+                 (rand() % 2001 - 1000) / 100.0, g_chars + (rand() % 40), 12,
+                 Datetime(2024, 3, 1 + rand() % 3, rand() % 24, rand() % 60,
+                          rand() % 60, 0),
+                 rand() % 8 == 0 ? 1 << (1 + rand() % (Record::n_cols - 1)) :
+                                   0);
+      sorted.ProcessRec(&rec);
+      grouped.ProcessRec(&rec);
+    }
+  }
+  sorted.Finish();
+  grouped.ForEachGroup(CollectGroup, &hashed);
+  bool same = streamed.size() == hashed.size() && g_repeated_groups == 0 &&
+              sorted.mem_used() < 1024;
+  for (auto iter = streamed.begin(); same && iter != streamed.end();
+       iter++) {
+    auto other = hashed.find(iter->first);
+    same = other != hashed.end() && SameItems(iter->second, other->second);
+  }
+  printf("Sorted input, %lu records, %zu groups, results %s\n", n_recs,
+         streamed.size(), same ? "match the group map" :
+                                 "DIFFER from the group map");
+  return same;
+}
+
+/*
+ * Merging partial groups adds up the doubles in another order, which may
+ * change the last bits, so doubles only need to be close.
+ */
+static bool CloseItems(const std::vector<AggResItem>& a,
+                       const std::vector<AggResItem>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (uint32_t i = 0; i < a.size(); i++) {
+    if (a[i].type != b[i].type || a[i].is_unsigned != b[i].is_unsigned ||
+        a[i].inited != b[i].inited) {
+      return false;
+    }
+    if (a[i].type == kTypeDouble) {
+      double x = a[i].value.val_double;
+      double y = b[i].value.val_double;
+      if (fabs(x - y) > 1e-9 * std::max(1.0, std::max(fabs(x), fabs(y)))) {
+        return false;
+      }
+    } else if (a[i].value.val_int64 != b[i].value.val_int64) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Run a program that groups by column 0 over records in random order, once
+ * with a partition budget small enough to switch to partitioned aggregation
+ * and flush the group map many times, and once with a single group map.
+ */
+bool CheckPartitioned(const uint32_t* prog, uint32_t prog_len,
+                      uint32_t n_keys) {
+  CollectedGroups merged, direct_groups;
+  AggInterpreter partitioned(prog, prog_len);
+  AggInterpreter direct(prog, prog_len);
+  partitioned.set_partition_budget(4096);
+  direct.set_partition_budget(0);
+  if (!partitioned.Init() || !direct.Init()) {
+    printf("Init failed: %s\n", partitioned.init_error());
+    return false;
+  }
+  srand(4);
+  uint32_t n_recs = 20 * n_keys;
+  for (uint32_t i = 0; i < n_recs; i++) {
+    Record rec(rand() % n_keys, (rand() % 2001 - 1000) / 100.0, rand() % 10,
+               (rand() % 2001 - 1000) / 100.0, g_chars + (rand() % 40), 12,
+               Datetime(2024, 3, 1 + rand() % 3, rand() % 24, rand() % 60,
+                        rand() % 60, 0),
+               rand() % 8 == 0 ? 1 << (rand() % Record::n_cols) : 0);
+    partitioned.ProcessRec(&rec);
+    direct.ProcessRec(&rec);
+  }
+  g_repeated_groups = 0;
+  bool same = partitioned.Finish() && partitioned.partitioned() &&
+              !direct.partitioned() &&
+              partitioned.ForEachGroup(CollectGroup, &merged) &&
+              direct.ForEachGroup(CollectGroup, &direct_groups) &&
+              merged.size() == direct_groups.size() &&
+              merged.size() == partitioned.n_groups() &&
+              g_repeated_groups == 0;
+  for (auto iter = merged.begin(); same && iter != merged.end(); iter++) {
+    auto other = direct_groups.find(iter->first);
+    same = other != direct_groups.end() &&
+           CloseItems(iter->second, other->second);
+  }
+  printf("Partitioned, %u records, %zu groups, results %s\n", n_recs,
+         merged.size(), same ? "match the group map" :
+                               "DIFFER from the group map");
+  return same;
+}
+
+/*
+ * select count(a), ..., count(a) from t group by a with n_aggs results, so
+ * that the tuple of one row can take more than a whole tuple buffer.
+ */
+static std::vector<uint32_t> WideProgram(uint32_t n_aggs) {
+  std::vector<uint32_t> prog;
+  prog.push_back(((uint16_t)0x0721) << 16 | (uint16_t)(4 + 2 * n_aggs));
+  prog.push_back(((uint16_t)1) << 16 | (uint16_t)n_aggs);
+  prog.push_back(0);  // group by column 0
+  for (uint32_t i = 0; i < n_aggs; i++) {
+    prog.push_back(kTypeBigInt);
+  }
+  prog.push_back(((uint8_t)kOpLoadCol) << 26 |
+                 0 << 25 | (uint8_t)(kTypeBigInt << 4) << 17 |
+                 ((uint8_t)kReg1 & 0x0F) << 16 | (uint16_t)0);
+  for (uint32_t i = 0; i < n_aggs; i++) {
+    prog.push_back(((uint8_t)kOpCount) << 26 |
+                   1 << 25 | (uint8_t)(kTypeBigInt << 4) << 17 |
+                   ((uint8_t)kReg1 & 0x0F) << 16 | (uint16_t)i);
+  }
+  return prog;
+}
+
+/*
+ * Run a program that groups by column 0 over records in random order, once
+ * with a memory budget so small that the groups are spilled many times and
+ * each spill partition is split again when merged back, and once in memory.
+ */
+bool CheckSpilled(const uint32_t* prog, uint32_t prog_len, uint32_t n_keys) {
+  CollectedGroups merged, direct_groups;
+  AggInterpreter spilled(prog, prog_len, 2048);
+  AggInterpreter direct(prog, prog_len);
+  spilled.set_collect_stats(true);
+  if (!spilled.Init() || !direct.Init()) {
+    printf("Init failed: %s\n", spilled.init_error());
+    return false;
+  }
+  srand(5);
+  uint32_t n_recs = 20 * n_keys;
+  for (uint32_t i = 0; i < n_recs; i++) {
+    Record rec(rand() % n_keys, (rand() % 2001 - 1000) / 100.0, rand() % 10,
+               (rand() % 2001 - 1000) / 100.0, g_chars + (rand() % 40), 12,
+               Datetime(2024, 3, 1 + rand() % 3, rand() % 24, rand() % 60,
+                        rand() % 60, 0),
+               rand() % 8 == 0 ? 1 << (rand() % Record::n_cols) : 0);
+    spilled.ProcessRec(&rec);
+    direct.ProcessRec(&rec);
+  }
+  g_repeated_groups = 0;
+  bool same = spilled.Finish() && spilled.spilled() &&
+              spilled.ForEachGroup(CollectGroup, &merged) &&
+              direct.ForEachGroup(CollectGroup, &direct_groups) &&
+              merged.size() == direct_groups.size() &&
+              merged.size() == spilled.n_groups() &&
+              g_repeated_groups == 0;
+  for (auto iter = merged.begin(); same && iter != merged.end(); iter++) {
+    auto other = direct_groups.find(iter->first);
+    same = other != direct_groups.end() &&
+           CloseItems(iter->second, other->second);
+  }
+  printf("Spilled, %u records, %zu groups, %lu spills, results %s\n", n_recs,
+         merged.size(), spilled.stats()->spills,
+         same ? "match the group map" : "DIFFER from the group map");
+  return same;
+}
+
 int main() {
 
   memset(program, 0, sizeof(program));
@@ -236,25 +612,111 @@ int main() {
 
   assert(ins_pos + 31 == g_prog_len - 1);
 
+  memset(program2, 0, sizeof(program2));
+  program2[0] = ((uint16_t)0x0721) << 16 | (uint16_t)g_prog2_len;
+  program2[1] = ((uint16_t)1) << 16 | // num of cols used in group by
+                ((uint16_t)4); // num of aggregation results
+
+  program2[2] = kUnitDay << 16 | 5; // group by column 5 truncated to the day
+  program2[3] = kTypeBigInt; // The 1st aggregation type BIGINT
+  program2[4] = kTypeDatetime; // The 2nd aggregation type DATETIME
+  program2[5] = kTypeDatetime; // The 3rd aggregation type DATETIME
+  program2[6] = kTypeBigInt; // The 4th aggregation type BIGINT
+
+  program2[7] =
+               ((uint8_t)kOpLoadCol) << 26 |                             // LOADCOL
+               0 << 25 | (uint8_t)(kTypeDatetime << 4) << 17 |           // kTypeDatetime
+               ((uint8_t)kReg1 & 0x0F) << 16 |                           // Register 1
+               (uint16_t)5;                                              // Column 5
+
+  program2[8] =
+               ((uint8_t)kOpCount) << 26 |                              // COUNT
+               1 << 25 | (uint8_t)(kTypeBigInt << 4) << 17 |            // kTypeBigInt
+               ((uint8_t)kReg1 & 0x0F) << 16 |                          // Register 1
+               (uint16_t)0;                                             // agg_result 0
+
+  program2[9] =
+                ((uint8_t)kOpMin) << 26 |                                // MIN
+                0 << 25 | (uint8_t)(kTypeDatetime << 4) << 17 |          // kTypeDatetime (Reg 1)
+                ((uint8_t)kReg1 & 0x0F) << 16 |                          // Register 1
+                (uint16_t)1;                                             // agg_result 1
+
+  program2[10] =
+                ((uint8_t)kOpMax) << 26 |                                // MAX
+                0 << 25 | (uint8_t)(kTypeDatetime << 4) << 17 |          // kTypeDatetime (Reg 1)
+                ((uint8_t)kReg1 & 0x0F) << 16 |                          // Register 1
+                (uint16_t)2;                                             // agg_result 2
+
+  int64_t date_const = Datetime(2024, 3, 2, 0, 0, 0, 0);
+  program2[11] =
+               ((uint8_t)kOpLoadConst) << 26 |                           // LOADCONST
+               0 << 25 | (uint8_t)(kTypeDate << 4) << 17 |               // kTypeDate
+               ((uint8_t)kReg2 & 0x0F) << 16;                            // Register 2
+  program2[12] = (uint32_t)date_const;                                   // low 32 bits
+  program2[13] = (uint32_t)((uint64_t)date_const >> 32);                 // high 32 bits
+
+  program2[14] =
+                ((uint8_t)kOpGe) << 26 |                                     // GE
+                0 << 25 | (uint8_t)(kTypeDatetime << 4) << 17 |              // kTypeDatetime (Reg 1)
+                0 << 20 | (uint8_t)(kTypeDate << 4) << 12 |                  // kTypeDate (Reg 2)
+                ((uint8_t)kReg1 & 0x0F) << 12 | ((uint8_t)kReg2 & 0xF) << 8; // Register 1, Register 2
+
+  program2[15] =
+                ((uint8_t)kOpSum) << 26 |                                // SUM
+                0 << 25 | (uint8_t)(kTypeBigInt << 4) << 17 |            // kTypeBigInt (Reg 1)
+                ((uint8_t)kReg1 & 0x0F) << 16 |                          // Register 1
+                (uint16_t)3;                                             // agg_result 3
+
   AggInterpreter agg(program, g_prog_len);
-  agg.Init();
-  Record rec1(1, 1.11, 10, 10.1010, g_chars + (rand() % 40), 12);
+  AggInterpreter agg2(program2, g_prog2_len);
+  agg.set_collect_stats(true);
+  agg2.set_collect_perf(true);
+  if (!agg.Init() || !agg2.Init()) {
+    printf("Init failed: %s%s\n", agg.init_error(), agg2.init_error());
+    return 1;
+  }
+  Record rec1(1, 1.11, 10, 10.1010, g_chars + (rand() % 40), 12,
+              Datetime(2024, 3, 1, 9, 15, 0, 0));
   rec1.Print();
   agg.ProcessRec(&rec1);
-  Record rec2(1, 1.12, 2, 0.11, g_chars + (rand() % 40), 12);
+  agg2.ProcessRec(&rec1);
+  Record rec2(1, 1.12, 2, 0.11, g_chars + (rand() % 40), 12,
+              Datetime(2024, 3, 1, 13, 40, 0, 0));
   rec2.Print();
   agg.ProcessRec(&rec2);
-  Record rec3(2, 2.22, 1, 1.0, g_chars + (rand() % 40), 12);
+  agg2.ProcessRec(&rec2);
+  Record rec3(2, 2.22, 1, 1.0, g_chars + (rand() % 40), 12,
+              Datetime(2024, 3, 1, 23, 59, 59, 500000));
   rec3.Print();
   agg.ProcessRec(&rec3);
-  Record rec4(2, -4.22, 3, 0.0, g_chars + (rand() % 40), 12);
+  agg2.ProcessRec(&rec3);
+  Record rec4(2, -4.22, 3, 0.0, g_chars + (rand() % 40), 12,
+              Datetime(2024, 3, 2, 0, 0, 0, 0));
   rec4.Print();
   agg.ProcessRec(&rec4);
-  Record rec5(2, -5.111, 0, -5.6, g_chars + (rand() % 40), 12);
+  agg2.ProcessRec(&rec4);
+  Record rec5(2, -5.111, 0, -5.6, g_chars + (rand() % 40), 12,
+              Datetime(2024, 3, 2, 18, 5, 0, 0));
   rec5.Print();
   agg.ProcessRec(&rec5);
+  agg2.ProcessRec(&rec5);
 
   agg.Print();
+  agg.PrintStats();
+  agg2.Print();
+  agg2.PrintPerf();
+
+  std::vector<uint32_t> wide = WideProgram(600);
+  if (!CheckOverflow() ||
+      !CheckJit(program, g_prog_len, 10000) ||
+      !CheckJit(program2, g_prog2_len, 10000) ||
+      !CheckSharedScan(program, g_prog_len, program2, g_prog2_len, 100) ||
+      !CheckSortedInput(program, g_prog_len, 1000) ||
+      !CheckPartitioned(program, g_prog_len, 1000) ||
+      !CheckPartitioned(wide.data(), wide.size(), 1000) ||
+      !CheckSpilled(program, g_prog_len, 2000)) {
+    return 1;
+  }
 
   return 0;
 }
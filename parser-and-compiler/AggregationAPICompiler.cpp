@@ -25,6 +25,8 @@
 #include <iostream>
 #include <assert.h>
 #include <cstring>
+#include <limits>
+#include <vector>
 #include "AggregationAPICompiler.hpp"
 #define UINT_MAX ((uint)0xffffffff)
 using std::cout;
@@ -33,14 +35,19 @@ using std::max;
 AggregationAPICompiler::AggregationAPICompiler
     (std::function<int(LexString)> column_name_to_idx,
      std::function<LexString(int)> column_idx_to_name,
-     ArenaAllocator* aalloc):
+     ArenaAllocator* aalloc,
+     uint expected_exprs):
   m_column_name_to_idx(column_name_to_idx),
   m_column_idx_to_name(column_idx_to_name),
   m_aalloc(aalloc),
-  m_exprs(aalloc),
+  m_exprs(aalloc, expected_exprs),
+  m_expr_index(aalloc),
   m_aggs(aalloc),
+  m_agg_index(aalloc),
   m_constants(aalloc),
-  m_program(aalloc)
+  m_constant_index(aalloc),
+  m_constant_sources(aalloc),
+  m_program(aalloc, 2 * expected_exprs)
 {}
 
 AggregationAPICompiler::Status
@@ -71,8 +78,8 @@ AggregationAPICompiler::new_expr(ExprOp op,
   assert(m_status == Status::PROGRAMMING ||
          m_status == Status::COMPILING ||
          m_status == Status::COMPILED);
-  assert(left == NULL || m_exprs.has_item(left));
-  assert(right == NULL || m_exprs.has_item(right));
+  assert(left == NULL || m_exprs.has_item(left, left->id));
+  assert(right == NULL || m_exprs.has_item(right, right->id));
   Expr e;
   e.op = op;
   e.left = left;
@@ -139,20 +146,29 @@ AggregationAPICompiler::new_expr(ExprOp op,
     default:
       assert(false);
     }
-    m_constants.push({result});
-    return new_expr(ExprOp::LoadConstantInt, 0, 0, m_constants.size() - 1);
+    uint folded = push_constant(result);
+    new_constant_source(ConstantSourceKind::Folded,
+                        folded,
+                        op,
+                        left->idx,
+                        right->idx);
+    return new_expr(ExprOp::LoadConstantInt, 0, 0, folded);
   }
   // Deduplication
-  for (uint i=0; i<m_exprs.size(); i++)
+  uint32_t hash = HashIndex::combine(uint32_t(op), idx);
+  hash = HashIndex::combine(hash, left == NULL ? 0 : left->id + 1);
+  hash = HashIndex::combine(hash, right == NULL ? 0 : right->id + 1);
+  int found = m_expr_index.find(hash, [this, &e](uint i) -> bool
   {
     Expr* other = &m_exprs[i];
-    if (e.op == other->op &&
-       e.left == other->left &&
-       e.right == other->right &&
-       e.idx == other->idx)
-    {
-      return other;
-    }
+    return e.op == other->op &&
+      e.left == other->left &&
+      e.right == other->right &&
+      e.idx == other->idx;
+  });
+  if (found != -1)
+  {
+    return &m_exprs[found];
   }
   // Since new expressions are only to be created during programming, the
   // above deduplication should always succeed during compilation.
@@ -165,7 +181,9 @@ AggregationAPICompiler::new_expr(ExprOp op,
   {
     right->usage++;
   }
+  e.id = m_exprs.size();
   m_exprs.push(e);
+  m_expr_index.insert(hash, e.id);
   return &m_exprs.last_item();
 }
 
@@ -177,7 +195,7 @@ AggregationAPICompiler::new_agg(AggregationAPICompiler::AggType agg_type,
   {
     return -1;
   }
-  assert(m_exprs.has_item(expr));
+  assert(m_exprs.has_item(expr, expr->id));
   assert(m_status == Status::PROGRAMMING ||
          m_status == Status::COMPILING ||
           m_status == Status::COMPILED);
@@ -185,20 +203,23 @@ AggregationAPICompiler::new_agg(AggregationAPICompiler::AggType agg_type,
   agg.agg_type = agg_type;
   agg.expr = expr;
   // Deduplication
-  for (uint i=0; i<m_aggs.size(); i++)
+  uint32_t hash = HashIndex::combine(uint32_t(agg_type), expr->id);
+  int found = m_agg_index.find(hash, [this, &agg](uint i) -> bool
   {
     AggExpr* other = &m_aggs[i];
-    if (agg.agg_type == other->agg_type &&
-        agg.expr == other->expr)
-    {
-      return i;
-    }
+    return agg.agg_type == other->agg_type &&
+      agg.expr == other->expr;
+  });
+  if (found != -1)
+  {
+    return found;
   }
   // Since new aggregates are only to be created during programming, the above
   // deduplication should always succeed during compilation.
   assert_status(PROGRAMMING);
   expr->usage++;
   m_aggs.push(agg);
+  m_agg_index.insert(hash, m_aggs.size() - 1);
   return m_aggs.size() - 1;
 }
 
@@ -228,18 +249,80 @@ AggregationAPICompiler::Load(const char* col_name)
   return Load(ls);
 }
 
-AggregationAPICompiler::Expr*
-AggregationAPICompiler::ConstantInteger(long int long_int)
+uint
+AggregationAPICompiler::constant_index(long int long_int)
 {
-  for (uint idx = 0; idx < m_constants.size(); idx++)
+  int found = m_constant_index.find(HashIndex::combine(0, long_int),
+                                    [this, long_int](uint i) -> bool
   {
-    if (m_constants[idx].long_int == long_int)
-    {
-      return new_expr(ExprOp::LoadConstantInt, 0, 0, idx);
-    }
+    return m_constants[i].long_int == long_int;
+  });
+  if (found != -1)
+  {
+    return found;
+  }
+  return push_constant(long_int);
+}
+
+/*
+ * Add a constant without deduplication, which is what constant folding does.
+ * The constant is only added to the hash-consing table if it's the first one
+ * with its value, so that constant_index finds the same constant as before.
+ */
+uint
+AggregationAPICompiler::push_constant(long int long_int)
+{
+  uint32_t hash = HashIndex::combine(0, long_int);
+  uint idx = m_constants.size();
+  if (m_constant_index.find(hash, [this, long_int](uint i) -> bool
+      {
+        return m_constants[i].long_int == long_int;
+      }) == -1)
+  {
+    m_constant_index.insert(hash, idx);
   }
   m_constants.push({long_int});
-  return new_expr(ExprOp::LoadConstantInt, 0, 0, m_constants.size() - 1);
+  return idx;
+}
+
+void
+AggregationAPICompiler::new_constant_source(ConstantSourceKind kind,
+                                            uint constant,
+                                            ExprOp op,
+                                            uint left,
+                                            uint right)
+{
+  ConstantSource source;
+  source.kind = kind;
+  source.constant = constant;
+  source.op = op;
+  source.left = left;
+  source.right = right;
+  m_constant_sources.push(source);
+}
+
+AggregationAPICompiler::Expr*
+AggregationAPICompiler::ConstantInteger(long int long_int)
+{
+  uint idx = constant_index(long_int);
+  new_constant_source(ConstantSourceKind::Fixed,
+                      idx,
+                      ExprOp::LoadConstantInt,
+                      0,
+                      0);
+  return new_expr(ExprOp::LoadConstantInt, 0, 0, idx);
+}
+
+AggregationAPICompiler::Expr*
+AggregationAPICompiler::Parameter(uint param_idx, long int long_int)
+{
+  uint idx = constant_index(long_int);
+  new_constant_source(ConstantSourceKind::Parameter,
+                      idx,
+                      ExprOp::LoadConstantInt,
+                      param_idx,
+                      0);
+  return new_expr(ExprOp::LoadConstantInt, 0, 0, idx);
 }
 
 AggregationAPICompiler::Expr*
@@ -1020,3 +1103,224 @@ operator<< (std::ostream& os,
 /*
  * End of Aggregation Program Printer
  */
+
+/*
+ * Start of Aggregation Program Serializer
+ *
+ * After compilation, the program and its constants can be written to a flat
+ * word buffer owned by the caller. Unlike the compiler state, the buffer does
+ * not point into the arena, so it can outlive the compiler, e.g. in a prepared
+ * program cache. Format:
+ *
+ *   word 0:       number of instructions N
+ *   word 1:       number of constants C
+ *   word 2:       number of constant sources S
+ *   2N words:     per instruction, type << 16 | dest, then src
+ *   2C words:     per constant, low word then high word
+ *   4S words:     per constant source, the constant index, then
+ *                 kind << 16 | folded operation, then either the fixed value
+ *                 (low and high word), the parameter index and 0, or the left
+ *                 and right folded operand constant indexes.
+ *
+ * The src word of a Load instruction is the column index, unless the caller
+ * passes load_sources, in which case it is load_sources[column index]. This
+ * lets RestSQLPreparer substitute the real column index and type from the
+ * schema catalog without the compiler knowing about the schema.
+ */
+
+static inline long int
+read_long_int(const uint32_t* src)
+{
+  return (long int)(uint64_t(src[0]) | (uint64_t(src[1]) << 32));
+}
+
+static inline void
+write_long_int(uint32_t* dest, long int value)
+{
+  dest[0] = uint32_t(uint64_t(value));
+  dest[1] = uint32_t(uint64_t(value) >> 32);
+}
+
+uint
+AggregationAPICompiler::number_of_aggregates()
+{
+  assert_status(COMPILED);
+  return m_aggs.size();
+}
+
+uint
+AggregationAPICompiler::bytecode_length()
+{
+  assert_status(COMPILED);
+  return 3 +
+    2 * m_program.size() +
+    2 * m_constants.size() +
+    4 * m_constant_sources.size();
+}
+
+void
+AggregationAPICompiler::write_bytecode(uint32_t* dest,
+                                       const uint32_t* load_sources)
+{
+  assert_status(COMPILED);
+  uint32_t* p = dest;
+  *p++ = m_program.size();
+  *p++ = m_constants.size();
+  *p++ = m_constant_sources.size();
+  for (uint i=0; i<m_program.size(); i++)
+  {
+    Instr& instr = m_program[i];
+    assert(instr.dest <= 0xffff);
+    *p++ = (uint32_t(instr.type) << 16) | instr.dest;
+    if (instr.type == SVMInstrType::Load && load_sources != NULL)
+    {
+      *p++ = load_sources[instr.src];
+    }
+    else
+    {
+      *p++ = instr.src;
+    }
+  }
+  for (uint i=0; i<m_constants.size(); i++)
+  {
+    write_long_int(p, m_constants[i].long_int);
+    p += 2;
+  }
+  for (uint i=0; i<m_constant_sources.size(); i++)
+  {
+    ConstantSource& source = m_constant_sources[i];
+    *p++ = source.constant;
+    *p++ = (uint32_t(source.kind) << 16) | uint32_t(source.op);
+    if (source.kind == ConstantSourceKind::Fixed)
+    {
+      write_long_int(p, m_constants[source.constant].long_int);
+    }
+    else
+    {
+      p[0] = source.left;
+      p[1] = source.right;
+    }
+    p += 2;
+  }
+  assert(p == dest + bytecode_length());
+}
+
+/*
+ * Give the constants in a program written by write_bytecode the values they
+ * would have had if the program was compiled with the given parameter values.
+ * Return false if the program is not valid for those values, i.e. if a
+ * constant that was shared through deduplication would now need two different
+ * values, if constant folding would divide by zero or overflow, or if a
+ * parameter is missing. In that case, the bytecode is left in an undefined
+ * state and the statement has to be compiled again. Also return false if the
+ * bytecode is not bytecode_len words long as given by its header, or refers to
+ * constants that don't exist.
+ */
+bool
+AggregationAPICompiler::bind_parameters(uint32_t* bytecode,
+                                        uint bytecode_len,
+                                        const long int* params,
+                                        uint n_params)
+{
+  if (bytecode_len < 3)
+  {
+    return false;
+  }
+  uint32_t n_instr = bytecode[0];
+  uint32_t n_constants = bytecode[1];
+  uint32_t n_sources = bytecode[2];
+  if (3 + 2 * uint64_t(n_instr) + 2 * uint64_t(n_constants) +
+      4 * uint64_t(n_sources) != bytecode_len)
+  {
+    return false;
+  }
+  uint32_t* constants = bytecode + 3 + 2 * n_instr;
+  const uint32_t* sources = constants + 2 * n_constants;
+  std::vector<bool> defined(n_constants, false);
+  for (uint i=0; i<n_sources; i++)
+  {
+    const uint32_t* source = &sources[4 * i];
+    uint32_t constant = source[0];
+    ConstantSourceKind kind = ConstantSourceKind(source[1] >> 16);
+    ExprOp op = ExprOp(source[1] & 0xffff);
+    if (constant >= n_constants)
+    {
+      return false;
+    }
+    long int value = 0;
+    switch (kind)
+    {
+    case ConstantSourceKind::Fixed:
+      value = read_long_int(&source[2]);
+      break;
+    case ConstantSourceKind::Parameter:
+      if (source[2] >= n_params)
+      {
+        return false;
+      }
+      value = params[source[2]];
+      break;
+    case ConstantSourceKind::Folded:
+      {
+        // In a valid program, earlier sources have defined both operands.
+        if (source[2] >= n_constants || !defined[source[2]] ||
+            source[3] >= n_constants || !defined[source[3]])
+        {
+          return false;
+        }
+        long int arg1 = read_long_int(&constants[2 * source[2]]);
+        long int arg2 = read_long_int(&constants[2 * source[3]]);
+        bool overflow = false;
+        switch (op)
+        {
+        case ExprOp::Add:
+          overflow = __builtin_add_overflow(arg1, arg2, &value);
+          break;
+        case ExprOp::Minus:
+          overflow = __builtin_sub_overflow(arg1, arg2, &value);
+          break;
+        case ExprOp::Mul:
+          overflow = __builtin_mul_overflow(arg1, arg2, &value);
+          break;
+        case ExprOp::Div:
+        case ExprOp::Rem:
+          if (arg2 == 0)
+          {
+            return false;
+          }
+          // LONG_MIN / -1 overflows, and so does LONG_MIN % -1 in C++.
+          overflow = arg1 == std::numeric_limits<long int>::min() &&
+                     arg2 == -1;
+          if (!overflow)
+          {
+            value = op == ExprOp::Div ? arg1 / arg2 : arg1 % arg2;
+          }
+          break;
+        default:
+          assert(false);
+        }
+        if (overflow)
+        {
+          return false;
+        }
+      }
+      break;
+    default:
+      assert(false);
+    }
+    if (!defined[constant])
+    {
+      write_long_int(&constants[2 * constant], value);
+      defined[constant] = true;
+    }
+    else if (read_long_int(&constants[2 * constant]) != value)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * End of Aggregation Program Serializer
+ */
@@ -26,11 +26,13 @@
 #define AggregationAPICompiler_hpp 1
 
 #include <stdlib.h>
+#include <cstdint>
 #include <stdexcept>
 #include <functional>
 #include "LexString.hpp"
 #include "ArenaAllocator.hpp"
 #include "DynamicArray.hpp"
+#include "HashIndex.hpp"
 // todo order and remove superfluous includes
 using std::string;
 
@@ -57,9 +59,11 @@ using std::string;
 class AggregationAPICompiler
 {
 public:
+  // expected_exprs is a hint used to size the internal arrays.
   AggregationAPICompiler(std::function<int(LexString)> column_name_to_idx,
              std::function<LexString(int)> column_idx_to_name,
-             ArenaAllocator* aalloc);
+             ArenaAllocator* aalloc,
+             uint expected_exprs = 0);
   enum class Status
   {
     PROGRAMMING, // High-level API available only in this state
@@ -91,6 +95,7 @@ public:
     Expr* right = NULL; // Right argument to binary operation
     uint idx = 0; // Column number for load operation, or index in constant list
                   // for loadconstant operations
+    uint id = 0; // Index in m_exprs
     int usage = 0; // Reference count from Expr and AggExpr.
                    // Only used for asserts.
     uint est_regs = 0; // Estimated number of registers necessary to calculate
@@ -112,6 +117,7 @@ private:
   std::function<int(LexString)> m_column_name_to_idx = NULL;
   std::function<LexString(int)> m_column_idx_to_name = NULL;
   DynamicArray<Expr> m_exprs;
+  HashIndex m_expr_index; // Hash-consing table for m_exprs
   Expr* new_expr(ExprOp op, Expr* left, Expr* right, uint idx);
 #define AGG_ENUM(Name) Name,
   enum class AggType
@@ -125,13 +131,47 @@ private:
     Expr* expr = NULL;
   };
   DynamicArray<AggExpr> m_aggs;
+  HashIndex m_agg_index; // Hash-consing table for m_aggs
   int new_agg(AggType agg_type, Expr* expr);
   DynamicArray<Constant> m_constants;
+  HashIndex m_constant_index; // First index in m_constants for each value
+  /*
+   * Every way a constant got its value, in order of creation. Deduplication
+   * and constant folding depend on the values of the constants, so a program
+   * compiled for some parameter values can be reused for other values only if
+   * replaying these sources gives each constant a single value. See
+   * bind_parameters().
+   */
+  enum class ConstantSourceKind
+  {
+    Fixed,     // Value given by ConstantInteger
+    Parameter, // Value of a parameter, given by Parameter
+    Folded,    // Result of constant folding
+  };
+  struct ConstantSource
+  {
+    ConstantSourceKind kind;
+    uint constant;         // Index in m_constants
+    ExprOp op = ExprOp::LoadConstantInt; // Folded operation
+    uint left = 0;         // Parameter index, or left folded operand
+    uint right = 0;        // Right folded operand
+  };
+  DynamicArray<ConstantSource> m_constant_sources;
+  void new_constant_source(ConstantSourceKind kind,
+                           uint constant,
+                           ExprOp op,
+                           uint left,
+                           uint right);
+  uint constant_index(long int long_int);
+  uint push_constant(long int long_int);
 public:
   // Load operations
   Expr* Load(LexString col_name);
   Expr* Load(const char* col_name);
   Expr* ConstantInteger(long int long_int);
+  // A literal from the SQL statement, i.e. a constant that may be given
+  // another value when the compiled program is reused.
+  Expr* Parameter(uint param_idx, long int long_int);
   // Arithmetic and aggregation operations could easily have been defined using
   // templates, but we prefer doing it without templates and with better
   // argument names.
@@ -240,6 +280,16 @@ public:
     return QuotedIdentifier(id);
   }
 
+  // Aggregation Program Serializer
+public:
+  uint number_of_aggregates();
+  uint bytecode_length();
+  void write_bytecode(uint32_t* dest, const uint32_t* load_sources = NULL);
+  static bool bind_parameters(uint32_t* bytecode,
+                              uint bytecode_len,
+                              const long int* params,
+                              uint n_params);
+
 }; // End of class AggregationAPICompiler
 
 #endif
@@ -22,6 +22,7 @@
    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
 */
 
+#include <cstdlib> // malloc, free
 #include <cstring> // memcpy
 #include "ArenaAllocator.hpp"
 
@@ -29,25 +30,73 @@ ArenaAllocator::ArenaAllocator()
 {
   m_point = &m_initial_stack_allocated_page[0];
   m_stop = ((byte*)this) + sizeof(*this);
+  m_stats.bytes_reserved = INITIAL_PAGE_SIZE;
 }
 
 ArenaAllocator::~ArenaAllocator()
 {
-  while (m_current_page)
+  free_pages(m_current_page);
+  free_pages(m_spare_pages);
+  flush_stats();
+}
+
+#define FORALL_STATS(X) \
+  X(bytes_requested) \
+  X(bytes_reserved) \
+  X(pages) \
+  X(pages_from_heap) \
+  X(reallocs_in_place) \
+  X(reallocs_copied)
+
+ArenaAllocator::Stats&
+ArenaAllocator::Stats::operator+= (const Stats& other)
+{
+#define ADD_STAT(Name) Name += other.Name;
+  FORALL_STATS(ADD_STAT)
+#undef ADD_STAT
+  return *this;
+}
+
+ArenaAllocator::Stats
+ArenaAllocator::Stats::operator- (const Stats& other) const
+{
+  Stats ret;
+#define SUB_STAT(Name) ret.Name = Name - other.Name;
+  FORALL_STATS(SUB_STAT)
+#undef SUB_STAT
+  return ret;
+}
+
+namespace
+{
+  struct GlobalArenaStats
   {
-    Page* next = (Page*)m_current_page->next;
-    free(m_current_page);
-    m_current_page = next;
-  }
-# ifdef ARENA_ALLOCATOR_DEBUG
-  printf("In ~ArenaAllocator\n"
-         "  Total allocated by us: %u\n"
-         "  Total allocated by user: %u\n"
-         "  Efficiency: %u%%\n",
-         m_allocated_by_us,
-         m_allocated_by_user,
-         100 * m_allocated_by_user / m_allocated_by_us);
-# endif
+#define DECLARE_STAT(Name) std::atomic<unsigned long int> Name{0};
+    FORALL_STATS(DECLARE_STAT)
+#undef DECLARE_STAT
+  };
+  GlobalArenaStats global_arena_stats;
+}
+
+void
+ArenaAllocator::flush_stats()
+{
+#define FLUSH_STAT(Name) \
+  global_arena_stats.Name.fetch_add(m_stats.Name, std::memory_order_relaxed);
+  FORALL_STATS(FLUSH_STAT)
+#undef FLUSH_STAT
+  m_stats = Stats();
+}
+
+ArenaAllocator::Stats
+ArenaAllocator::get_global_stats()
+{
+  Stats ret;
+#define LOAD_STAT(Name) \
+  ret.Name = global_arena_stats.Name.load(std::memory_order_relaxed);
+  FORALL_STATS(LOAD_STAT)
+#undef LOAD_STAT
+  return ret;
 }
 
 void*
@@ -66,29 +115,203 @@ ArenaAllocator::alloc(size_t size)
     {
       m_page_data_size *= 2;
     }
-    Page* new_page = (Page*)malloc(m_page_data_size);
-    if (!new_page)
-    {
-      throw std::runtime_error("ArenaAllocator: Out of memory");
-    }
-#   ifdef ARENA_ALLOCATOR_DEBUG
-    m_allocated_by_us += m_page_data_size;
-#   endif
-    new_page->next = m_current_page;
-    m_current_page = new_page;
-    m_point = new_page->data;
-    m_stop = ((byte*)new_page) + m_page_data_size;
+    Page* page = new_page(m_page_data_size);
+    page->next = m_current_page;
+    m_current_page = page;
+    m_point = page->data;
+    m_stop = ((byte*)page) + page->size;
     new_point = m_point + size;
     assert(new_point < m_stop);
   }
   void* ret = m_point;
   m_point = new_point;
-# ifdef ARENA_ALLOCATOR_DEBUG
-  m_allocated_by_user += size;
-# endif
+  m_stats.bytes_requested += size;
   return ret;
 }
 
+/*
+ * Return a page of at least min_size bytes, preferably a spare one.
+ */
+ArenaAllocator::Page*
+ArenaAllocator::new_page(size_t min_size)
+{
+  Page** link = &m_spare_pages;
+  while (*link != NULL)
+  {
+    Page* page = *link;
+    if (page->size >= min_size)
+    {
+      *link = page->next;
+      m_stats.pages++;
+      m_stats.bytes_reserved += page->size;
+      return page;
+    }
+    link = &page->next;
+  }
+  Page* page = (Page*)malloc(min_size);
+  if (!page)
+  {
+    throw std::runtime_error("ArenaAllocator: Out of memory");
+  }
+  page->size = min_size;
+  m_stats.pages++;
+  m_stats.pages_from_heap++;
+  m_stats.bytes_reserved += min_size;
+  return page;
+}
+
+void
+ArenaAllocator::free_pages(Page* page)
+{
+  while (page)
+  {
+    Page* next = page->next;
+    free(page);
+    page = next;
+  }
+}
+
+void
+ArenaAllocator::reset(size_t max_retained_size)
+{
+  /*
+   * m_current_page is newest first. Reverse it onto the remaining spare pages,
+   * so that the next cycle reuses the pages in the order they were allocated.
+   * Since the page size only grows within a cycle, this means the same
+   * sequence of allocations will find a fitting spare page every time.
+   */
+  Page* spare = m_spare_pages;
+  while (m_current_page)
+  {
+    Page* next = m_current_page->next;
+    m_current_page->next = spare;
+    spare = m_current_page;
+    m_current_page = next;
+  }
+  size_t retained_size = 0;
+  Page** link = &spare;
+  while (*link != NULL && retained_size + (*link)->size <= max_retained_size)
+  {
+    retained_size += (*link)->size;
+    link = &(*link)->next;
+  }
+  free_pages(*link);
+  *link = NULL;
+  m_spare_pages = spare;
+  m_page_data_size = DEFAULT_PAGE_SIZE;
+  m_point = &m_initial_stack_allocated_page[0];
+  m_stop = ((byte*)this) + sizeof(*this);
+  flush_stats();
+  m_stats.bytes_reserved = INITIAL_PAGE_SIZE;
+}
+
+void
+ArenaAllocator::size_hint(size_t expected_size)
+{
+  size_t wanted = expected_size + OVERHEAD;
+  if (wanted > MAX_HINTED_PAGE_SIZE)
+  {
+    wanted = MAX_HINTED_PAGE_SIZE;
+  }
+  while (m_page_data_size < wanted)
+  {
+    m_page_data_size *= 2;
+  }
+}
+
+ArenaSizingStats&
+ArenaSizingStats::global()
+{
+  static ArenaSizingStats stats;
+  return stats;
+}
+
+unsigned int
+ArenaSizingStats::bucket_for(size_t sql_len)
+{
+  unsigned int bucket = 0;
+  while (bucket < BUCKETS - 1 && (size_t(2) << bucket) <= sql_len)
+  {
+    bucket++;
+  }
+  return bucket;
+}
+
+void
+ArenaSizingStats::record(size_t sql_len, size_t arena_bytes)
+{
+  AtomicBucket& bucket = m_buckets[bucket_for(sql_len)];
+  bucket.statements.fetch_add(1, std::memory_order_relaxed);
+  bucket.total_bytes.fetch_add(arena_bytes, std::memory_order_relaxed);
+  unsigned long int max = bucket.max_bytes.load(std::memory_order_relaxed);
+  while (max < arena_bytes &&
+         !bucket.max_bytes.compare_exchange_weak(max,
+                                                 arena_bytes,
+                                                 std::memory_order_relaxed))
+  {}
+}
+
+size_t
+ArenaSizingStats::suggested_size(size_t sql_len) const
+{
+  Bucket bucket = get_bucket(bucket_for(sql_len));
+  if (bucket.statements < MIN_SAMPLES)
+  {
+    return sql_len * DEFAULT_BYTES_PER_SQL_BYTE;
+  }
+  size_t mean = bucket.total_bytes / bucket.statements;
+  return mean + mean / 4;
+}
+
+ArenaSizingStats::Bucket
+ArenaSizingStats::get_bucket(unsigned int bucket) const
+{
+  assert(bucket < BUCKETS);
+  const AtomicBucket& src = m_buckets[bucket];
+  Bucket ret;
+  ret.statements = src.statements.load(std::memory_order_relaxed);
+  ret.total_bytes = src.total_bytes.load(std::memory_order_relaxed);
+  ret.max_bytes = src.max_bytes.load(std::memory_order_relaxed);
+  return ret;
+}
+
+namespace
+{
+  struct ArenaAllocatorPool
+  {
+    ArenaAllocator* arenas[PooledArenaAllocator::MAX_POOLED_PER_THREAD];
+    unsigned int count = 0;
+    ~ArenaAllocatorPool()
+    {
+      while (count > 0)
+      {
+        delete arenas[--count];
+      }
+    }
+  };
+  thread_local ArenaAllocatorPool arena_allocator_pool;
+}
+
+PooledArenaAllocator::PooledArenaAllocator()
+{
+  ArenaAllocatorPool& pool = arena_allocator_pool;
+  m_arena = pool.count > 0 ? pool.arenas[--pool.count] : new ArenaAllocator();
+}
+
+PooledArenaAllocator::~PooledArenaAllocator()
+{
+  ArenaAllocatorPool& pool = arena_allocator_pool;
+  if (pool.count < MAX_POOLED_PER_THREAD)
+  {
+    m_arena->reset();
+    pool.arenas[pool.count++] = m_arena;
+  }
+  else
+  {
+    delete m_arena;
+  }
+}
+
 /*
  * WARNING: ArenaAllocator::realloc can return a non-const pointer to the same
  *          memory as the argument `const void* ptr`. Make sure not to write to
@@ -115,12 +338,15 @@ ArenaAllocator::realloc(const void* ptr, size_t size, size_t original_size)
     // current page is sufficient to accommodate the new allocation. Therefore,
     // we can reallocate in-place.
     m_point += (size - original_size);
+    m_stats.bytes_requested += (size - original_size);
+    m_stats.reallocs_in_place++;
     assert(m_point == &byte_ptr[size]);
     void* nonconst_ptr = &m_point[-size];
     assert((const void*)nonconst_ptr == ptr);
     return nonconst_ptr;
   }
   // Do not reallocate in-place.
+  m_stats.reallocs_copied++;
   void* new_alloc = alloc(size);
   size_t cplen = size < original_size ? size : original_size;
   memcpy(new_alloc, ptr, cplen);
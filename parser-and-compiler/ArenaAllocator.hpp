@@ -26,42 +26,166 @@
 #define ArenaAllocator_hpp_included 1
 
 #include <assert.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <stdexcept>
 
-//#define ARENA_ALLOCATOR_DEBUG 1
-
 class ArenaAllocator
 {
+public:
+  /*
+   * Memory usage counters. They are kept per arena at the cost of an increment
+   * or two per allocation, and cover the time since construction or the last
+   * reset(). On reset() and destruction, they are added to the process-wide
+   * totals returned by get_global_stats().
+   */
+  struct Stats
+  {
+    unsigned long int bytes_requested = 0; // Sum of allocation sizes
+    unsigned long int bytes_reserved = 0; // Size of pages taken into use,
+                                          // including the inline page
+    unsigned long int pages = 0; // Pages taken into use, excluding the inline
+                                 // page
+    unsigned long int pages_from_heap = 0; // Of those, pages that were not
+                                           // retained by reset() but malloc'ed
+    unsigned long int reallocs_in_place = 0;
+    unsigned long int reallocs_copied = 0;
+    Stats& operator+= (const Stats& other);
+    Stats operator- (const Stats& other) const;
+  };
 private:
   enum class byte : uint8_t {};
   /*
-   * todo: These two parameters could be dynamic. With some statistics, we
-   * should be able to tune these as a function of SQL statement length, which
-   * we'll probably know before we create the arena allocator.
+   * The page size grows as needed, but can also be raised up front with
+   * size_hint(), e.g. from ArenaSizingStats::suggested_size().
    */
   static const size_t DEFAULT_PAGE_SIZE = 256;
   static const size_t INITIAL_PAGE_SIZE = 80;
+  static const size_t MAX_HINTED_PAGE_SIZE = 1024 * 1024;
   size_t m_page_data_size = DEFAULT_PAGE_SIZE;
+  Stats m_stats;
+  void flush_stats();
   struct Page
   {
     struct Page* next = NULL;
+    size_t size; // Including OVERHEAD
     byte data[1]; // Actually an arbitrary amount
   };
   static const size_t OVERHEAD = offsetof(struct Page, data);
   static_assert(OVERHEAD < DEFAULT_PAGE_SIZE, "default page size too small");
   struct Page* m_current_page = NULL;
+  /*
+   * Pages retained by reset(), in the order they were first used. They are
+   * reused before any new page is allocated.
+   */
+  struct Page* m_spare_pages = NULL;
+  Page* new_page(size_t min_size);
+  static void free_pages(Page* page);
   byte* m_point = NULL;
   byte* m_stop = NULL;
-# ifdef ARENA_ALLOCATOR_DEBUG
-  unsigned long int m_allocated_by_us = sizeof(ArenaAllocator);
-  unsigned long int m_allocated_by_user = 0;
-# endif
   byte m_initial_stack_allocated_page[INITIAL_PAGE_SIZE]; // MUST be last!
 public:
+  static const size_t DEFAULT_MAX_RETAINED_SIZE = 64 * 1024;
   ArenaAllocator();
   ~ArenaAllocator();
   void* alloc(size_t size);
   void* realloc(const void* ptr, size_t size, size_t original_size);
+  /*
+   * Invalidate all allocations and rewind to the initial page, keeping up to
+   * max_retained_size bytes of pages for reuse. An arena that is reset between
+   * statements of similar size will soon stop allocating from the heap.
+   */
+  void reset(size_t max_retained_size = DEFAULT_MAX_RETAINED_SIZE);
+  /*
+   * Announce that about expected_size more bytes will be allocated, so that
+   * the next page can be allocated with that size rather than after a chain
+   * of smaller pages.
+   */
+  void size_hint(size_t expected_size);
+  // Total size of allocations since construction or the last reset().
+  size_t bytes_requested() const
+  {
+    return m_stats.bytes_requested;
+  }
+  const Stats& get_stats() const
+  {
+    return m_stats;
+  }
+  /*
+   * Sum of the stats of all arenas in the process, as of their last reset() or
+   * destruction. Safe to call from any thread.
+   */
+  static Stats get_global_stats();
+};
+
+/*
+ * Thread-safe statistics on the arena usage of statements, bucketed by the
+ * binary logarithm of the statement length. RestSQLPreparer records every
+ * statement in global() and asks it for an arena size hint, so the hint adapts
+ * to the actual workload.
+ */
+class ArenaSizingStats
+{
+public:
+  static const unsigned int BUCKETS = 32;
+  static const unsigned int MIN_SAMPLES = 16;
+  /*
+   * Before a bucket has MIN_SAMPLES statements, the suggestion is the
+   * statement length times this factor.
+   */
+  static const size_t DEFAULT_BYTES_PER_SQL_BYTE = 8;
+  struct Bucket
+  {
+    unsigned long int statements;
+    unsigned long int total_bytes;
+    unsigned long int max_bytes;
+  };
+  static ArenaSizingStats& global();
+  void record(size_t sql_len, size_t arena_bytes);
+  /*
+   * Return the expected arena usage of a statement of the given length: the
+   * mean of its bucket with 25% headroom.
+   */
+  size_t suggested_size(size_t sql_len) const;
+  Bucket get_bucket(unsigned int bucket) const;
+  static unsigned int bucket_for(size_t sql_len);
+private:
+  struct AtomicBucket
+  {
+    std::atomic<unsigned long int> statements{0};
+    std::atomic<unsigned long int> total_bytes{0};
+    std::atomic<unsigned long int> max_bytes{0};
+  };
+  AtomicBucket m_buckets[BUCKETS];
+};
+
+/*
+ * An ArenaAllocator borrowed from a pool private to the current thread. On
+ * destruction, the arena is reset and given back to the pool of the thread
+ * that destroys it, or deleted if that pool is full. Together with reset()
+ * retaining pages, this lets a thread prepare statement after statement
+ * without heap allocation in the arena:
+ *
+ *   PooledArenaAllocator aalloc;
+ *   RestSQLPreparer prepare(sql_buffer, sql_len, aalloc.get());
+ *
+ * Since ArenaAllocator cannot be moved, neither can this.
+ */
+class PooledArenaAllocator
+{
+private:
+  ArenaAllocator* m_arena;
+public:
+  static const unsigned int MAX_POOLED_PER_THREAD = 4;
+  PooledArenaAllocator();
+  ~PooledArenaAllocator();
+  PooledArenaAllocator(const PooledArenaAllocator&) = delete;
+  PooledArenaAllocator& operator= (const PooledArenaAllocator&) = delete;
+  ArenaAllocator* get()
+  {
+    return m_arena;
+  }
 };
 
 #endif
@@ -0,0 +1,209 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include <stdio.h>
+#include <assert.h>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "ArenaAllocator.hpp"
+#include "DynamicArray.hpp"
+
+// Allocate a sequence of growing sizes and return the address of each
+// allocation.
+static std::vector<void*>
+allocate_sequence(ArenaAllocator* aalloc)
+{
+  std::vector<void*> ret;
+  for (size_t size = 1; size < 3000; size = size * 3 / 2 + 1)
+  {
+    void* ptr = aalloc->alloc(size);
+    memset(ptr, 0xab, size);
+    ret.push_back(ptr);
+  }
+  return ret;
+}
+
+int
+main(int argc, char** argv)
+{
+  // Test that reset() reuses the same pages for the same sequence of
+  // allocations, i.e. does not allocate from the heap.
+  {
+    ArenaAllocator aalloc;
+    std::vector<void*> first = allocate_sequence(&aalloc);
+    aalloc.reset();
+    std::vector<void*> second = allocate_sequence(&aalloc);
+    assert(first == second);
+    aalloc.reset();
+    assert(allocate_sequence(&aalloc) == first);
+    // A smaller sequence after reset also uses retained pages.
+    aalloc.reset();
+    void* small = aalloc.alloc(500);
+    assert(std::find(first.begin(), first.end(), small) != first.end());
+    // Retaining no pages is also possible.
+    aalloc.reset(0);
+    allocate_sequence(&aalloc);
+  }
+
+  // Test that realloc still works in place after reset.
+  {
+    ArenaAllocator aalloc;
+    allocate_sequence(&aalloc);
+    aalloc.reset();
+    char* str = static_cast<char*>(aalloc.alloc(10));
+    memcpy(str, "0123456789", 10);
+    char* str2 = static_cast<char*>(aalloc.realloc(str, 20, 10));
+    assert(str2 == str);
+    assert(memcmp(str2, "0123456789", 10) == 0);
+  }
+
+  // Test that a pooled arena is reused by the same thread but not by another.
+  {
+    ArenaAllocator* first;
+    {
+      PooledArenaAllocator aalloc;
+      first = aalloc.get();
+      allocate_sequence(first);
+    }
+    {
+      PooledArenaAllocator aalloc;
+      assert(aalloc.get() == first);
+      {
+        PooledArenaAllocator aalloc2;
+        assert(aalloc2.get() != first);
+      }
+    }
+    std::thread other([first]()
+    {
+      PooledArenaAllocator aalloc;
+      assert(aalloc.get() != first);
+      allocate_sequence(aalloc.get());
+    });
+    other.join();
+  }
+  // Test that a size hint gives one page instead of a chain of pages, and that
+  // bytes_requested counts allocations including in-place reallocations.
+  {
+    ArenaAllocator aalloc;
+    aalloc.size_hint(4000);
+    char* first = static_cast<char*>(aalloc.alloc(100));
+    for (int i = 0; i < 30; i++)
+    {
+      char* ptr = static_cast<char*>(aalloc.alloc(100));
+      assert(ptr == first + 100 * (i + 1));
+    }
+    aalloc.realloc(aalloc.alloc(10), 20, 10);
+    assert(aalloc.bytes_requested() == 31 * 100 + 20);
+    aalloc.reset();
+    assert(aalloc.bytes_requested() == 0);
+  }
+
+  // Test memory usage counters, and that they are aggregated across threads.
+  {
+    ArenaAllocator::Stats before = ArenaAllocator::get_global_stats();
+    {
+      ArenaAllocator aalloc;
+      const ArenaAllocator::Stats& stats = aalloc.get_stats();
+      assert(stats.bytes_requested == 0 && stats.pages == 0);
+      char* ptr = static_cast<char*>(aalloc.alloc(50));
+      ptr = static_cast<char*>(aalloc.realloc(ptr, 60, 50));
+      assert(stats.pages == 0);
+      ptr = static_cast<char*>(aalloc.realloc(ptr, 100, 60));
+      assert(stats.bytes_requested == 160);
+      assert(stats.reallocs_in_place == 1 && stats.reallocs_copied == 1);
+      assert(stats.pages == 1 && stats.pages_from_heap == 1);
+      assert(stats.bytes_reserved > 160);
+      aalloc.reset();
+      assert(stats.bytes_requested == 0 && stats.pages == 0);
+      aalloc.alloc(100);
+      assert(stats.pages == 1 && stats.pages_from_heap == 0);
+    }
+    std::thread threads[4];
+    for (std::thread& thread : threads)
+    {
+      thread = std::thread([]()
+      {
+        ArenaAllocator aalloc;
+        aalloc.alloc(1000);
+      });
+    }
+    for (std::thread& thread : threads)
+    {
+      thread.join();
+    }
+    ArenaAllocator::Stats delta = ArenaAllocator::get_global_stats() - before;
+    assert(delta.bytes_requested == 160 + 100 + 4 * 1000);
+    assert(delta.pages == 2 + 4);
+    assert(delta.pages_from_heap == 1 + 4);
+    assert(delta.reallocs_in_place == 1 && delta.reallocs_copied == 1);
+  }
+
+  // Test sizing statistics
+  {
+    ArenaSizingStats stats;
+    assert(ArenaSizingStats::bucket_for(0) == 0);
+    assert(ArenaSizingStats::bucket_for(1) == 0);
+    assert(ArenaSizingStats::bucket_for(2) == 1);
+    assert(ArenaSizingStats::bucket_for(1000) == 9);
+    assert(stats.suggested_size(100) ==
+           100 * ArenaSizingStats::DEFAULT_BYTES_PER_SQL_BYTE);
+    for (unsigned int i = 0; i < ArenaSizingStats::MIN_SAMPLES; i++)
+    {
+      stats.record(100 + i, i % 2 == 0 ? 1000 : 3000);
+    }
+    assert(stats.suggested_size(127) == 2500);
+    assert(stats.suggested_size(128) ==
+           128 * ArenaSizingStats::DEFAULT_BYTES_PER_SQL_BYTE);
+    ArenaSizingStats::Bucket bucket = stats.get_bucket(6);
+    assert(bucket.statements == ArenaSizingStats::MIN_SAMPLES);
+    assert(bucket.total_bytes == 2000 * ArenaSizingStats::MIN_SAMPLES);
+    assert(bucket.max_bytes == 3000);
+  }
+
+  // Test that dynamic arrays with different page sizes behave the same.
+  {
+    ArenaAllocator aalloc;
+    uint hints[] = { 0, 1, 3, 100, 100000 };
+    for (uint hint : hints)
+    {
+      DynamicArray<uint> array(&aalloc, hint);
+      for (uint i = 0; i < 5000; i++)
+      {
+        array.push(i * 7);
+      }
+      assert(array.size() == 5000);
+      for (uint i = 0; i < 5000; i++)
+      {
+        assert(array[i] == i * 7);
+        assert(array.has_item(&array[i], i));
+        assert(array.has_item(&array[i]));
+      }
+      assert(array.last_item() == 4999 * 7);
+    }
+  }
+  printf("OK\n");
+  return 0;
+}
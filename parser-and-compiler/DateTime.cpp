@@ -0,0 +1,846 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include <assert.h>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include "DateTime.hpp"
+
+namespace
+{
+  const uint days_in_month[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  // Day number of 9999-12-31
+  const long int MAX_DAY_NUMBER = 3652424;
+  const long int SECONDS_PER_DAY = 24 * 3600;
+
+  bool is_digit(char c)
+  {
+    return '0' <= c && c <= '9';
+  }
+
+  bool is_space(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+  uint days_in_year(uint year)
+  {
+    return ((year & 3) == 0 && (year % 100 != 0 || (year % 400 == 0 && year != 0)))
+      ? 366 : 365;
+  }
+
+  uint last_day_of_month(uint year, uint month)
+  {
+    if (month == 2 && days_in_year(year) == 366)
+    {
+      return 29;
+    }
+    return days_in_month[month - 1];
+  }
+
+  // MySQL's calc_daynr, where 0000-01-01 is day 1.
+  long int day_number(uint year, uint month, uint day)
+  {
+    if (year == 0 && month == 0)
+    {
+      return 0;
+    }
+    long int y = year;
+    long int delsum = 365 * y + 31 * (long int)(month - 1) + day;
+    if (month <= 2)
+    {
+      y--;
+    }
+    else
+    {
+      delsum -= (long int)(month * 4 + 23) / 10;
+    }
+    long int temp = ((y / 100 + 1) * 3) / 4;
+    return delsum + y / 4 - temp;
+  }
+
+  // MySQL's get_date_from_daynr. Day numbers up to 365 give 0000-00-00.
+  void date_from_day_number(long int daynr, uint& year, uint& month, uint& day)
+  {
+    if (daynr <= 365 || daynr >= 3652500)
+    {
+      year = month = day = 0;
+      return;
+    }
+    year = (uint)(daynr * 100 / 36525);
+    uint temp = (((year - 1) / 100 + 1) * 3) / 4;
+    uint day_of_year = (uint)(daynr - (long int)year * 365) - (year - 1) / 4 + temp;
+    uint year_days;
+    while (day_of_year > (year_days = days_in_year(year)))
+    {
+      day_of_year -= year_days;
+      year++;
+    }
+    uint leap_day = 0;
+    if (year_days == 366 && day_of_year > 31 + 28)
+    {
+      day_of_year--;
+      if (day_of_year == 31 + 28)
+      {
+        leap_day = 1;
+      }
+    }
+    month = 1;
+    while (day_of_year > days_in_month[month - 1])
+    {
+      day_of_year -= days_in_month[month - 1];
+      month++;
+    }
+    day = day_of_year + leap_day;
+  }
+
+  // MySQL's calc_weekday. 0 is Monday, or Sunday if sunday_first is true.
+  uint weekday(long int daynr, bool sunday_first)
+  {
+    return (uint)((daynr + 5 + (sunday_first ? 1 : 0)) % 7);
+  }
+
+  /*
+   * MySQL's calc_week for the default week mode 0, i.e. weeks start on Sunday
+   * and the days before the first Sunday of the year are in week 0.
+   */
+  uint week_mode_0(uint year, uint month, uint day)
+  {
+    long int daynr = day_number(year, month, day);
+    long int first_daynr = day_number(year, 1, 1);
+    uint first_weekday = weekday(first_daynr, true);
+    if (month == 1 && day <= 7 - first_weekday && first_weekday != 0)
+    {
+      return 0;
+    }
+    long int days = first_weekday != 0
+      ? daynr - (first_daynr + (7 - first_weekday))
+      : daynr - first_daynr;
+    return (uint)(days / 7 + 1);
+  }
+
+  bool has_microseconds(IntervalUnit unit)
+  {
+    switch (unit)
+    {
+    case IntervalUnit::Microsecond:
+    case IntervalUnit::SecondMicrosecond:
+    case IntervalUnit::MinuteMicrosecond:
+    case IntervalUnit::HourMicrosecond:
+    case IntervalUnit::DayMicrosecond:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  /*
+   * MySQL's get_interval_info. Read up to count numbers separated by non-digits.
+   * If there are fewer, they are aligned to the end of values. If fraction is
+   * true, the last number is microseconds given as decimals, i.e. "5" means
+   * 500000.
+   */
+  bool interval_parts(const char* str,
+                      const char* end,
+                      uint count,
+                      unsigned long int* values,
+                      bool fraction)
+  {
+    while (str != end && !is_digit(*str))
+    {
+      str++;
+    }
+    uint field_length = 0;
+    for (uint i = 0; i < count; i++)
+    {
+      const char* start = str;
+      unsigned long int value = 0;
+      for (; str != end && is_digit(*str); str++)
+      {
+        if (value > (LONG_MAX - 10) / 10)
+        {
+          return false;
+        }
+        value = value * 10 + (*str - '0');
+      }
+      field_length = (uint)(str - start);
+      values[i] = value;
+      while (str != end && !is_digit(*str))
+      {
+        str++;
+      }
+      if (str == end && i != count - 1)
+      {
+        uint found = i + 1;
+        for (uint j = 0; j < found; j++)
+        {
+          values[count - 1 - j] = values[found - 1 - j];
+        }
+        for (uint j = 0; j < count - found; j++)
+        {
+          values[j] = 0;
+        }
+        break;
+      }
+    }
+    if (fraction && field_length > 0)
+    {
+      for (; field_length < 6; field_length++)
+      {
+        values[count - 1] *= 10;
+      }
+      for (; field_length > 6; field_length--)
+      {
+        values[count - 1] /= 10;
+      }
+    }
+    return str == end;
+  }
+
+  /*
+   * Read a number of at most max_digits digits. Return the number of digits
+   * read.
+   */
+  uint read_number(const char*& str, const char* end, uint max_digits, uint& value)
+  {
+    uint digits = 0;
+    value = 0;
+    while (str != end && is_digit(*str) && digits < max_digits)
+    {
+      value = value * 10 + (*str - '0');
+      str++;
+      digits++;
+    }
+    return digits;
+  }
+
+  bool is_delimiter(char c)
+  {
+    return ('!' <= c && c <= '/') || (':' <= c && c <= '@') ||
+      ('[' <= c && c <= '`') || ('{' <= c && c <= '~');
+  }
+
+  uint two_digit_year(uint year)
+  {
+    return year < 70 ? year + 2000 : year + 1900;
+  }
+}
+
+bool
+Interval::parse(IntervalUnit unit, LexString value)
+{
+  *this = Interval();
+  const char* str = value.str;
+  const char* end = value.str + value.len;
+  while (str != end && is_space(*str))
+  {
+    str++;
+  }
+  if (str != end && *str == '-')
+  {
+    negative = true;
+    str++;
+  }
+  has_fraction = has_microseconds(unit);
+  unsigned long int v[5];
+  switch (unit)
+  {
+  case IntervalUnit::Second:
+    // MySQL reads a string argument for SECOND as a decimal number.
+    while (str != end && is_digit(*str))
+    {
+      if (second > (LONG_MAX - 10) / 10)
+      {
+        return false;
+      }
+      second = second * 10 + (*str - '0');
+      str++;
+    }
+    if (str != end && *str == '.')
+    {
+      str++;
+      for (uint scale = 100000; scale > 0 && str != end && is_digit(*str);
+           scale /= 10)
+      {
+        microsecond += (*str - '0') * scale;
+        str++;
+      }
+    }
+    has_fraction = microsecond != 0;
+    return true;
+  case IntervalUnit::Microsecond:
+  case IntervalUnit::Minute:
+  case IntervalUnit::Hour:
+  case IntervalUnit::Day:
+  case IntervalUnit::Week:
+  case IntervalUnit::Month:
+  case IntervalUnit::Quarter:
+  case IntervalUnit::Year:
+    {
+      // Like MySQL's conversion from string to integer, ignore anything after
+      // the leading digits.
+      unsigned long int number = 0;
+      while (str != end && is_digit(*str))
+      {
+        if (number > (LONG_MAX - 10) / 10)
+        {
+          return false;
+        }
+        number = number * 10 + (*str - '0');
+        str++;
+      }
+      return parse(unit, negative ? -(long int)number : (long int)number);
+    }
+  case IntervalUnit::SecondMicrosecond:
+    if (!interval_parts(str, end, 2, v, true)) return false;
+    second = v[0]; microsecond = v[1];
+    return true;
+  case IntervalUnit::MinuteMicrosecond:
+    if (!interval_parts(str, end, 3, v, true)) return false;
+    minute = v[0]; second = v[1]; microsecond = v[2];
+    return true;
+  case IntervalUnit::MinuteSecond:
+    if (!interval_parts(str, end, 2, v, false)) return false;
+    minute = v[0]; second = v[1];
+    return true;
+  case IntervalUnit::HourMicrosecond:
+    if (!interval_parts(str, end, 4, v, true)) return false;
+    hour = v[0]; minute = v[1]; second = v[2]; microsecond = v[3];
+    return true;
+  case IntervalUnit::HourSecond:
+    if (!interval_parts(str, end, 3, v, false)) return false;
+    hour = v[0]; minute = v[1]; second = v[2];
+    return true;
+  case IntervalUnit::HourMinute:
+    if (!interval_parts(str, end, 2, v, false)) return false;
+    hour = v[0]; minute = v[1];
+    return true;
+  case IntervalUnit::DayMicrosecond:
+    if (!interval_parts(str, end, 5, v, true)) return false;
+    day = v[0]; hour = v[1]; minute = v[2]; second = v[3]; microsecond = v[4];
+    return true;
+  case IntervalUnit::DaySecond:
+    if (!interval_parts(str, end, 4, v, false)) return false;
+    day = v[0]; hour = v[1]; minute = v[2]; second = v[3];
+    return true;
+  case IntervalUnit::DayMinute:
+    if (!interval_parts(str, end, 3, v, false)) return false;
+    day = v[0]; hour = v[1]; minute = v[2];
+    return true;
+  case IntervalUnit::DayHour:
+    if (!interval_parts(str, end, 2, v, false)) return false;
+    day = v[0]; hour = v[1];
+    return true;
+  case IntervalUnit::YearMonth:
+    if (!interval_parts(str, end, 2, v, false)) return false;
+    year = v[0]; month = v[1];
+    return true;
+  }
+  assert(false);
+  return false;
+}
+
+bool
+Interval::parse(IntervalUnit unit, long int value)
+{
+  switch (unit)
+  {
+  case IntervalUnit::Microsecond:
+  case IntervalUnit::Second:
+  case IntervalUnit::Minute:
+  case IntervalUnit::Hour:
+  case IntervalUnit::Day:
+  case IntervalUnit::Week:
+  case IntervalUnit::Month:
+  case IntervalUnit::Quarter:
+  case IntervalUnit::Year:
+    break;
+  default:
+    {
+      // Compound units read the number as a string, like MySQL does.
+      char buf[24];
+      int len = snprintf(buf, sizeof(buf), "%ld", value);
+      return parse(unit, LexString{buf, (size_t)len});
+    }
+  }
+  *this = Interval();
+  if (value == LONG_MIN)
+  {
+    return false;
+  }
+  if (value < 0)
+  {
+    negative = true;
+    value = -value;
+  }
+  unsigned long int v = (unsigned long int)value;
+  switch (unit)
+  {
+  case IntervalUnit::Microsecond:
+    microsecond = v;
+    has_fraction = true;
+    return true;
+  case IntervalUnit::Second:
+    second = v;
+    return true;
+  case IntervalUnit::Minute:
+    minute = v;
+    return true;
+  case IntervalUnit::Hour:
+    hour = v;
+    return true;
+  case IntervalUnit::Day:
+    day = v;
+    return true;
+  case IntervalUnit::Week:
+    if (v > ULONG_MAX / 7)
+    {
+      return false;
+    }
+    day = v * 7;
+    return true;
+  case IntervalUnit::Month:
+    month = v;
+    return true;
+  case IntervalUnit::Quarter:
+    if (v > ULONG_MAX / 3)
+    {
+      return false;
+    }
+    month = v * 3;
+    return true;
+  case IntervalUnit::Year:
+    year = v;
+    return true;
+  default:
+    assert(false);
+    return false;
+  }
+}
+
+bool
+DateTime::parse(LexString value)
+{
+  *this = DateTime();
+  const char* str = value.str;
+  const char* end = value.str + value.len;
+  while (str != end && is_space(*str))
+  {
+    str++;
+  }
+  const char* digits_end = str;
+  while (digits_end != end && is_digit(*digits_end))
+  {
+    digits_end++;
+  }
+  uint digits = (uint)(digits_end - str);
+  if ((digits == 6 || digits == 8 || digits == 12 || digits == 14) &&
+      (digits_end == end || *digits_end == '.' || is_space(*digits_end)))
+  {
+    // YYMMDD, YYYYMMDD, YYMMDDhhmmss or YYYYMMDDhhmmss
+    uint year_digits = (digits == 8 || digits == 14) ? 4 : 2;
+    read_number(str, end, year_digits, year);
+    if (year_digits == 2)
+    {
+      year = two_digit_year(year);
+    }
+    read_number(str, end, 2, month);
+    read_number(str, end, 2, day);
+    if (digits >= 12)
+    {
+      is_date = false;
+      read_number(str, end, 2, hour);
+      read_number(str, end, 2, minute);
+      read_number(str, end, 2, second);
+    }
+  }
+  else
+  {
+    // Date parts separated by any punctuation, e.g. 2024-05-07 or 24/5/7,
+    // optionally followed by a time separated by space or T.
+    uint year_digits = read_number(str, end, 4, year);
+    if (year_digits == 0)
+    {
+      return false;
+    }
+    if (year_digits <= 2)
+    {
+      year = two_digit_year(year);
+    }
+    uint* parts[] = {&month, &day, &hour, &minute, &second};
+    for (uint i = 0; i < 5; i++)
+    {
+      if (i == 2)
+      {
+        if (str == end || !(*str == 'T' || is_space(*str)))
+        {
+          break;
+        }
+        str++;
+        while (str != end && is_space(*str))
+        {
+          str++;
+        }
+        if (read_number(str, end, 2, hour) == 0)
+        {
+          break;
+        }
+        is_date = false;
+        continue;
+      }
+      if (str == end || !is_delimiter(*str))
+      {
+        if (i < 2)
+        {
+          return false;
+        }
+        break;
+      }
+      const char* part_start = str;
+      while (str != end && is_delimiter(*str))
+      {
+        str++;
+      }
+      if (read_number(str, end, 2, *parts[i]) == 0)
+      {
+        if (i < 2)
+        {
+          return false;
+        }
+        str = part_start;
+        break;
+      }
+    }
+  }
+  bool round_up = false;
+  if (!is_date && str != end && *str == '.' &&
+      str + 1 != end && is_digit(str[1]))
+  {
+    str++;
+    has_fraction = true;
+    for (uint scale = 100000; scale > 0 && str != end && is_digit(*str);
+         scale /= 10)
+    {
+      microsecond += (*str - '0') * scale;
+      str++;
+    }
+    round_up = str != end && '5' <= *str && *str <= '9';
+  }
+  // Like MySQL, ignore anything after a valid value.
+  if (month < 1 || month > 12 || day < 1 ||
+      day > last_day_of_month(year, month) ||
+      hour > 23 || minute > 59 || second > 59)
+  {
+    return false;
+  }
+  if (round_up)
+  {
+    Interval one_microsecond;
+    one_microsecond.microsecond = 1;
+    return add(IntervalUnit::Microsecond, one_microsecond, false);
+  }
+  return true;
+}
+
+bool
+DateTime::parse(long int number)
+{
+  *this = DateTime();
+  // MySQL's number_to_datetime
+  if (number < 101)
+  {
+    return false;
+  }
+  if (number <= 691231)
+  {
+    number = (number + 20000000) * 1000000;
+  }
+  else if (number < 700101)
+  {
+    return false;
+  }
+  else if (number <= 991231)
+  {
+    number = (number + 19000000) * 1000000;
+  }
+  else if (number < 10000101)
+  {
+    return false;
+  }
+  else if (number <= 99991231)
+  {
+    number = number * 1000000;
+  }
+  else if (number < 101000000)
+  {
+    return false;
+  }
+  else
+  {
+    is_date = false;
+    if (number <= 691231235959)
+    {
+      number = number + 20000000000000;
+    }
+    else if (number < 700101000000)
+    {
+      return false;
+    }
+    else if (number <= 991231235959)
+    {
+      number = number + 19000000000000;
+    }
+    else if (number > 99991231235959)
+    {
+      return false;
+    }
+  }
+  long int date_part = number / 1000000;
+  long int time_part = number % 1000000;
+  year = (uint)(date_part / 10000);
+  month = (uint)(date_part / 100 % 100);
+  day = (uint)(date_part % 100);
+  hour = (uint)(time_part / 10000);
+  minute = (uint)(time_part / 100 % 100);
+  second = (uint)(time_part % 100);
+  return 1 <= month && month <= 12 && 1 <= day &&
+    day <= last_day_of_month(year, month) &&
+    hour <= 23 && minute <= 59 && second <= 59;
+}
+
+bool
+DateTime::add(IntervalUnit unit, const Interval& interval, bool subtract)
+{
+  // MySQL's date_add_interval
+  long int sign = interval.negative != subtract ? -1 : 1;
+  switch (unit)
+  {
+  case IntervalUnit::Day:
+  case IntervalUnit::Week:
+    {
+      if (interval.day > (unsigned long int)MAX_DAY_NUMBER)
+      {
+        return false;
+      }
+      long int daynr = day_number(year, month, day) + sign * (long int)interval.day;
+      if (daynr < 0 || daynr > MAX_DAY_NUMBER)
+      {
+        return false;
+      }
+      date_from_day_number(daynr, year, month, day);
+      break;
+    }
+  case IntervalUnit::Year:
+    {
+      if (interval.year > 10000)
+      {
+        return false;
+      }
+      long int new_year = year + sign * (long int)interval.year;
+      if (new_year < 0 || new_year >= 10000)
+      {
+        return false;
+      }
+      year = (uint)new_year;
+      if (month == 2 && day == 29 && days_in_year(year) != 366)
+      {
+        day = 28;
+      }
+      break;
+    }
+  case IntervalUnit::Month:
+  case IntervalUnit::Quarter:
+  case IntervalUnit::YearMonth:
+    {
+      if (interval.month >= UINT_MAX / 2 || interval.year > 10000)
+      {
+        return false;
+      }
+      long int period = year * 12L + sign * (long int)interval.year * 12 +
+        month - 1 + sign * (long int)interval.month;
+      if (period < 0 || period >= 120000)
+      {
+        return false;
+      }
+      year = (uint)(period / 12);
+      month = (uint)(period % 12) + 1;
+      if (day > last_day_of_month(year, month))
+      {
+        day = last_day_of_month(year, month);
+      }
+      break;
+    }
+  default:
+    {
+      if (interval.day > (unsigned long int)MAX_DAY_NUMBER ||
+          interval.hour > (unsigned long int)MAX_DAY_NUMBER * 24 ||
+          interval.minute > (unsigned long int)MAX_DAY_NUMBER * 24 * 60 ||
+          interval.second > (unsigned long int)MAX_DAY_NUMBER * SECONDS_PER_DAY ||
+          interval.microsecond >
+            (unsigned long int)MAX_DAY_NUMBER * SECONDS_PER_DAY * 1000000)
+      {
+        return false;
+      }
+      long int microseconds = microsecond + sign * (long int)interval.microsecond;
+      long int sec = (day - 1) * SECONDS_PER_DAY + hour * 3600L + minute * 60L +
+        second +
+        sign * (long int)(interval.day * SECONDS_PER_DAY + interval.hour * 3600 +
+                          interval.minute * 60 + interval.second) +
+        microseconds / 1000000;
+      microseconds %= 1000000;
+      if (microseconds < 0)
+      {
+        microseconds += 1000000;
+        sec--;
+      }
+      long int days = sec / SECONDS_PER_DAY;
+      sec -= days * SECONDS_PER_DAY;
+      if (sec < 0)
+      {
+        days--;
+        sec += SECONDS_PER_DAY;
+      }
+      microsecond = (uint)microseconds;
+      second = (uint)(sec % 60);
+      minute = (uint)(sec / 60 % 60);
+      hour = (uint)(sec / 3600);
+      long int daynr = day_number(year, month, 1) + days;
+      if (daynr < 0 || daynr > MAX_DAY_NUMBER)
+      {
+        return false;
+      }
+      date_from_day_number(daynr, year, month, day);
+      is_date = false;
+    }
+  }
+  if (interval.has_fraction)
+  {
+    has_fraction = true;
+  }
+  // MySQL gives 0000-00-00 for the first year. Treat it as out of range.
+  return month != 0;
+}
+
+long int
+DateTime::extract(IntervalUnit unit) const
+{
+  switch (unit)
+  {
+  case IntervalUnit::Microsecond:
+    return microsecond;
+  case IntervalUnit::Second:
+    return second;
+  case IntervalUnit::Minute:
+    return minute;
+  case IntervalUnit::Hour:
+    return hour;
+  case IntervalUnit::Day:
+    return day;
+  case IntervalUnit::Week:
+    return week_mode_0(year, month, day);
+  case IntervalUnit::Month:
+    return month;
+  case IntervalUnit::Quarter:
+    return (month + 2) / 3;
+  case IntervalUnit::Year:
+    return year;
+  case IntervalUnit::SecondMicrosecond:
+    return second * 1000000L + microsecond;
+  case IntervalUnit::MinuteMicrosecond:
+    return (minute * 100L + second) * 1000000 + microsecond;
+  case IntervalUnit::MinuteSecond:
+    return minute * 100L + second;
+  case IntervalUnit::HourMicrosecond:
+    return (hour * 10000L + minute * 100 + second) * 1000000 + microsecond;
+  case IntervalUnit::HourSecond:
+    return hour * 10000L + minute * 100 + second;
+  case IntervalUnit::HourMinute:
+    return hour * 100L + minute;
+  case IntervalUnit::DayMicrosecond:
+    return (day * 1000000L + hour * 10000 + minute * 100 + second) * 1000000 +
+      microsecond;
+  case IntervalUnit::DaySecond:
+    return day * 1000000L + hour * 10000 + minute * 100 + second;
+  case IntervalUnit::DayMinute:
+    return day * 10000L + hour * 100 + minute;
+  case IntervalUnit::DayHour:
+    return day * 100L + hour;
+  case IntervalUnit::YearMonth:
+    return year * 100L + month;
+  }
+  assert(false);
+  return 0;
+}
+
+int64_t
+DateTime::packed() const
+{
+  int64_t ymd = ((int64_t(year) * 13 + month) << 5) | day;
+  int64_t hms = (hour << 12) | (minute << 6) | second;
+  return (((ymd << 17) | hms) << 24) + microsecond;
+}
+
+DateTime
+DateTime::unpack(int64_t packed, bool is_date, bool has_fraction)
+{
+  DateTime ret;
+  ret.microsecond = (uint)(packed & 0xffffff);
+  int64_t ymdhms = packed >> 24;
+  int64_t ymd = ymdhms >> 17;
+  int64_t hms = ymdhms & 0x1ffff;
+  ret.day = (uint)(ymd & 0x1f);
+  ret.month = (uint)((ymd >> 5) % 13);
+  ret.year = (uint)((ymd >> 5) / 13);
+  ret.second = (uint)(hms & 0x3f);
+  ret.minute = (uint)((hms >> 6) & 0x3f);
+  ret.hour = (uint)(hms >> 12);
+  ret.is_date = is_date;
+  ret.has_fraction = has_fraction;
+  return ret;
+}
+
+uint
+DateTime::format(char* buf) const
+{
+  char tmp[MAX_FORMATTED_LENGTH + 1];
+  int len;
+  if (is_date)
+  {
+    len = snprintf(tmp, sizeof(tmp), "%04u-%02u-%02u", year, month, day);
+  }
+  else if (!has_fraction)
+  {
+    len = snprintf(tmp, sizeof(tmp), "%04u-%02u-%02u %02u:%02u:%02u",
+                   year, month, day, hour, minute, second);
+  }
+  else
+  {
+    len = snprintf(tmp, sizeof(tmp), "%04u-%02u-%02u %02u:%02u:%02u.%06u",
+                   year, month, day, hour, minute, second, microsecond);
+  }
+  assert(0 < len && len <= (int)MAX_FORMATTED_LENGTH);
+  memcpy(buf, tmp, len);
+  return (uint)len;
+}
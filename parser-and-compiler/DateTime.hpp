@@ -0,0 +1,128 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#ifndef DateTime_hpp_included
+#define DateTime_hpp_included 1
+
+#include <cstdint>
+#include "LexString.hpp"
+
+/*
+ * MySQL-compatible date arithmetic, used to fold DATE_ADD, DATE_SUB and EXTRACT
+ * with constant arguments at prepare time. The algorithms follow those in
+ * MySQL's sql-common/my_time.cc and sql/item_timefunc.cc closely, so that the
+ * folded values agree with MySQL also for corner cases such as adding a month
+ * to January 31 or a year to February 29. Where MySQL would return NULL, e.g.
+ * for an invalid date or a result outside 0000-01-01 .. 9999-12-31, the
+ * functions below return false.
+ *
+ * TIME values are not supported.
+ */
+
+enum class IntervalUnit : uint8_t
+{
+  Microsecond,
+  Second,
+  Minute,
+  Hour,
+  Day,
+  Week,
+  Month,
+  Quarter,
+  Year,
+  SecondMicrosecond,
+  MinuteMicrosecond,
+  MinuteSecond,
+  HourMicrosecond,
+  HourSecond,
+  HourMinute,
+  DayMicrosecond,
+  DaySecond,
+  DayMinute,
+  DayHour,
+  YearMonth,
+};
+
+struct Interval
+{
+  bool negative = false;
+  bool has_fraction = false; // The unit or value has microsecond precision
+  unsigned long int year = 0;
+  unsigned long int month = 0;
+  unsigned long int day = 0;
+  unsigned long int hour = 0;
+  unsigned long int minute = 0;
+  unsigned long int second = 0;
+  unsigned long int microsecond = 0;
+  /*
+   * Set from the argument of INTERVAL. Compound units such as DAY_SECOND take a
+   * string like '1 10:30:00' where any non-digits separate the parts and
+   * leading parts may be left out.
+   */
+  bool parse(IntervalUnit unit, LexString value);
+  bool parse(IntervalUnit unit, long int value);
+};
+
+struct DateTime
+{
+  uint year = 0;
+  uint month = 0;
+  uint day = 0;
+  uint hour = 0;
+  uint minute = 0;
+  uint second = 0;
+  uint microsecond = 0;
+  bool is_date = true; // DATE rather than DATETIME
+  bool has_fraction = false; // Print with six decimals
+  /*
+   * Parse a date or datetime in one of the formats MySQL accepts as a string,
+   * e.g. '2024-05-07', '2024-05-07 12:30:00.25', '24/5/7' or '20240507123000'.
+   */
+  bool parse(LexString str);
+  // Parse a date or datetime as a number, e.g. 20240507 or 20240507123000.
+  bool parse(long int number);
+  // DATE_ADD, or DATE_SUB if subtract is true.
+  bool add(IntervalUnit unit, const Interval& interval, bool subtract);
+  long int extract(IntervalUnit unit) const;
+  /*
+   * Order-preserving 64-bit encoding, the same as MySQL's in-memory packed
+   * DATETIME format:
+   *
+   *   ((((year * 13 + month) << 5 | day) << 17 |
+   *     hour << 12 | minute << 6 | second) << 24) + microsecond
+   *
+   * A DATE is encoded as a DATETIME at midnight, so packed values of both types
+   * compare as their values do.
+   */
+  int64_t packed() const;
+  static DateTime unpack(int64_t packed, bool is_date, bool has_fraction);
+  /*
+   * Write as 'YYYY-MM-DD', 'YYYY-MM-DD hh:mm:ss' or
+   * 'YYYY-MM-DD hh:mm:ss.ffffff' without NUL termination and return the length.
+   */
+  static const uint MAX_FORMATTED_LENGTH = 26;
+  uint format(char* buf) const;
+};
+
+#endif
@@ -0,0 +1,162 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include <stdio.h>
+#include <assert.h>
+#include <cstring>
+#include <string>
+#include "DateTime.hpp"
+
+static LexString
+ls(const char* str)
+{
+  return LexString{str, strlen(str)};
+}
+
+static std::string
+format(const DateTime& dt)
+{
+  char buf[DateTime::MAX_FORMATTED_LENGTH];
+  return std::string(buf, dt.format(buf));
+}
+
+/*
+ * Return DATE_ADD(date, INTERVAL value unit), or DATE_SUB if subtract is true,
+ * as MySQL would print it, or "NULL".
+ */
+static std::string
+date_add(const char* date, const char* value, IntervalUnit unit,
+         bool subtract = false)
+{
+  DateTime dt;
+  Interval interval;
+  if (!dt.parse(ls(date)) ||
+      !interval.parse(unit, ls(value)) ||
+      !dt.add(unit, interval, subtract))
+  {
+    return "NULL";
+  }
+  return format(dt);
+}
+
+static long int
+extract(IntervalUnit unit, const char* date)
+{
+  DateTime dt;
+  bool ok = dt.parse(ls(date));
+  assert(ok);
+  return dt.extract(unit);
+}
+
+int
+main(int argc, char** argv)
+{
+  // Parsing
+  DateTime dt;
+  assert(dt.parse(ls("2024-05-07")) && format(dt) == "2024-05-07");
+  assert(dt.is_date);
+  assert(dt.parse(ls(" 2024-5-7 12:30:05 ")) &&
+         format(dt) == "2024-05-07 12:30:05");
+  assert(!dt.is_date);
+  assert(dt.parse(ls("2024/05/07T12.30.05.25")) &&
+         format(dt) == "2024-05-07 12:30:05.250000");
+  assert(dt.parse(ls("24-05-07")) && format(dt) == "2024-05-07");
+  assert(dt.parse(ls("99-05-07")) && format(dt) == "1999-05-07");
+  assert(dt.parse(ls("20240507")) && format(dt) == "2024-05-07");
+  assert(dt.parse(ls("20240507123005")) && format(dt) == "2024-05-07 12:30:05");
+  assert(dt.parse(ls("2024-05-07 23:59:59.9999995")) &&
+         format(dt) == "2024-05-08 00:00:00.000000");
+  assert(!dt.parse(ls("2024-02-30")));
+  assert(!dt.parse(ls("2024-13-01")));
+  assert(!dt.parse(ls("0000-00-00")));
+  assert(!dt.parse(ls("2024-05-07 24:00:00")));
+  assert(!dt.parse(ls("May 7, 2024")));
+  assert(dt.parse(20240507) && format(dt) == "2024-05-07");
+  assert(dt.parse(240507) && format(dt) == "2024-05-07");
+  assert(dt.parse(20240507123005) && format(dt) == "2024-05-07 12:30:05");
+  assert(!dt.parse(20241301));
+
+  // DATE_ADD and DATE_SUB, compared with MySQL 8.0
+  assert(date_add("1998-12-01", "90", IntervalUnit::Day, true) == "1998-09-02");
+  assert(date_add("2024-05-06", "23", IntervalUnit::Microsecond) ==
+         "2024-05-06 00:00:00.000023");
+  assert(date_add("2024-01-31", "1", IntervalUnit::Month) == "2024-02-29");
+  assert(date_add("2023-01-31", "1", IntervalUnit::Month) == "2023-02-28");
+  assert(date_add("2024-02-29", "1", IntervalUnit::Year) == "2025-02-28");
+  assert(date_add("2024-05-06", "1", IntervalUnit::Quarter) == "2024-08-06");
+  assert(date_add("2024-05-06", "-2", IntervalUnit::Week) == "2024-04-22");
+  assert(date_add("2024-05-06", "1-11", IntervalUnit::YearMonth) ==
+         "2026-04-06");
+  assert(date_add("2024-12-31 23:59:59", "1:1", IntervalUnit::MinuteSecond) ==
+         "2025-01-01 00:01:00");
+  assert(date_add("2024-01-01 00:00:00", "-1 10", IntervalUnit::DayHour) ==
+         "2023-12-30 14:00:00");
+  assert(date_add("2025-01-01", "1 1:1:1", IntervalUnit::DaySecond, true) ==
+         "2024-12-30 22:58:59");
+  // Leading parts may be left out.
+  assert(date_add("2024-05-06", "1:30", IntervalUnit::DayMinute) ==
+         "2024-05-06 01:30:00");
+  // Microseconds are given as decimals in compound units.
+  assert(date_add("2024-05-06", "1.5", IntervalUnit::SecondMicrosecond) ==
+         "2024-05-06 00:00:01.500000");
+  assert(date_add("2024-05-06", "1.5", IntervalUnit::Second) ==
+         "2024-05-06 00:00:01.500000");
+  assert(date_add("2024-05-06", "86400", IntervalUnit::Second) ==
+         "2024-05-07 00:00:00");
+  assert(date_add("9999-12-31", "1", IntervalUnit::Day) == "NULL");
+  assert(date_add("0001-01-01", "2", IntervalUnit::Year, true) == "NULL");
+  assert(date_add("2024-02-30", "1", IntervalUnit::Day) == "NULL");
+  assert(date_add("2024-05-06", "1 2 3", IntervalUnit::DayHour) == "NULL");
+  Interval interval;
+  assert(interval.parse(IntervalUnit::Hour, -25L));
+  assert(interval.negative && interval.hour == 25);
+  assert(interval.parse(IntervalUnit::MinuteMicrosecond, 5L));
+  assert(interval.microsecond == 500000);
+
+  // EXTRACT, compared with MySQL 8.0
+  assert(extract(IntervalUnit::Year, "2024-05-06") == 2024);
+  assert(extract(IntervalUnit::Quarter, "2024-05-06") == 2);
+  assert(extract(IntervalUnit::Week, "2024-05-06") == 18);
+  assert(extract(IntervalUnit::Week, "2024-01-06") == 0);
+  assert(extract(IntervalUnit::Week, "2023-01-01") == 1);
+  assert(extract(IntervalUnit::YearMonth, "2024-05-06") == 202405);
+  assert(extract(IntervalUnit::Hour, "2024-05-06") == 0);
+  assert(extract(IntervalUnit::DayMinute, "2019-07-02 01:02:03") == 20102);
+  assert(extract(IntervalUnit::HourMicrosecond, "2024-05-06 10:30:05.25") ==
+         103005250000);
+
+  // Packed values compare as the values they represent.
+  DateTime a, b, c;
+  assert(a.parse(ls("2024-05-06")));
+  assert(b.parse(ls("2024-05-06 00:00:00.000001")));
+  assert(c.parse(ls("2024-05-07")));
+  assert(a.packed() < b.packed() && b.packed() < c.packed());
+  assert(b.parse(ls("2024-05-06 23:59:59.999999")));
+  assert(b.packed() < c.packed());
+  DateTime unpacked = DateTime::unpack(b.packed(), false, true);
+  assert(format(unpacked) == "2024-05-06 23:59:59.999999");
+
+  printf("OK\n");
+  return 0;
+}
@@ -31,7 +31,7 @@
  * constructible/destructible, only arena allocation and no shrinking.
  *
  * The implementation holds an array of pointers to pages, each page holding
- * (1 << BITS) items. This allows for constant-time lookups using two pointer
+ * (1 << bits) items. This allows for constant-time lookups using two pointer
  * dereferences. As the array expands, the array of pointers is reallocated as
  * necessary, doubling its capacity each time. This allows amortized constant-
  * time push and a memory overhead of roughly 1 byte per item. The items
@@ -43,25 +43,42 @@ class DynamicArray
 {
 private:
   /*
-   * todo: These two parameters could be dynamic. With some statistics, we
-   * should be able to tune these as a function of SQL statement length, which
-   * we'll know before we create any DynamicArray. Especially the BITS parameter
-   * has a significant impact on memory use.
+   * The page size has a significant impact on memory use, so it is chosen per
+   * array from a hint about the number of items, typically derived from the
+   * SQL statement length. Without a hint, pages hold (1 << DEFAULT_BITS)
+   * items.
    */
   static const uint INITIAL_PAGES_CAPACITY = 8;
-  static const uint BITS = 5;
-  static const uint ITEMS_PER_PAGE = (1 << BITS);
-  static const uint IDX_MASK = (1<<BITS)-1;
+  static const uint DEFAULT_BITS = 5;
+  static const uint MIN_BITS = 2;
+  static const uint MAX_BITS = 10;
   T** pages;
   uint item_count;
   uint pages_capacity;
   ArenaAllocator* allocator;
+  uint bits;
+  uint idx_mask;
+  static uint bits_for(uint expected_items)
+  {
+    if (expected_items == 0)
+    {
+      return DEFAULT_BITS;
+    }
+    uint ret = MIN_BITS;
+    while (ret < MAX_BITS && (1U << ret) < expected_items)
+    {
+      ret++;
+    }
+    return ret;
+  }
 public:
-  DynamicArray(ArenaAllocator* alloc) :
+  DynamicArray(ArenaAllocator* alloc, uint expected_items = 0) :
+    pages(NULL),
     item_count(0),
     pages_capacity(0),
     allocator(alloc),
-    pages(NULL)
+    bits(bits_for(expected_items)),
+    idx_mask((1U << bits) - 1)
   {}
   ~DynamicArray()
   {
@@ -77,8 +94,8 @@ public:
       // overflow_error inherits from runtime_error.
       throw std::overflow_error("DynamicArray::push: item count overflow");
     }
-    uint page = (item_count >> BITS);
-    uint idx = item_count & IDX_MASK;
+    uint page = (item_count >> bits);
+    uint idx = item_count & idx_mask;
     if (idx == 0)
     {
       if (page >= pages_capacity)
@@ -96,7 +113,7 @@ public:
         pages_capacity = newCapacity;
       }
       pages[page] =
-        static_cast<T*>(allocator->alloc(ITEMS_PER_PAGE * sizeof(T)));
+        static_cast<T*>(allocator->alloc((1U << bits) * sizeof(T)));
     }
     pages[page][idx] = item;
     item_count++;
@@ -107,12 +124,12 @@ public:
   T& operator[](uint index)
   {
     assert(0 <= index && index < item_count);
-    return pages[index >> BITS][index & IDX_MASK];
+    return pages[index >> bits][index & idx_mask];
   }
   const T& operator[](uint index) const
   {
     assert(0 <= index && index < item_count);
-    return pages[index >> BITS][index & IDX_MASK];
+    return pages[index >> bits][index & idx_mask];
   }
   /*
    * Return the number of items in the array.
@@ -127,25 +144,35 @@ public:
    */
   bool has_item(T* item)
   {
-    uint lastPage = (item_count-1) >> BITS;
+    uint lastPage = (item_count-1) >> bits;
     for (uint page = 0; page <= lastPage; page++)
     {
-      if (pages[page] <= item && item < pages[page] + ITEMS_PER_PAGE)
+      if (pages[page] <= item && item < pages[page] + (1U << bits))
       {
         uint idx = item - pages[page];
         T* wouldBe = &pages[page][idx];
-        return ((page << BITS) | idx) < item_count && wouldBe == item;
+        return ((page << bits) | idx) < item_count && wouldBe == item;
       }
     }
     return false;
   }
+  /*
+   * Given a pointer to an item and the index it claims to have, determine
+   * whether it points to that item in this array. This executes in constant
+   * time.
+   */
+  bool has_item(const T* item, uint index) const
+  {
+    return index < item_count &&
+      &pages[index >> bits][index & idx_mask] == item;
+  }
   /*
    * Convenience function to return the last item in the array.
    */
   T& last_item()
   {
     uint index = item_count-1;
-    return pages[index >> BITS][index & IDX_MASK];
+    return pages[index >> bits][index & idx_mask];
   }
   /*
    * Truncate the array. No data or metadata will be overwritten at subsequent
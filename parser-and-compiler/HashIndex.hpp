@@ -0,0 +1,151 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#ifndef HashIndex_hpp_included
+#define HashIndex_hpp_included 1
+
+#include <cstdint>
+#include <cstring>
+#include "ArenaAllocator.hpp"
+
+/*
+ * An open-addressing hash index over items stored elsewhere, typically in a
+ * DynamicArray. It maps a hash value to item indexes, and the caller decides
+ * which candidate, if any, is a match by comparing the items themselves. This
+ * makes it possible to deduplicate items in amortized constant time without
+ * storing keys twice.
+ *
+ * Like DynamicArray, it only supports arena allocation and no removal. When
+ * the load factor would exceed 1/2, the slot array is reallocated with double
+ * capacity, abandoning the old one to the arena.
+ */
+
+class HashIndex
+{
+private:
+  static const uint INITIAL_CAPACITY = 16;
+  struct Slot
+  {
+    uint32_t hash;
+    uint32_t index_plus_one; // 0 means empty
+  };
+  Slot* m_slots;
+  uint m_capacity;
+  uint m_count;
+  ArenaAllocator* m_allocator;
+  void grow()
+  {
+    uint new_capacity = m_capacity == 0 ? INITIAL_CAPACITY : m_capacity * 2;
+    if (new_capacity <= m_capacity)
+    {
+      throw std::overflow_error("HashIndex::grow: capacity overflow");
+    }
+    Slot* new_slots =
+      static_cast<Slot*>(m_allocator->alloc(new_capacity * sizeof(Slot)));
+    memset(new_slots, 0, new_capacity * sizeof(Slot));
+    uint mask = new_capacity - 1;
+    for (uint i = 0; i < m_capacity; i++)
+    {
+      if (m_slots[i].index_plus_one == 0)
+      {
+        continue;
+      }
+      uint pos = m_slots[i].hash & mask;
+      while (new_slots[pos].index_plus_one != 0)
+      {
+        pos = (pos + 1) & mask;
+      }
+      new_slots[pos] = m_slots[i];
+    }
+    m_slots = new_slots;
+    m_capacity = new_capacity;
+  }
+public:
+  HashIndex(ArenaAllocator* alloc) :
+    m_slots(NULL),
+    m_capacity(0),
+    m_count(0),
+    m_allocator(alloc)
+  {}
+  /*
+   * Return the index of an item with the given hash for which is_match(index)
+   * returns true, or -1 if there is none.
+   */
+  template<typename IsMatch>
+  int find(uint32_t hash, IsMatch is_match) const
+  {
+    if (m_count == 0)
+    {
+      return -1;
+    }
+    uint mask = m_capacity - 1;
+    for (uint pos = hash & mask;
+         m_slots[pos].index_plus_one != 0;
+         pos = (pos + 1) & mask)
+    {
+      if (m_slots[pos].hash == hash &&
+          is_match(m_slots[pos].index_plus_one - 1))
+      {
+        return m_slots[pos].index_plus_one - 1;
+      }
+    }
+    return -1;
+  }
+  /*
+   * Add an item index under the given hash. The caller must make sure that no
+   * equal item is present already, since find() could return either.
+   */
+  void insert(uint32_t hash, uint index)
+  {
+    if (2 * (m_count + 1) > m_capacity)
+    {
+      grow();
+    }
+    uint mask = m_capacity - 1;
+    uint pos = hash & mask;
+    while (m_slots[pos].index_plus_one != 0)
+    {
+      pos = (pos + 1) & mask;
+    }
+    m_slots[pos].hash = hash;
+    m_slots[pos].index_plus_one = index + 1;
+    m_count++;
+  }
+  /*
+   * Mix a value into a hash. This is the 64-bit finalizer from MurmurHash3,
+   * applied to the combination.
+   */
+  static uint32_t combine(uint32_t hash, uint64_t value)
+  {
+    uint64_t h = (uint64_t(hash) << 32 | hash) ^ value;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return uint32_t(h);
+  }
+};
+
+#endif
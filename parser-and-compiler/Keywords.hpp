@@ -846,4 +846,48 @@ static const char* keywords_defined_in_mysql[] = {
 static const int number_of_keywords_defined_in_mysql =
   sizeof(keywords_defined_in_mysql) / sizeof(keywords_defined_in_mysql[0]);
 
+/*
+ * Both keyword lists are also available through a perfect hash table,
+ * generated at build time by KeywordsHashGenerator into Keywords.hash.hpp. An
+ * upper-case word is classified by computing keyword_hash over it, looking up
+ * the displacement for its bucket and comparing with the single table entry
+ * at keyword_hash_slot. Entries for keywords defined in MySQL but not
+ * implemented in RonDB REST SQL have the value keyword_unimplemented.
+ */
+#include <cstdint>
+
+struct keyword_hash_entry
+{
+  const char* text; // NULL for an empty slot
+  int value;
+};
+
+static const int keyword_unimplemented = -1;
+static const uint32_t keyword_hash_buckets = 256;
+static const uint32_t keyword_hash_slots = 1024;
+static const uint64_t keyword_hash_init = 0xcbf29ce484222325ULL;
+
+// FNV-1a, one byte at a time so that it can be fused with upper-casing.
+static inline uint64_t
+keyword_hash_step(uint64_t hash, char c)
+{
+  return (hash ^ uint8_t(c)) * 0x100000001b3ULL;
+}
+
+static inline uint32_t
+keyword_hash_bucket(uint64_t hash)
+{
+  return uint32_t(hash ^ (hash >> 32)) & (keyword_hash_buckets - 1);
+}
+
+static inline uint32_t
+keyword_hash_slot(uint64_t hash, uint32_t displacement)
+{
+  uint64_t h = hash ^ (displacement * 0x9e3779b97f4a7c15ULL);
+  h ^= h >> 31;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 29;
+  return uint32_t(h) & (keyword_hash_slots - 1);
+}
+
 #endif
@@ -0,0 +1,171 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*
+ * Generate Keywords.hash.hpp, a perfect hash table over both keyword lists in
+ * Keywords.hpp, using the hash-and-displace method: Words are first hashed
+ * into buckets. Then, starting with the largest bucket, we search for a
+ * displacement that maps all words in the bucket to free slots.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "Keywords.hpp"
+
+struct Word
+{
+  std::string text;
+  bool implemented;
+  uint64_t hash;
+};
+
+int
+main(int argc, char** argv)
+{
+  std::vector<Word> words;
+  for (int i=0; i < number_of_keywords_implemented_in_rest_sql; i++)
+  {
+    words.push_back({keywords_implemented_in_rest_sql[i].text, true, 0});
+  }
+  for (int i=0; i < number_of_keywords_defined_in_mysql; i++)
+  {
+    const char* text = keywords_defined_in_mysql[i];
+    bool found = false;
+    for (int j=0; j < number_of_keywords_implemented_in_rest_sql; j++)
+    {
+      found = found || strcmp(text, keywords_implemented_in_rest_sql[j].text) == 0;
+    }
+    if (!found)
+    {
+      words.push_back({text, false, 0});
+    }
+  }
+  if (words.size() > keyword_hash_slots * 9 / 10)
+  {
+    fprintf(stderr, "Too many keywords for keyword_hash_slots.\n");
+    return 1;
+  }
+  std::vector<std::vector<uint>> buckets(keyword_hash_buckets);
+  for (uint i = 0; i < words.size(); i++)
+  {
+    uint64_t hash = keyword_hash_init;
+    for (char c : words[i].text)
+    {
+      hash = keyword_hash_step(hash, c);
+    }
+    words[i].hash = hash;
+    buckets[keyword_hash_bucket(hash)].push_back(i);
+  }
+  std::vector<uint> order(keyword_hash_buckets);
+  for (uint b = 0; b < keyword_hash_buckets; b++)
+  {
+    order[b] = b;
+  }
+  std::stable_sort(order.begin(), order.end(), [&buckets](uint x, uint y)
+  {
+    return buckets[x].size() > buckets[y].size();
+  });
+  std::vector<int> slots(keyword_hash_slots, -1);
+  std::vector<uint32_t> displacements(keyword_hash_buckets, 0);
+  for (uint b : order)
+  {
+    std::vector<uint>& bucket = buckets[b];
+    if (bucket.empty())
+    {
+      break;
+    }
+    bool placed = false;
+    for (uint32_t d = 0; d < (1 << 24) && !placed; d++)
+    {
+      std::vector<uint32_t> taken;
+      placed = true;
+      for (uint w : bucket)
+      {
+        uint32_t slot = keyword_hash_slot(words[w].hash, d);
+        if (slots[slot] != -1 ||
+            std::find(taken.begin(), taken.end(), slot) != taken.end())
+        {
+          placed = false;
+          break;
+        }
+        taken.push_back(slot);
+      }
+      if (placed)
+      {
+        for (uint i = 0; i < bucket.size(); i++)
+        {
+          slots[taken[i]] = bucket[i];
+        }
+        displacements[b] = d;
+      }
+    }
+    if (!placed)
+    {
+      fprintf(stderr, "Failed to find a perfect hash for the keywords.\n");
+      return 1;
+    }
+  }
+  printf("// Generated by KeywordsHashGenerator. Do not edit.\n"
+         "\n"
+         "#ifndef keywords_hash_hpp\n"
+         "#define keywords_hash_hpp 1\n"
+         "\n"
+         "#include \"Keywords.hpp\"\n"
+         "\n"
+         "static const uint32_t keyword_hash_displacements[] =\n"
+         "{\n");
+  for (uint b = 0; b < keyword_hash_buckets; b++)
+  {
+    printf("  %u,\n", displacements[b]);
+  }
+  printf("};\n"
+         "\n"
+         "static const struct keyword_hash_entry keyword_hash_table[] =\n"
+         "{\n");
+  for (uint s = 0; s < keyword_hash_slots; s++)
+  {
+    if (slots[s] == -1)
+    {
+      printf("  { NULL, 0 },\n");
+    }
+    else if (words[slots[s]].implemented)
+    {
+      printf("  { \"%s\", T_%s },\n",
+             words[slots[s]].text.c_str(),
+             words[slots[s]].text.c_str());
+    }
+    else
+    {
+      printf("  { \"%s\", keyword_unimplemented },\n",
+             words[slots[s]].text.c_str());
+    }
+  }
+  printf("};\n"
+         "\n"
+         "#endif\n");
+  return 0;
+}
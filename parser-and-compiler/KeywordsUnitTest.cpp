@@ -1,4 +1,25 @@
 #include "Keywords.hpp"
+#include "Keywords.hash.hpp"
+
+// Same lookup as in RestSQLLexer.l
+static const struct keyword_hash_entry*
+lookup(const char* word)
+{
+  uint64_t hash = keyword_hash_init;
+  for (int i=0; word[i] != char(0); i++)
+  {
+    hash = keyword_hash_step(hash, word[i]);
+  }
+  uint32_t displacement =
+    keyword_hash_displacements[keyword_hash_bucket(hash)];
+  const struct keyword_hash_entry* entry =
+    &keyword_hash_table[keyword_hash_slot(hash, displacement)];
+  if (entry->text != NULL && strcmp(word, entry->text) == 0)
+  {
+    return entry;
+  }
+  return NULL;
+}
 
 int
 main(int argc, char** argv)
@@ -39,5 +60,41 @@ main(int argc, char** argv)
       assert(strcmp(prev_word, this_word) < 0);
     }
   }
+  // Test that the perfect hash table finds every keyword in both lists with
+  // the right value, and nothing else.
+  int entries = 0;
+  for (uint i=0; i < keyword_hash_slots; i++)
+  {
+    if (keyword_hash_table[i].text != NULL)
+    {
+      entries++;
+    }
+  }
+  int implemented_in_both_lists = 0;
+  for (int i=0; i < number_of_keywords_implemented_in_rest_sql; i++)
+  {
+    auto this_word = keywords_implemented_in_rest_sql[i];
+    const struct keyword_hash_entry* entry = lookup(this_word.text);
+    assert(entry != NULL);
+    assert(entry->value == this_word.value);
+  }
+  for (int i=0; i < number_of_keywords_defined_in_mysql; i++)
+  {
+    const char* this_word = keywords_defined_in_mysql[i];
+    const struct keyword_hash_entry* entry = lookup(this_word);
+    assert(entry != NULL);
+    if (entry->value != keyword_unimplemented)
+    {
+      implemented_in_both_lists++;
+    }
+  }
+  assert(entries == number_of_keywords_implemented_in_rest_sql +
+                    number_of_keywords_defined_in_mysql -
+                    implemented_in_both_lists);
+  assert(lookup("") == NULL);
+  assert(lookup("SELECTS") == NULL);
+  assert(lookup("SELEC") == NULL);
+  assert(lookup("COL1") == NULL);
+  assert(lookup("L_EXTENDEDPRICE") == NULL);
   printf("OK\n");
 }
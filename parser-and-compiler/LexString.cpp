@@ -56,6 +56,20 @@ LexString::operator== (const LexString& other) const
   return memcmp(str, other.str, len) == 0;
 }
 
+/*
+ * Hash consistent with operator==, i.e. byte by byte. This is 32-bit FNV-1a.
+ */
+uint32_t
+LexString::hash() const
+{
+  uint32_t h = 2166136261U;
+  for (size_t i = 0; i < len; i++)
+  {
+    h = (h ^ uint8_t(str[i])) * 16777619U;
+  }
+  return h;
+}
+
 /*
  * Return a concatenation of two LexStrings. The lifetime of the returned
  * LexString will end when the lifetime of either argument or the allocator
@@ -26,6 +26,7 @@
 #define LexString_hpp_included 1
 
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
 #include "ArenaAllocator.hpp"
@@ -41,7 +42,17 @@ public:
   ~LexString() = default;
   friend std::ostream& operator<< (std::ostream& out, const LexString& ls);
   bool operator== (const LexString& other) const;
+  uint32_t hash() const;
   LexString concat(const LexString other, ArenaAllocator* allocator);
 };
 
+// For using LexString as key in std::unordered_map
+struct LexStringHash
+{
+  size_t operator()(const LexString& ls) const
+  {
+    return ls.hash();
+  }
+};
+
 #endif
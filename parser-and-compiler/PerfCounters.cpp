@@ -0,0 +1,218 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+#include "PerfCounters.hpp"
+#include "../perf_events.h"
+
+#if defined(__linux__)
+static const struct
+{
+  uint32_t type;
+  uint64_t config;
+} events[] =
+{
+  PERF_EVENTS(PERF_EVENT_ATTR)
+};
+static_assert(sizeof(events) / sizeof(events[0]) == PerfCounters::EVENT_COUNT,
+              "PerfCounters::Event does not match PERF_EVENTS");
+#endif
+
+PerfCounters::Values&
+PerfCounters::Values::operator+= (const Values& other)
+{
+  for (uint i = 0; i < EVENT_COUNT; i++)
+  {
+    value[i] += other.value[i];
+  }
+  return *this;
+}
+
+PerfCounters::Values
+PerfCounters::Values::operator- (const Values& other) const
+{
+  Values ret;
+  for (uint i = 0; i < EVENT_COUNT; i++)
+  {
+    // Scaled values of multiplexed events may step back slightly.
+    ret.value[i] = value[i] >= other.value[i] ? value[i] - other.value[i] : 0;
+  }
+  return ret;
+}
+
+PerfCounters::Scope::Scope(const PerfCounters* counters, Values* total):
+  m_counters(total == NULL ? NULL : counters),
+  m_total(total)
+{
+  if (m_counters != NULL)
+  {
+    m_counters->read(&m_start);
+  }
+}
+
+PerfCounters::Scope::~Scope()
+{
+  if (m_counters != NULL)
+  {
+    Values end;
+    m_counters->read(&end);
+    *m_total += end - m_start;
+  }
+}
+
+PerfCounters::PerfCounters()
+{
+  for (uint i = 0; i < EVENT_COUNT; i++)
+  {
+    m_fds[i] = -1;
+  }
+}
+
+PerfCounters::~PerfCounters()
+{
+  for (uint i = 0; i < EVENT_COUNT; i++)
+  {
+    if (m_fds[i] >= 0)
+    {
+      close(m_fds[i]);
+    }
+  }
+}
+
+bool
+PerfCounters::open()
+{
+  bool opened = false;
+#if defined(__linux__)
+  for (uint i = 0; i < EVENT_COUNT; i++)
+  {
+    if (m_fds[i] >= 0)
+    {
+      opened = true;
+      continue;
+    }
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[i].type;
+    attr.config = events[i].config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // The calling thread on any CPU
+    m_fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    opened |= m_fds[i] >= 0;
+  }
+#endif
+  return opened;
+}
+
+void
+PerfCounters::read(Values* values) const
+{
+  for (uint i = 0; i < EVENT_COUNT; i++)
+  {
+    values->value[i] = 0;
+    if (m_fds[i] < 0)
+    {
+      continue;
+    }
+    uint64_t buf[3]; // Value, time enabled, time running
+    if (::read(m_fds[i], buf, sizeof(buf)) != sizeof(buf) || buf[2] == 0)
+    {
+      continue;
+    }
+    values->value[i] = buf[2] < buf[1]
+      ? (unsigned long int)((double)buf[0] * buf[1] / buf[2])
+      : buf[0];
+  }
+}
+
+const char*
+PerfCounters::event_name(Event event)
+{
+  static const char* names[] =
+  {
+    PERF_EVENTS(PERF_EVENT_NAME)
+  };
+  static_assert(sizeof(names) / sizeof(names[0]) == EVENT_COUNT,
+                "PerfCounters::Event does not match PERF_EVENTS");
+  return names[event];
+}
+
+static double
+ratio(unsigned long int a, unsigned long int b)
+{
+  return b ? (double)a / b : 0.0;
+}
+
+void
+PerfCounters::print(std::ostream& out,
+                    const Values& values,
+                    unsigned long int units,
+                    const char* unit_name) const
+{
+  bool any = false;
+  for (uint i = 0; i < EVENT_COUNT; i++)
+  {
+    Event event = (Event)i;
+    if (!available(event))
+    {
+      continue;
+    }
+    any = true;
+    char line[128];
+    unsigned long int v = values.value[i];
+    int len = snprintf(line, sizeof(line), "%-17s %14lu  %10.2f/%s",
+                       event_name(event), v, ratio(v, units), unit_name);
+    if (event == INSTRUCTIONS && available(CYCLES))
+    {
+      snprintf(line + len, sizeof(line) - len, "  %.2f IPC",
+               ratio(v, values.value[CYCLES]));
+    }
+    else if (event == BRANCH_MISSES && available(BRANCHES))
+    {
+      snprintf(line + len, sizeof(line) - len, "  %.2f%% of branches",
+               100 * ratio(v, values.value[BRANCHES]));
+    }
+    else if (event == CACHE_MISSES && available(CACHE_REFERENCES))
+    {
+      snprintf(line + len, sizeof(line) - len, "  %.2f%% of references",
+               100 * ratio(v, values.value[CACHE_REFERENCES]));
+    }
+    out << line << std::endl;
+  }
+  if (!any)
+  {
+    out << "No performance counters are available" << std::endl;
+  }
+}
@@ -0,0 +1,109 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+
+#ifndef PerfCounters_hpp_included
+#define PerfCounters_hpp_included 1
+
+#include <cstdint>
+#include <ostream>
+
+/*
+ * Counters of the calling thread in user space, opened with Linux
+ * perf_event_open. The counters run from open() on, and the cost of a piece of
+ * work is the difference between a read() before and one after it, see Scope.
+ *
+ * Events that the CPU or the kernel doesn't provide, e.g. hardware events in
+ * most virtual machines, are not available and read as 0. When the kernel
+ * multiplexes more events than the CPU has counters, the values are scaled by
+ * the fraction of time each event was counted.
+ */
+class PerfCounters
+{
+public:
+  /*
+   * In the order of PERF_EVENTS in ../perf_events.h, the event list shared
+   * with the aggregation interpreter.
+   */
+  enum Event
+  {
+    TASK_CLOCK, // Nanoseconds on the CPU
+    PAGE_FAULTS,
+    CYCLES,
+    INSTRUCTIONS,
+    BRANCHES,
+    BRANCH_MISSES,
+    CACHE_REFERENCES, // Last level cache
+    CACHE_MISSES,
+    L1D_READ_MISSES,
+    EVENT_COUNT,
+  };
+  struct Values
+  {
+    unsigned long int value[EVENT_COUNT] = {};
+    Values& operator+= (const Values& other);
+    Values operator- (const Values& other) const;
+  };
+  /*
+   * Add the events counted during the lifetime of the scope to *total. Does
+   * nothing if counters or total is NULL, so that code can be instrumented
+   * unconditionally.
+   */
+  class Scope
+  {
+  private:
+    const PerfCounters* m_counters;
+    Values* m_total;
+    Values m_start;
+  public:
+    Scope(const PerfCounters* counters, Values* total);
+    ~Scope();
+  };
+private:
+  int m_fds[EVENT_COUNT];
+public:
+  PerfCounters();
+  ~PerfCounters();
+  /*
+   * Open the counters. Return false if none of the events is available, e.g.
+   * because of /proc/sys/kernel/perf_event_paranoid.
+   */
+  bool open();
+  bool available(Event event) const
+  {
+    return m_fds[event] >= 0;
+  }
+  void read(Values* values) const;
+  static const char* event_name(Event event);
+  /*
+   * Print the available events, per unit of work, e.g. per statement, and as
+   * rates such as instructions per cycle and miss ratios.
+   */
+  void print(std::ostream& out,
+             const Values& values,
+             unsigned long int units,
+             const char* unit_name) const;
+};
+
+#endif
@@ -0,0 +1,113 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+
+#include <assert.h>
+#include <iostream>
+#include "PerfCounters.hpp"
+
+static unsigned long int
+busy_work(unsigned long int n)
+{
+  volatile unsigned long int sum = 0;
+  for (unsigned long int i = 0; i < n; i++)
+  {
+    sum += i * i;
+  }
+  return sum;
+}
+
+int
+main(int argc, char** argv)
+{
+  // Arithmetic on values
+  PerfCounters::Values a, b;
+  a.value[PerfCounters::INSTRUCTIONS] = 10;
+  b.value[PerfCounters::INSTRUCTIONS] = 3;
+  b.value[PerfCounters::CYCLES] = 5;
+  PerfCounters::Values d = a - b;
+  assert(d.value[PerfCounters::INSTRUCTIONS] == 7);
+  assert(d.value[PerfCounters::CYCLES] == 0);
+  d += b;
+  assert(d.value[PerfCounters::INSTRUCTIONS] == 10);
+  assert(d.value[PerfCounters::CYCLES] == 5);
+
+  // A scope without counters or without a total does nothing.
+  PerfCounters::Values total;
+  {
+    PerfCounters::Scope scope(NULL, &total);
+    busy_work(1000);
+  }
+  for (uint i = 0; i < PerfCounters::EVENT_COUNT; i++)
+  {
+    assert(total.value[i] == 0);
+  }
+
+  PerfCounters counters;
+  {
+    PerfCounters::Scope scope(&counters, NULL);
+    busy_work(1000);
+  }
+  if (!counters.open())
+  {
+    // Not an error, e.g. perf_event_paranoid may forbid it.
+    std::cout << "OK" << std::endl;
+    return 0;
+  }
+  // Unavailable events read as 0.
+  PerfCounters::Values now;
+  counters.read(&now);
+  for (uint i = 0; i < PerfCounters::EVENT_COUNT; i++)
+  {
+    if (!counters.available((PerfCounters::Event)i))
+    {
+      assert(now.value[i] == 0);
+    }
+  }
+  // Scopes accumulate.
+  {
+    PerfCounters::Scope scope(&counters, &total);
+    busy_work(10000000);
+  }
+  PerfCounters::Values first = total;
+  {
+    PerfCounters::Scope scope(&counters, &total);
+    busy_work(10000000);
+  }
+  for (uint i = 0; i < PerfCounters::EVENT_COUNT; i++)
+  {
+    assert(total.value[i] >= first.value[i]);
+  }
+  if (counters.available(PerfCounters::TASK_CLOCK))
+  {
+    assert(first.value[PerfCounters::TASK_CLOCK] > 0);
+  }
+  if (counters.available(PerfCounters::INSTRUCTIONS))
+  {
+    // At least an instruction per iteration
+    assert(first.value[PerfCounters::INSTRUCTIONS] >= 10000000);
+  }
+  std::cout << "OK" << std::endl;
+  return 0;
+}
@@ -0,0 +1,259 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include <assert.h>
+#include "PreparedProgramCache.hpp"
+
+PreparedProgramCache::PreparedProgramCache(size_t capacity):
+  m_capacity(capacity)
+{
+  assert(capacity > 0);
+}
+
+// Same as UNQUOTED_IDENTIFIER_CHARACTER in RestSQLLexer.l
+static inline bool
+is_word_character(char c)
+{
+  return ('0' <= c && c <= '9') ||
+         ('A' <= c && c <= 'Z') ||
+         ('a' <= c && c <= 'z') ||
+         c == '$' ||
+         c == '_' ||
+         (c & 0x80);
+}
+
+static inline bool
+is_whitespace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline bool
+is_digit(char c)
+{
+  return '0' <= c && c <= '9';
+}
+
+bool
+PreparedProgramCache::normalize(LexString sql,
+                                std::string* normalized,
+                                std::vector<LexString>* parameters)
+{
+  std::string& ret = *normalized;
+  ret.clear();
+  ret.reserve(sql.len);
+  parameters->clear();
+  const char* s = sql.str;
+  size_t len = sql.len;
+  bool pending_space = false;
+  size_t pos = 0;
+  while (pos < len)
+  {
+    char c = s[pos];
+    if (is_whitespace(c))
+    {
+      pending_space = !ret.empty();
+      pos++;
+      continue;
+    }
+    if (pending_space)
+    {
+      ret.push_back(' ');
+      pending_space = false;
+    }
+    size_t end = pos + 1;
+    bool is_literal = false;
+    if (c == '?')
+    {
+      return false;
+    }
+    else if (c == '`')
+    {
+      // Quoted identifier, where a doubled backtick is an escaped backtick.
+      while (end < len)
+      {
+        if (s[end] == '`')
+        {
+          end++;
+          if (end == len || s[end] != '`')
+          {
+            break;
+          }
+        }
+        end++;
+      }
+    }
+    else if (c == '\'')
+    {
+      // String literal, where a doubled apostrophe is an escaped apostrophe and
+      // a backslash escapes the next character. Like the lexer, we join string
+      // literals separated only by whitespace into one literal.
+      is_literal = true;
+      while (end < len)
+      {
+        if (s[end] == '\\')
+        {
+          end++;
+        }
+        else if (s[end] == '\'')
+        {
+          end++;
+          if (end == len || s[end] != '\'')
+          {
+            size_t next = end;
+            while (next < len && is_whitespace(s[next]))
+            {
+              next++;
+            }
+            if (next == end || next == len || s[next] != '\'')
+            {
+              break;
+            }
+            end = next;
+          }
+        }
+        end++;
+      }
+      end = end < len ? end : len;
+    }
+    else if (is_word_character(c))
+    {
+      // Identifier, keyword, integer or float. Like the lexer, we choose the
+      // longest match and prefer an integer over an identifier.
+      bool all_digits = true;
+      while (end < len && is_word_character(s[end]))
+      {
+        end++;
+      }
+      for (size_t i = pos; i < end; i++)
+      {
+        all_digits = all_digits && is_digit(s[i]);
+      }
+      if (all_digits &&
+          end + 1 < len &&
+          s[end] == '.' &&
+          is_digit(s[end + 1]))
+      {
+        end++;
+        while (end < len && is_digit(s[end]))
+        {
+          end++;
+        }
+      }
+      else
+      {
+        is_literal = all_digits;
+      }
+    }
+    if (is_literal)
+    {
+      LexString text = LexString{&s[pos], end - pos};
+      size_t idx = 0;
+      while (idx < parameters->size() && !((*parameters)[idx] == text))
+      {
+        idx++;
+      }
+      if (idx == parameters->size())
+      {
+        parameters->push_back(text);
+      }
+      ret.push_back('?');
+      ret.append(std::to_string(idx));
+      ret.push_back('?');
+    }
+    else
+    {
+      ret.append(&s[pos], end - pos);
+    }
+    pos = end;
+  }
+  return true;
+}
+
+std::shared_ptr<const PreparedProgramCache::Bytecode>
+PreparedProgramCache::lookup(const std::string& normalized_sql,
+                             uint64_t schema_version)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto found = m_index.find(normalized_sql);
+  if (found == m_index.end())
+  {
+    m_stats.misses++;
+    return NULL;
+  }
+  LRUList::iterator entry = found->second;
+  if (entry->schema_version != schema_version)
+  {
+    // Prepared against another schema version, so the column indexes in the
+    // bytecode can't be trusted.
+    m_index.erase(found);
+    m_lru.erase(entry);
+    m_stats.evictions++;
+    m_stats.misses++;
+    return NULL;
+  }
+  m_lru.splice(m_lru.begin(), m_lru, entry);
+  m_stats.hits++;
+  return entry->bytecode;
+}
+
+void
+PreparedProgramCache::insert(const std::string& normalized_sql,
+                             uint64_t schema_version,
+                             Bytecode&& bytecode)
+{
+  std::shared_ptr<const Bytecode> shared =
+    std::make_shared<const Bytecode>(std::move(bytecode));
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto found = m_index.find(normalized_sql);
+  if (found != m_index.end())
+  {
+    // Another thread prepared the same statement concurrently, or the schema
+    // version changed. Either way, the newest program wins.
+    LRUList::iterator entry = found->second;
+    entry->schema_version = schema_version;
+    entry->bytecode = shared;
+    m_lru.splice(m_lru.begin(), m_lru, entry);
+    return;
+  }
+  if (m_lru.size() >= m_capacity)
+  {
+    Entry& victim = m_lru.back();
+    m_index.erase(victim.normalized_sql);
+    m_lru.pop_back();
+    m_stats.evictions++;
+  }
+  m_lru.push_front(Entry{normalized_sql, schema_version, shared});
+  m_index[normalized_sql] = m_lru.begin();
+  m_stats.insertions++;
+}
+
+PreparedProgramCache::Stats
+PreparedProgramCache::get_stats()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Stats ret = m_stats;
+  ret.size = m_lru.size();
+  return ret;
+}
@@ -0,0 +1,101 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#ifndef PreparedProgramCache_hpp_included
+#define PreparedProgramCache_hpp_included 1
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "LexString.hpp"
+
+/*
+ * Thread-safe LRU cache of prepared programs, i.e. the output of
+ * RestSQLPreparer::write_bytecode. Entries are keyed by the normalized SQL text
+ * (see normalize()) and tagged with the schema version they were prepared
+ * against. A lookup with a different schema version is a miss and drops the
+ * stale entry.
+ *
+ * The cached bytecode is handed out as a shared pointer to an immutable
+ * vector, so a caller may keep using a program after it has been evicted. To
+ * run it, the caller copies it and binds the literals of its own statement
+ * using RestSQLPreparer::bind_parameters. If that fails, the statement has to
+ * be prepared from scratch.
+ */
+class PreparedProgramCache
+{
+public:
+  typedef std::vector<uint32_t> Bytecode;
+  struct Stats
+  {
+    unsigned long int hits = 0;
+    unsigned long int misses = 0;
+    unsigned long int insertions = 0;
+    unsigned long int evictions = 0;
+    size_t size = 0;
+  };
+  PreparedProgramCache(size_t capacity);
+  /*
+   * Compute the normalized form of an SQL statement: leading and trailing
+   * whitespace removed, all other runs of whitespace outside quotes replaced by
+   * one space, and each integer or string literal replaced by a placeholder
+   * ?N? where N is the index of its source text in `parameters`. Literals with
+   * the same source text share an index, the same way as in RestSQLPreparer.
+   * Two statements with the same normalized form produce the same bytecode up
+   * to RestSQLPreparer::bind_parameters.
+   *
+   * The parameters point into `sql`. Return false if the statement contains a
+   * question mark outside quotes. Such a statement is not valid and its
+   * normalized form could be mistaken for that of a valid statement.
+   */
+  static bool normalize(LexString sql,
+                        std::string* normalized,
+                        std::vector<LexString>* parameters);
+  std::shared_ptr<const Bytecode> lookup(const std::string& normalized_sql,
+                                         uint64_t schema_version);
+  void insert(const std::string& normalized_sql,
+              uint64_t schema_version,
+              Bytecode&& bytecode);
+  Stats get_stats();
+private:
+  struct Entry
+  {
+    std::string normalized_sql;
+    uint64_t schema_version;
+    std::shared_ptr<const Bytecode> bytecode;
+  };
+  typedef std::list<Entry> LRUList;
+  const size_t m_capacity;
+  std::mutex m_mutex;
+  LRUList m_lru; // Most recently used first
+  std::unordered_map<std::string, LRUList::iterator> m_index;
+  Stats m_stats;
+};
+
+#endif
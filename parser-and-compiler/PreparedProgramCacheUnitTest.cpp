@@ -0,0 +1,237 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include <stdio.h>
+#include <assert.h>
+#include <climits>
+#include <cstring>
+#include <thread>
+#include "AggregationAPICompiler.hpp"
+#include "ArenaAllocator.hpp"
+#include "PreparedProgramCache.hpp"
+#include "RestSQLPreparer.hpp"
+
+static std::string
+normalize(const char* sql, uint expected_parameters = 0)
+{
+  std::string normalized;
+  std::vector<LexString> parameters;
+  bool ok = PreparedProgramCache::normalize(LexString{sql, strlen(sql)},
+                                            &normalized,
+                                            &parameters);
+  assert(ok);
+  assert(parameters.size() == expected_parameters);
+  return normalized;
+}
+
+// Check that the parser numbers as many parameters as normalize does.
+static void
+check_parser_parameters(const char* sql, uint expected_parameters)
+{
+  normalize(sql, expected_parameters);
+  size_t len = strlen(sql);
+  std::vector<char> buffer(sql, sql + len);
+  buffer.push_back('\0');
+  buffer.push_back('\0');
+  ArenaAllocator aalloc;
+  RestSQLPreparer prepare(buffer.data(), buffer.size(), &aalloc);
+  bool parsed = prepare.parse();
+  assert(parsed);
+  assert(prepare.parameter_count() == expected_parameters);
+}
+
+int
+main(int argc, char** argv)
+{
+  // Test normalization. Whitespace is collapsed outside quotes and preserved
+  // inside them, also when the quote contains escaped or doubled quotes.
+  // Literals are replaced by placeholders numbered by distinct source text.
+  assert(normalize("  select a\n\tfrom  tbl ;\r\n") == "select a from tbl ;");
+  assert(normalize("select `a``  b`  from t") == "select `a``  b` from t");
+  assert(normalize("select `a  b` as x") != normalize("select `a b` as x"));
+  assert(normalize("") == "");
+  assert(normalize("select 'a  b' , 'a\\'  b' ,'a''  b'", 3) ==
+         "select ?0? , ?1? ,?2?");
+  assert(normalize("select sum(a+17), max(b*17), min(c-'17') from t1", 2) ==
+         "select sum(a+?0?), max(b*?0?), min(c-?1?) from t1");
+  assert(normalize("select sum(a+9) from t where b = 23", 2) ==
+         normalize("select sum(a+5) from t where b = 42", 2));
+  assert(normalize("select sum(a+5) from t where b = 5", 1) !=
+         normalize("select sum(a+5) from t where b = 42", 2));
+  assert(normalize("select 1.5, 1a, a1, 1", 1) == "select 1.5, 1a, a1, ?0?");
+  // Like in the lexer, string literals separated only by whitespace are one
+  // literal, so the parameters after them are numbered as by the parser.
+  assert(normalize("select 'a' 'b', 'a'\n\t'b', 'a''b', 'a'", 4) ==
+         "select ?0?, ?1?, ?2?, ?3?");
+  check_parser_parameters("select sum(a+1) from t where b = 'x' 'y' and "
+                          "c = 'x'\n  'y' and d = 'x' and e = 1;", 4);
+  {
+    std::string normalized;
+    std::vector<LexString> parameters;
+    const char* sql = "select sum(a+?0?) from t;";
+    assert(!PreparedProgramCache::normalize(LexString{sql, strlen(sql)},
+                                            &normalized,
+                                            &parameters));
+  }
+
+  // Test that a compiled program survives being serialized into the cache
+  // after the arena holding the compiler is gone, and that it can be bound to
+  // new parameter values.
+  PreparedProgramCache cache(2);
+  std::string key = normalize("select sum(a * (b + 3)), sum(-3) from t;", 1);
+  uint32_t len;
+  {
+    ArenaAllocator aalloc;
+    LexString col_names[] = { {"a", 1}, {"b", 1} };
+    AggregationAPICompiler agg(
+      [col_names](LexString ls) -> int
+      {
+        for (int i = 0; i < 2; i++)
+        {
+          if (ls == col_names[i])
+          {
+            return i;
+          }
+        }
+        return -1;
+      },
+      [col_names](int idx) -> LexString
+      {
+        assert(idx>=0 && idx<2);
+        return col_names[idx];
+      },
+      &aalloc);
+    agg.Sum(agg.Mul("a", agg.Add("b", agg.Parameter(0, 3))));
+    agg.Sum(agg.Minus(agg.ConstantInteger(0), agg.Parameter(0, 3)));
+    bool compiled = agg.compile();
+    assert(compiled);
+    len = agg.bytecode_length();
+    PreparedProgramCache::Bytecode bytecode(len);
+    agg.write_bytecode(bytecode.data());
+    cache.insert(key, 1, std::move(bytecode));
+  }
+  auto program = cache.lookup(key, 1);
+  assert(program != NULL);
+  assert(program->size() == len);
+  uint32_t n_instr = (*program)[0];
+  uint32_t n_const = (*program)[1];
+  uint32_t n_sources = (*program)[2];
+  assert(n_const == 3); // 3, 0 and the folded -3
+  assert(n_sources == 4);
+  assert(len == 3 + 2 * n_instr + 2 * n_const + 4 * n_sources);
+  const uint32_t* constants = &(*program)[3 + 2 * n_instr];
+  assert(int64_t(constants[4] | uint64_t(constants[5]) << 32) == -3);
+  PreparedProgramCache::Bytecode bound = *program;
+  long int params[] = { -8 };
+  assert(AggregationAPICompiler::bind_parameters(bound.data(), len, params, 1));
+  constants = &bound[3 + 2 * n_instr];
+  assert(int64_t(constants[0] | uint64_t(constants[1]) << 32) == -8);
+  assert(int64_t(constants[2] | uint64_t(constants[3]) << 32) == 0);
+  assert(int64_t(constants[4] | uint64_t(constants[5]) << 32) == 8);
+  // With 0, the compiler would have shared one constant for the parameter and
+  // the fixed 0, which is harmless. The other way around is not: A program
+  // compiled with a shared constant can't be bound to values that differ.
+  params[0] = 0;
+  assert(AggregationAPICompiler::bind_parameters(bound.data(), len, params, 1));
+  // Folding 0 - LONG_MIN would overflow.
+  params[0] = LONG_MIN;
+  assert(!AggregationAPICompiler::bind_parameters(bound.data(), len, params, 1));
+  // The header must match the length of the bytecode.
+  params[0] = -8;
+  assert(!AggregationAPICompiler::bind_parameters(bound.data(), len - 1,
+                                                  params, 1));
+  assert(!AggregationAPICompiler::bind_parameters(bound.data(), 2, params, 1));
+  {
+    ArenaAllocator aalloc;
+    AggregationAPICompiler agg(
+      [](LexString ls) -> int { return 0; },
+      [](int idx) -> LexString { return LexString{"a", 1}; },
+      &aalloc);
+    agg.Sum(agg.Add("a", agg.Parameter(0, 1)));
+    agg.Count(agg.ConstantInteger(1));
+    bool compiled = agg.compile();
+    assert(compiled);
+    PreparedProgramCache::Bytecode shared(agg.bytecode_length());
+    agg.write_bytecode(shared.data());
+    assert(shared[1] == 1); // Number of constants
+    uint shared_len = shared.size();
+    params[0] = 1;
+    assert(AggregationAPICompiler::bind_parameters(shared.data(), shared_len,
+                                                   params, 1));
+    params[0] = 2;
+    assert(!AggregationAPICompiler::bind_parameters(shared.data(), shared_len,
+                                                    params, 1));
+    assert(!AggregationAPICompiler::bind_parameters(shared.data(), shared_len,
+                                                    params, 0));
+  }
+
+  // Test schema versioning, LRU eviction and statistics.
+  assert(cache.lookup(key, 2) == NULL); // Stale entry is dropped
+  assert(cache.lookup(key, 1) == NULL);
+  cache.insert("q1", 1, PreparedProgramCache::Bytecode{1});
+  cache.insert("q2", 1, PreparedProgramCache::Bytecode{2});
+  assert(cache.lookup("q1", 1) != NULL); // q2 is now least recently used
+  cache.insert("q3", 1, PreparedProgramCache::Bytecode{3});
+  assert(cache.lookup("q2", 1) == NULL);
+  assert((*cache.lookup("q1", 1))[0] == 1);
+  assert((*cache.lookup("q3", 1))[0] == 3);
+  PreparedProgramCache::Stats stats = cache.get_stats();
+  assert(stats.hits == 4);
+  assert(stats.misses == 3);
+  assert(stats.insertions == 4);
+  assert(stats.evictions == 2);
+  assert(stats.size == 2);
+
+  // Test concurrent use.
+  PreparedProgramCache shared_cache(8);
+  std::thread threads[4];
+  for (int t = 0; t < 4; t++)
+  {
+    threads[t] = std::thread([&shared_cache, t]()
+    {
+      for (uint32_t i = 0; i < 1000; i++)
+      {
+        std::string k = std::to_string((i + t) % 16);
+        auto found = shared_cache.lookup(k, 1);
+        if (found == NULL)
+        {
+          shared_cache.insert(k, 1, PreparedProgramCache::Bytecode{(i + t) % 16});
+        }
+        else
+        {
+          assert((*found)[0] == (i + t) % 16);
+        }
+      }
+    });
+  }
+  for (int t = 0; t < 4; t++)
+  {
+    threads[t].join();
+  }
+  stats = shared_cache.get_stats();
+  assert(stats.hits + stats.misses == 4000);
+  assert(stats.size <= 8);
+
+  printf("OK\n");
+}
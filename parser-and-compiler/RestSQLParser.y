@@ -145,6 +145,10 @@ extern void rsqlp_error(RSQLP_LTYPE* yylloc, yyscan_t yyscanner, const char* s);
 %token T_SEMICOLON
 %token T_OR T_XOR T_AND T_NOT T_EQUALS T_GE T_GT T_LE T_LT T_NOT_EQUALS T_IS T_NULL T_BITWISE_OR T_BITWISE_AND T_BITSHIFT_LEFT T_BITSHIFT_RIGHT T_PLUS T_MINUS T_MULTIPLY T_DIVIDE T_MODULO T_BITWISE_XOR T_EXCLAMATION
 %token T_INTERVAL T_DATE_ADD T_DATE_SUB T_EXTRACT T_MICROSECOND T_SECOND T_MINUTE T_HOUR T_DAY T_WEEK T_MONTH T_QUARTER T_YEAR T_SECOND_MICROSECOND T_MINUTE_MICROSECOND T_MINUTE_SECOND T_HOUR_MICROSECOND T_HOUR_SECOND T_HOUR_MINUTE T_DAY_MICROSECOND T_DAY_SECOND T_DAY_MINUTE T_DAY_HOUR T_YEAR_MONTH
+/* Not produced by the lexer. RestSQLPreparer::load replaces DATE_ADD and
+ * DATE_SUB expressions with constant arguments by nodes of this type.
+ */
+%token T_DATETIME_CONSTANT
 
 /*
  * MySQL operator presedence, strongest binding first:
@@ -268,7 +272,7 @@ aggfun:
 
 arith_expr:
   identifier                            { $$ = context->get_agg()->Load($1); }
-| T_INT                                 { $$ = context->get_agg()->ConstantInteger($1); }
+| T_INT                                 { $$ = context->get_agg()->Parameter(context->parameter_index(@1), $1); }
 | T_MINUS arith_expr                    { $$ = context->get_agg()->Minus(context->get_agg()->ConstantInteger(0), $2); }
 | T_LEFT arith_expr T_RIGHT             { $$ = $2; }
 | arith_expr T_PLUS arith_expr          { $$ = context->get_agg()->Add($1, $3); }
@@ -284,10 +288,13 @@ where_opt:
   %empty                                { $$ = NULL; }
 | T_WHERE cond_expr                     { $$ = $2; }
 
+/* Conditions are not compiled yet, but their literals still get parameter
+ * indexes so that the numbering agrees with PreparedProgramCache::normalize.
+ */
 cond_expr:
   identifier                            { initptr($$); $$->op = T_IDENTIFIER; $$->identifier = $1; }
-| T_STRING                              { initptr($$); $$->op = T_STRING; $$->string = $1; }
-| T_INT                                 { initptr($$); $$->op = T_INT; $$->constant_integer = $1; }
+| T_STRING                              { initptr($$); $$->op = T_STRING; $$->string = $1; context->parameter_index(@1); }
+| T_INT                                 { initptr($$); $$->op = T_INT; $$->constant_integer = $1; context->parameter_index(@1); }
 | T_MINUS cond_expr                     { if ( $2->op == T_INT) { initptr($$); $$->op = T_INT; $$->constant_integer = -$2->constant_integer; }
                                           else { init_cond($$, NULL, T_MINUS, $2); } }
 | T_LEFT cond_expr T_RIGHT              { $$ = $2; }
@@ -23,20 +23,70 @@
 */
 
 #include <assert.h>
+#include <climits>
+#include <memory>
+#include <new>
 #include "AggregationAPICompiler.hpp"
+#include "DateTime.hpp"
+#include "PreparedProgramCache.hpp"
 #include "RestSQLParser.y.hpp"
 #include "RestSQLLexer.l.hpp"
 #include "RestSQLPreparer.hpp"
+#include "Utf8Validator.hpp"
 using std::cout;
 using std::cerr;
 using std::endl;
 
+// Defined in RestSQLLexer.l
+extern void rsqlp_reset_start_condition(yyscan_t scanner);
+
+/*
+ * Creating a flex scanner for each statement is a significant part of the cost
+ * of preparing a short statement. Instead, each thread keeps a scanner that is
+ * rebound to the buffer and context of one statement at a time. Its long-lived
+ * state lives in an arena of its own, while the per-statement buffer state is
+ * allocated in the arena of the statement as usual. A RestSQLPreparer created
+ * while the thread's scanner is in use gets a private scanner.
+ */
+namespace
+{
+  struct ThreadScanner
+  {
+    ArenaAllocator aalloc;
+    yyscan_t scanner = NULL;
+    bool in_use = false;
+    ~ThreadScanner()
+    {
+      if (scanner != NULL)
+      {
+        rsqlp_lex_destroy(scanner);
+      }
+    }
+  };
+  thread_local ThreadScanner thread_scanner;
+}
+
+/*
+ * Rough upper bounds on the density of identifiers, literals and expressions in
+ * SQL text, used to size the dynamic arrays. They only need to be right within
+ * a factor of two or so, since the arrays still grow as needed.
+ */
+static const size_t SQL_BYTES_PER_IDENTIFIER = 8;
+static const size_t SQL_BYTES_PER_LITERAL = 16;
+static const size_t SQL_BYTES_PER_EXPR = 4;
+
 RestSQLPreparer::RestSQLPreparer(char* sql_buffer,
                                  size_t sql_len,
-                                 ArenaAllocator* aalloc):
-  m_identifiers(aalloc),
+                                 ArenaAllocator* aalloc,
+                                 const SchemaCatalog* catalog):
+  m_identifiers(aalloc, sql_len / SQL_BYTES_PER_IDENTIFIER),
+  m_identifier_index(aalloc),
+  m_parameters(aalloc, sql_len / SQL_BYTES_PER_LITERAL),
+  m_parameter_index(aalloc),
   m_aalloc(aalloc),
-  m_context(*this)
+  m_arena_stats_at_start(aalloc->get_stats()),
+  m_context(*this),
+  m_catalog(catalog)
 {
   /*
    * Both `yy_scan_string' and `yy_scan_bytes' create and scan a copy of the
@@ -49,7 +99,35 @@ RestSQLPreparer::RestSQLPreparer(char* sql_buffer,
   assert(sql_len >= 2);
   assert(sql_buffer[sql_len-1] == '\0');
   assert(sql_buffer[sql_len-2] == '\0');
-  rsqlp_lex_init_extra(&m_context, &m_scanner);
+  ThreadScanner& ts = thread_scanner;
+  if (ts.in_use)
+  {
+    rsqlp_lex_init_extra(&m_context, &m_scanner);
+    m_owns_scanner = true;
+  }
+  else
+  {
+    if (ts.scanner == NULL)
+    {
+      /*
+       * Let flex allocate the scanner and its buffer stack in the arena of the
+       * thread scanner by temporarily pointing the context there. The buffer
+       * stack is allocated at the first buffer switch, hence the empty buffer.
+       */
+      ArenaAllocator* statement_aalloc = m_aalloc;
+      m_aalloc = &ts.aalloc;
+      yyscan_t scanner;
+      rsqlp_lex_init_extra(&m_context, &scanner);
+      char empty[2] = { '\0', '\0' };
+      rsqlp__delete_buffer(rsqlp__scan_buffer(empty, 2, scanner), scanner);
+      m_aalloc = statement_aalloc;
+      ts.scanner = scanner;
+    }
+    m_scanner = ts.scanner;
+    m_owns_scanner = false;
+    rsqlp_set_extra(&m_context, m_scanner);
+    rsqlp_reset_start_condition(m_scanner);
+  }
   // The non-const sql_buffer is only used to initialize the flex scanner. The
   // flex scanner shouldn't modify it either, but only because we have removed
   // the buffer-modifying code from the generated output (see Makefile rule
@@ -59,6 +137,26 @@ RestSQLPreparer::RestSQLPreparer(char* sql_buffer,
   // We don't want the NUL bytes that flex requires.
   uint our_buffer_len = sql_len - 2;
   m_sql = { (const char*)(sql_buffer), our_buffer_len };
+  /*
+   * Validate UTF-8 in bulk up front, so that the lexer can use simpler rules
+   * for quoted strings and identifiers. If validation fails, the lexer uses the
+   * detailed rules and reports the error with its position.
+   */
+  m_context.m_utf8_validated = utf8_is_valid(m_sql.str, m_sql.len);
+  /*
+   * Let the arena allocate one page of the size that statements of this length
+   * have needed so far, rather than a chain of doubling pages.
+   */
+  m_aalloc->size_hint(ArenaSizingStats::global().suggested_size(m_sql.len));
+  /*
+   * Claim the thread's scanner last. If anything above throws, the destructor
+   * never runs, and a scanner claimed earlier would stay in use for the rest of
+   * the thread. Likewise, the scanner is only published once fully set up.
+   */
+  if (!m_owns_scanner)
+  {
+    ts.in_use = true;
+  }
 }
 
 #define assert_status(name) assert(m_status == Status::name)
@@ -72,6 +170,7 @@ RestSQLPreparer::parse()
   }
   assert_status(INITIALIZED);
   m_status = Status::PARSING;
+  PerfCounters::Scope perf_scope(m_perf, perf_stage(PERF_STAGE_PARSE));
   int parse_result = rsqlp_parse(m_scanner);
   if (parse_result == 0)
   {
@@ -298,18 +397,22 @@ RestSQLPreparer::load()
   }
   assert_status(PARSED);
   m_status = Status::LOADING;
+  PerfCounters::Scope perf_scope(m_perf, perf_stage(PERF_STAGE_LOAD));
   /*
-   * todo: During parsing, strings that are claimed to be column names were
-   * assigned consecutive indexes as they were found. These indexes have already
-   * been used to construct expressions in m_agg. Now that parsing is done and
-   * we know the table name, we should look up the real column indexes in the
-   * schema, check that the table and columns exist, and remap the indexes
-   * inside both m_ast_root and m_agg.
+   * During parsing, strings that are claimed to be column names were assigned
+   * consecutive indexes as they were found. These indexes have already been
+   * used to construct expressions in m_agg. Now that parsing is done and we
+   * know the table name, we look up the real column indexes and types in the
+   * schema catalog and check that the table and columns exist. Rather than
+   * remapping the indexes inside m_ast_root and m_agg, we keep the mapping in
+   * m_load_sources and apply it in write_bytecode.
    */
-
-  // Load schema information and check that the table and columns exist.
-
-  // Remap column indexes in m_ast_root and m_agg.
+  if (m_catalog != NULL && !load_schema())
+  {
+    m_status = Status::FAILED;
+    return false;
+  }
+  fold_constants(m_context.ast_root.where_expression);
 
   // Load aggregates
   Outputs* outputs = m_context.ast_root.outputs;
@@ -356,6 +459,248 @@ RestSQLPreparer::load()
   return true;
 }
 
+bool
+RestSQLPreparer::load_schema()
+{
+  const SchemaCatalog::Table* table =
+    m_catalog->find_table(m_context.ast_root.table);
+  if (table == NULL)
+  {
+    cerr << "Unknown table " <<
+      AggregationAPICompiler::QuotedIdentifier(m_context.ast_root.table) <<
+      "." << endl;
+    return false;
+  }
+  // Give indexes also to the columns that do not occur in m_agg.
+  struct GroupbyColumns* groupby = m_context.ast_root.groupby_columns;
+  while (groupby != NULL)
+  {
+    column_name_to_idx(groupby->col_name);
+    groupby = groupby->next;
+  }
+  register_columns(m_context.ast_root.where_expression);
+  m_load_sources = static_cast<uint32_t*>(
+    m_aalloc->alloc(m_identifiers.size() * sizeof(uint32_t)));
+  for (uint i = 0; i < m_identifiers.size(); i++)
+  {
+    const SchemaCatalog::Column* column = table->find_column(m_identifiers[i]);
+    if (column == NULL)
+    {
+      cerr << "Unknown column " <<
+        AggregationAPICompiler::QuotedIdentifier(m_identifiers[i]) <<
+        " in table " <<
+        AggregationAPICompiler::QuotedIdentifier(table->name) << "." << endl;
+      return false;
+    }
+    m_load_sources[i] = (uint32_t(column->type) << 16) | column->idx;
+  }
+  return true;
+}
+
+void
+RestSQLPreparer::register_columns(struct ConditionalExpression* ce)
+{
+  if (ce == NULL)
+  {
+    return;
+  }
+  switch (ce->op)
+  {
+  case T_IDENTIFIER:
+    column_name_to_idx(ce->identifier);
+    return;
+  case T_STRING:
+  case T_INT:
+  case T_NULL:
+  case T_DATETIME_CONSTANT:
+    return;
+  case T_IS:
+    register_columns(ce->is.arg);
+    return;
+  case T_INTERVAL:
+    register_columns(ce->interval.arg);
+    return;
+  case T_EXTRACT:
+    register_columns(ce->extract.arg);
+    return;
+  default:
+    register_columns(ce->args.left);
+    register_columns(ce->args.right);
+  }
+}
+
+static IntervalUnit
+interval_unit(int interval_type)
+{
+  switch (interval_type)
+  {
+  case T_MICROSECOND: return IntervalUnit::Microsecond;
+  case T_SECOND: return IntervalUnit::Second;
+  case T_MINUTE: return IntervalUnit::Minute;
+  case T_HOUR: return IntervalUnit::Hour;
+  case T_DAY: return IntervalUnit::Day;
+  case T_WEEK: return IntervalUnit::Week;
+  case T_MONTH: return IntervalUnit::Month;
+  case T_QUARTER: return IntervalUnit::Quarter;
+  case T_YEAR: return IntervalUnit::Year;
+  case T_SECOND_MICROSECOND: return IntervalUnit::SecondMicrosecond;
+  case T_MINUTE_MICROSECOND: return IntervalUnit::MinuteMicrosecond;
+  case T_MINUTE_SECOND: return IntervalUnit::MinuteSecond;
+  case T_HOUR_MICROSECOND: return IntervalUnit::HourMicrosecond;
+  case T_HOUR_SECOND: return IntervalUnit::HourSecond;
+  case T_HOUR_MINUTE: return IntervalUnit::HourMinute;
+  case T_DAY_MICROSECOND: return IntervalUnit::DayMicrosecond;
+  case T_DAY_SECOND: return IntervalUnit::DaySecond;
+  case T_DAY_MINUTE: return IntervalUnit::DayMinute;
+  case T_DAY_HOUR: return IntervalUnit::DayHour;
+  case T_YEAR_MONTH: return IntervalUnit::YearMonth;
+  default: assert(false);
+  }
+}
+
+static bool
+is_constant(struct ConditionalExpression* ce)
+{
+  return ce->op == T_STRING || ce->op == T_INT || ce->op == T_NULL ||
+    ce->op == T_DATETIME_CONSTANT;
+}
+
+// Return false if the constant ce is NULL or not a valid date.
+static bool
+constant_to_datetime(struct ConditionalExpression* ce, DateTime& dt)
+{
+  switch (ce->op)
+  {
+  case T_STRING:
+    return dt.parse(ce->string);
+  case T_INT:
+    return dt.parse(ce->constant_integer);
+  case T_DATETIME_CONSTANT:
+    dt = DateTime::unpack(ce->datetime.packed,
+                          ce->datetime.is_date,
+                          ce->datetime.has_fraction);
+    return true;
+  case T_NULL:
+    return false;
+  default:
+    assert(false);
+    return false;
+  }
+}
+
+// Return false if the constant ce is NULL or not a valid interval.
+static bool
+constant_to_interval(struct ConditionalExpression* ce,
+                     IntervalUnit unit,
+                     Interval& iv)
+{
+  switch (ce->op)
+  {
+  case T_STRING:
+    return iv.parse(unit, ce->string);
+  case T_INT:
+    return iv.parse(unit, ce->constant_integer);
+  case T_NULL:
+    return false;
+  default:
+    assert(false);
+    return false;
+  }
+}
+
+/*
+ * Replace DATE_ADD, DATE_SUB and EXTRACT with constant arguments by their
+ * values, so that a date filter becomes a plain comparison with a constant. As
+ * in MySQL, an invalid date or a result out of range gives NULL. Expressions
+ * with column arguments are left as they are.
+ *
+ * Note that the folded values are computed from literals that are otherwise
+ * parameters, so a program that uses them can only be reused for statements
+ * with the same literals in these expressions.
+ */
+void
+RestSQLPreparer::fold_constants(struct ConditionalExpression* ce)
+{
+  if (ce == NULL)
+  {
+    return;
+  }
+  switch (ce->op)
+  {
+  case T_IDENTIFIER:
+  case T_STRING:
+  case T_INT:
+  case T_NULL:
+  case T_DATETIME_CONSTANT:
+    return;
+  case T_IS:
+    fold_constants(ce->is.arg);
+    return;
+  case T_INTERVAL:
+    fold_constants(ce->interval.arg);
+    return;
+  case T_EXTRACT:
+    {
+      struct ConditionalExpression* arg = ce->extract.arg;
+      fold_constants(arg);
+      if (!is_constant(arg))
+      {
+        return;
+      }
+      DateTime dt;
+      if (constant_to_datetime(arg, dt))
+      {
+        long int value = dt.extract(interval_unit(ce->extract.interval_type));
+        ce->op = T_INT;
+        ce->constant_integer = value;
+      }
+      else
+      {
+        ce->op = T_NULL;
+      }
+      return;
+    }
+  case T_DATE_ADD:
+  case T_DATE_SUB:
+    {
+      fold_constants(ce->args.left);
+      fold_constants(ce->args.right);
+      struct ConditionalExpression* date = ce->args.left;
+      struct ConditionalExpression* interval = ce->args.right;
+      if (interval->op != T_INTERVAL || !is_constant(date))
+      {
+        return;
+      }
+      struct ConditionalExpression* value = interval->interval.arg;
+      if (!is_constant(value) || value->op == T_DATETIME_CONSTANT)
+      {
+        return;
+      }
+      IntervalUnit unit = interval_unit(interval->interval.interval_type);
+      DateTime dt;
+      Interval iv;
+      bool ok = constant_to_datetime(date, dt) &&
+        constant_to_interval(value, unit, iv) &&
+        dt.add(unit, iv, ce->op == T_DATE_SUB);
+      if (ok)
+      {
+        ce->op = T_DATETIME_CONSTANT;
+        ce->datetime.packed = dt.packed();
+        ce->datetime.is_date = dt.is_date;
+        ce->datetime.has_fraction = dt.has_fraction;
+      }
+      else
+      {
+        ce->op = T_NULL;
+      }
+      return;
+    }
+  default:
+    fold_constants(ce->args.left);
+    fold_constants(ce->args.right);
+  }
+}
+
 bool
 RestSQLPreparer::compile()
 {
@@ -365,6 +710,7 @@ RestSQLPreparer::compile()
   }
   assert_status(LOADED);
   m_status = Status::COMPILING;
+  PerfCounters::Scope perf_scope(m_perf, perf_stage(PERF_STAGE_COMPILE));
   if (m_agg != NULL)
   {
     if (m_agg->compile())
@@ -490,6 +836,235 @@ RestSQLPreparer::print()
   return true;
 }
 
+uint
+RestSQLPreparer::bytecode_length()
+{
+  assert_status(COMPILED);
+  uint len = 1;
+  struct GroupbyColumns* groupby = m_context.ast_root.groupby_columns;
+  while (groupby != NULL)
+  {
+    len++;
+    groupby = groupby->next;
+  }
+  len += m_agg != NULL ? m_agg->bytecode_length() : 3;
+  return len;
+}
+
+void
+RestSQLPreparer::write_bytecode(uint32_t* dest)
+{
+  assert_status(COMPILED);
+  uint32_t* p = dest + 1;
+  uint32_t n_groupby_cols = 0;
+  struct GroupbyColumns* groupby = m_context.ast_root.groupby_columns;
+  while (groupby != NULL)
+  {
+    uint32_t col_idx = column_name_to_idx(groupby->col_name);
+    *p++ = m_load_sources != NULL ? m_load_sources[col_idx] & 0xffff : col_idx;
+    n_groupby_cols++;
+    groupby = groupby->next;
+  }
+  uint32_t n_aggs = 0;
+  if (m_agg != NULL)
+  {
+    m_agg->write_bytecode(p, m_load_sources);
+    n_aggs = m_agg->number_of_aggregates();
+  }
+  else
+  {
+    p[0] = 0;
+    p[1] = 0;
+    p[2] = 0;
+  }
+  assert(n_groupby_cols <= 0xffff && n_aggs <= 0xffff);
+  dest[0] = (n_groupby_cols << 16) | n_aggs;
+}
+
+ArenaAllocator::Stats
+RestSQLPreparer::get_arena_stats() const
+{
+  return m_aalloc->get_stats() - m_arena_stats_at_start;
+}
+
+uint
+RestSQLPreparer::parameter_count() const
+{
+  return m_parameters.size();
+}
+
+void
+RestSQLPreparer::set_perf_counters(const PerfCounters* counters,
+                                   PerfCounters::Values* stages)
+{
+  m_perf = counters;
+  m_perf_stages = stages;
+}
+
+void
+RestSQLPreparer::print_perf(std::ostream& out,
+                            const PerfCounters& counters,
+                            const PerfCounters::Values* stages,
+                            unsigned long int statements,
+                            unsigned long int sql_bytes)
+{
+  static const char* stage_names[PERF_STAGE_COUNT] =
+  {
+    "parse", "load", "compile",
+  };
+  PerfCounters::Values total;
+  for (uint i = 0; i < PERF_STAGE_COUNT; i++)
+  {
+    total += stages[i];
+  }
+  out << "Prepared " << statements << " statements, " << sql_bytes
+      << " bytes of SQL" << endl;
+  counters.print(out, total, statements, "statement");
+  for (uint i = 0; i < PERF_STAGE_COUNT; i++)
+  {
+    out << "-> " << stage_names[i] << endl;
+    counters.print(out, stages[i], statements, "statement");
+  }
+}
+
+uint
+RestSQLPreparer::prepare_batch(BatchStatement* statements,
+                               uint count,
+                               const SchemaCatalog* catalog,
+                               const PerfCounters* perf_counters,
+                               PerfCounters::Values* perf_stages)
+{
+  uint prepared = 0;
+  PooledArenaAllocator aalloc;
+  for (uint i = 0; i < count; i++)
+  {
+    BatchStatement& statement = statements[i];
+    statement.ok = false;
+    statement.bytecode.clear();
+    try
+    {
+      RestSQLPreparer prepare(statement.sql_buffer,
+                              statement.sql_len,
+                              aalloc.get(),
+                              catalog);
+      prepare.set_perf_counters(perf_counters, perf_stages);
+      if (prepare.parse() && prepare.load() && prepare.compile())
+      {
+        statement.bytecode.resize(prepare.bytecode_length());
+        prepare.write_bytecode(statement.bytecode.data());
+        statement.ok = true;
+        prepared++;
+      }
+    }
+    catch (std::runtime_error& e)
+    {
+      cerr << "Caught exception: " << e.what() << endl;
+    }
+    aalloc.get()->reset();
+  }
+  return prepared;
+}
+
+bool
+RestSQLPreparer::prepare_cached(char* sql_buffer,
+                                size_t sql_len,
+                                ArenaAllocator* aalloc,
+                                PreparedProgramCache* cache,
+                                std::vector<uint32_t>* bytecode,
+                                const SchemaCatalog* catalog)
+{
+  assert(sql_len >= 2);
+  uint64_t schema_version = catalog == NULL ? 0 : catalog->version();
+  std::string normalized;
+  std::vector<LexString> parameters;
+  // The NUL bytes that flex requires are not part of the statement.
+  bool cacheable = PreparedProgramCache::normalize(LexString{sql_buffer,
+                                                             sql_len - 2},
+                                                   &normalized,
+                                                   &parameters);
+  std::shared_ptr<const PreparedProgramCache::Bytecode> cached;
+  if (cacheable)
+  {
+    cached = cache->lookup(normalized, schema_version);
+  }
+  if (cached != NULL)
+  {
+    *bytecode = *cached;
+    if (bind_parameters(bytecode->data(), bytecode->size(), parameters.data(),
+                        parameters.size()))
+    {
+      return true;
+    }
+    // The cached program can't take these literals, e.g. because it shares one
+    // constant between a literal and a fixed value that differ here. The
+    // program prepared for this statement is no better for the next one, so
+    // the cache entry is kept.
+  }
+  bytecode->clear();
+  try
+  {
+    RestSQLPreparer prepare(sql_buffer, sql_len, aalloc, catalog);
+    if (!(prepare.parse() && prepare.load() && prepare.compile()))
+    {
+      return false;
+    }
+    bytecode->resize(prepare.bytecode_length());
+    prepare.write_bytecode(bytecode->data());
+  }
+  catch (std::runtime_error& e)
+  {
+    cerr << "Caught exception: " << e.what() << endl;
+    bytecode->clear();
+    return false;
+  }
+  if (cacheable && cached == NULL)
+  {
+    cache->insert(normalized, schema_version,
+                  PreparedProgramCache::Bytecode(*bytecode));
+  }
+  return true;
+}
+
+bool
+RestSQLPreparer::bind_parameters(uint32_t* bytecode,
+                                 uint bytecode_len,
+                                 const LexString* parameters,
+                                 uint n_parameters)
+{
+  if (bytecode_len < 1 || 1 + (bytecode[0] >> 16) > bytecode_len)
+  {
+    return false;
+  }
+  std::vector<long int> values(n_parameters);
+  for (uint i = 0; i < n_parameters; i++)
+  {
+    // Only integer literals can occur in the aggregation program. String
+    // literals get a value that is never used.
+    const LexString& param = parameters[i];
+    long int value = 0;
+    for (uint j = 0; j < param.len; j++)
+    {
+      char c = param.str[j];
+      if (c < '0' || '9' < c)
+      {
+        value = 0;
+        break;
+      }
+      value = value > (LONG_MAX - (c - '0')) / 10
+        ? LONG_MAX
+        : value * 10 + (c - '0');
+    }
+    // Same result as atoi in the lexer, i.e. (int)strtol.
+    values[i] = int(value);
+  }
+  uint n_groupby_cols = bytecode[0] >> 16;
+  return AggregationAPICompiler::bind_parameters(bytecode + 1 + n_groupby_cols,
+                                                 bytecode_len - 1 -
+                                                   n_groupby_cols,
+                                                 values.data(),
+                                                 n_parameters);
+}
+
 void
 RestSQLPreparer::print(struct ConditionalExpression* ce, LexString prefix)
 {
@@ -522,6 +1097,19 @@ RestSQLPreparer::print(struct ConditionalExpression* ce, LexString prefix)
   case T_INT:
     cout << ce->constant_integer << endl;
     return;
+  case T_NULL:
+    cout << "NULL" << endl;
+    return;
+  case T_DATETIME_CONSTANT:
+    {
+      DateTime dt = DateTime::unpack(ce->datetime.packed,
+                                     ce->datetime.is_date,
+                                     ce->datetime.has_fraction);
+      char buf[DateTime::MAX_FORMATTED_LENGTH];
+      cout << (dt.is_date ? "DATE: " : "DATETIME: ") <<
+        LexString{buf, dt.format(buf)} << endl;
+      return;
+    }
   case T_OR:
     opstr = "OR";
     break;
@@ -691,18 +1279,29 @@ const char* interval_type_name(int interval_type)
   }
 }
 
+/*
+ * Return the index of a column name, assigning the next free index to names
+ * not seen before. The hash index keeps this O(1) also for wide tables, and
+ * since its slots hold the full hash, the names themselves are only compared
+ * on a probable match.
+ */
 int
 RestSQLPreparer::column_name_to_idx(LexString col_name)
 {
-  for (int i=0; i<m_identifiers.size(); i++)
-  {
-    if (m_identifiers[i] == col_name)
+  uint32_t hash = col_name.hash();
+  int found = m_identifier_index.find(hash,
+    [this, &col_name](uint idx) -> bool
     {
-      return i;
-    }
+      return m_identifiers[idx] == col_name;
+    });
+  if (found >= 0)
+  {
+    return found;
   }
   m_identifiers.push(col_name);
-  return m_identifiers.size()-1;
+  uint idx = m_identifiers.size()-1;
+  m_identifier_index.insert(hash, idx);
+  return idx;
 }
 
 LexString
@@ -714,8 +1313,17 @@ RestSQLPreparer::column_idx_to_name(int col_idx)
 
 RestSQLPreparer::~RestSQLPreparer()
 {
+  ArenaSizingStats::global().record(m_sql.len,
+                                    get_arena_stats().bytes_requested);
   rsqlp__delete_buffer(m_buf, m_scanner);
-  rsqlp_lex_destroy(m_scanner);
+  if (m_owns_scanner)
+  {
+    rsqlp_lex_destroy(m_scanner);
+  }
+  else
+  {
+    thread_scanner.in_use = false;
+  }
 }
 
 void
@@ -754,15 +1362,7 @@ RestSQLPreparer::Context::get_agg()
   std::function<int(LexString)> column_name_to_idx =
     [_this](LexString ls) -> int
     {
-      for (int i=0; i<_this->m_identifiers.size(); i++)
-      {
-        if (ls == LexString(_this->m_identifiers[i]))
-        {
-          return i;
-        }
-      }
-      _this->m_identifiers.push(ls);
-      return _this->m_identifiers.size()-1;
+      return _this->column_name_to_idx(ls);
     };
   std::function<LexString(int)> column_idx_to_name =
     [_this](int idx) -> LexString
@@ -776,13 +1376,54 @@ RestSQLPreparer::Context::get_agg()
    * because they are both working in the prepare phase. After loading and
    * compilation, a new object will be crafted that holds the information
    * necessary for execution and post-processing.
+   *
+   * The aggregator object itself is also placed in the arena, so that it is
+   * released together with everything it points to, and so that preparing with
+   * a reused arena does not touch the heap. The arena does not align, so we
+   * ask for some slack and align ourselves.
    */
-  m_parser.m_agg = new AggregationAPICompiler(column_name_to_idx,
-                                  column_idx_to_name,
-                                  m_parser.m_aalloc);
+  size_t space = sizeof(AggregationAPICompiler) +
+    alignof(AggregationAPICompiler) - 1;
+  void* mem = m_parser.m_aalloc->alloc(space);
+  mem = std::align(alignof(AggregationAPICompiler),
+                   sizeof(AggregationAPICompiler),
+                   mem,
+                   space);
+  assert(mem != NULL);
+  m_parser.m_agg = new (mem) AggregationAPICompiler(column_name_to_idx,
+                                                    column_idx_to_name,
+                                                    m_parser.m_aalloc,
+                                                    m_parser.m_sql.len /
+                                                      SQL_BYTES_PER_EXPR);
   return m_parser.m_agg;
 }
 
+/*
+ * Return the parameter index of a literal, given its location in the SQL
+ * statement. Literals with the same source text share an index.
+ */
+uint
+RestSQLPreparer::Context::parameter_index(LexLocation literal)
+{
+  LexString text = LexString{literal.begin,
+                             size_t(literal.end - literal.begin)};
+  DynamicArray<LexString>& parameters = m_parser.m_parameters;
+  uint32_t hash = text.hash();
+  int found = m_parser.m_parameter_index.find(hash,
+    [&parameters, &text](uint idx) -> bool
+    {
+      return parameters[idx] == text;
+    });
+  if (found >= 0)
+  {
+    return found;
+  }
+  parameters.push(text);
+  uint idx = parameters.size() - 1;
+  m_parser.m_parameter_index.insert(hash, idx);
+  return idx;
+}
+
 ArenaAllocator*
 RestSQLPreparer::Context::get_allocator()
 {
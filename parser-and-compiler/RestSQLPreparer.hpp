@@ -27,10 +27,14 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 #include "AggregationAPICompiler.hpp"
 #include "LexString.hpp"
 #include "ArenaAllocator.hpp"
 #include "DynamicArray.hpp"
+#include "HashIndex.hpp"
+#include "PerfCounters.hpp"
+#include "SchemaCatalog.hpp"
 
 // Definitions from RestSQLLexer.l.hpp that are needed here. We can't include
 // the whole file because it would create a circular dependency.
@@ -38,6 +42,8 @@ typedef void* yyscan_t;
 typedef struct yy_buffer_state *YY_BUFFER_STATE;
 struct yy_buffer_state;
 
+class PreparedProgramCache;
+
 struct LexLocation
 {
   char* begin = NULL;
@@ -88,6 +94,12 @@ struct ConditionalExpression
       struct ConditionalExpression* arg;
     } extract;
     LexString string;
+    struct
+    {
+      int64_t packed; // See DateTime::packed
+      bool is_date;
+      bool has_fraction;
+    } datetime;
   };
 };
 
@@ -149,6 +161,7 @@ public:
     ErrState m_err_state = ErrState::NONE;
     const char* m_err_pos = NULL;
     uint m_err_len = 0;
+    bool m_utf8_validated = false;
   public:
     Context(RestSQLPreparer& parser):
       m_parser(parser)
@@ -156,6 +169,11 @@ public:
     void set_err_state(ErrState state, char* err_pos, uint err_len);
     AggregationAPICompiler* get_agg();
     ArenaAllocator* get_allocator();
+    uint parameter_index(LexLocation literal);
+    bool is_utf8_validated()
+    {
+      return m_utf8_validated;
+    }
     SelectStatement ast_root;
   };
 private:
@@ -173,22 +191,154 @@ private:
   Status m_status = Status::INITIALIZED;
   LexString m_sql = {NULL, 0};
   ArenaAllocator* m_aalloc;
+  ArenaAllocator::Stats m_arena_stats_at_start;
   Context m_context;
   DynamicArray<LexString> m_identifiers;
+  HashIndex m_identifier_index; // Name hash -> index in m_identifiers
+  DynamicArray<LexString> m_parameters; // Source text of each distinct literal
+  HashIndex m_parameter_index; // Text hash -> index in m_parameters
   yyscan_t m_scanner;
+  bool m_owns_scanner; // False if borrowed from the thread's reusable scanner
   YY_BUFFER_STATE m_buf;
   AggregationAPICompiler* m_agg = NULL;
+  const SchemaCatalog* m_catalog;
+  /*
+   * After load() with a catalog, the source word for the Load instructions of
+   * each column in m_identifiers, i.e. column type << 16 | column index in the
+   * table. See write_bytecode.
+   */
+  uint32_t* m_load_sources = NULL;
+  const PerfCounters* m_perf = NULL;
+  PerfCounters::Values* m_perf_stages = NULL;
+  bool load_schema();
+  void register_columns(struct ConditionalExpression* ce);
+  void fold_constants(struct ConditionalExpression* ce);
   int column_name_to_idx(LexString);
   LexString column_idx_to_name(int);
   bool has_width(uint pos);
 
 public:
-  RestSQLPreparer(char* sql_buffer, size_t sql_len, ArenaAllocator* aalloc);
+  /*
+   * If a schema catalog is given, load() checks that the table and columns
+   * exist, and the bytecode refers to columns by their real index and type.
+   * Otherwise, columns are numbered in order of appearance and have unknown
+   * type. The catalog must outlive the RestSQLPreparer object.
+   */
+  RestSQLPreparer(char* sql_buffer,
+                  size_t sql_len,
+                  ArenaAllocator* aalloc,
+                  const SchemaCatalog* catalog = NULL);
   bool parse();
   bool load();
   bool compile();
   bool print();
   void print(struct ConditionalExpression* ce, LexString prefix);
+  /*
+   * After compile(), write the prepared program to a caller-owned buffer of
+   * bytecode_length() words. Format:
+   *
+   *   word 0:          number of group by columns G << 16 |
+   *                    number of aggregates A
+   *   words 1 .. G:    column index of each group by column
+   *   remaining words: aggregation program as written by
+   *                    AggregationAPICompiler::write_bytecode, or three zero
+   *                    words if there is no aggregation program.
+   *
+   * With a schema catalog, column indexes are those in the table, and the
+   * source word of each Load instruction is column type << 16 | column index,
+   * where the type is a SchemaCatalog::ColumnType. This way, the interpreter
+   * can use a load specialized for the type. Without a catalog, the type is
+   * SchemaCatalog::ColumnType::Unknown, i.e. 0.
+   *
+   * Integer and string literals are numbered by their distinct source text in
+   * order of appearance, in the same way as PreparedProgramCache::normalize.
+   * The program refers to them as parameters, so bytecode written for one
+   * statement can be reused for another statement with the same normalized
+   * form by binding the literals of the latter using bind_parameters.
+   */
+  uint bytecode_length();
+  void write_bytecode(uint32_t* dest);
+  /*
+   * Number of distinct literals that parse() numbered as parameters, which
+   * matches the number of parameters PreparedProgramCache::normalize finds.
+   */
+  uint parameter_count() const;
+  /*
+   * Arena usage of this statement so far. Together with the normalized SQL from
+   * PreparedProgramCache::normalize, this gives memory usage per query shape.
+   */
+  ArenaAllocator::Stats get_arena_stats() const;
+  enum PerfStage
+  {
+    PERF_STAGE_PARSE,
+    PERF_STAGE_LOAD,
+    PERF_STAGE_COMPILE,
+    PERF_STAGE_COUNT,
+  };
+  /*
+   * Add the events counted by parse(), load() and compile() to stages[0 ..
+   * PERF_STAGE_COUNT-1]. The sums are not reset, so that one array can cover a
+   * single statement or a whole workload. The counters count the calling
+   * thread, and both pointers must outlive the RestSQLPreparer object.
+   */
+  void set_perf_counters(const PerfCounters* counters,
+                         PerfCounters::Values* stages);
+  static void print_perf(std::ostream& out,
+                         const PerfCounters& counters,
+                         const PerfCounters::Values* stages,
+                         unsigned long int statements,
+                         unsigned long int sql_bytes);
+private:
+  PerfCounters::Values* perf_stage(PerfStage stage)
+  {
+    return m_perf_stages == NULL ? NULL : &m_perf_stages[stage];
+  }
+public:
+  struct BatchStatement
+  {
+    // Input, in the same form as for the constructor
+    char* sql_buffer;
+    size_t sql_len;
+    // Output
+    bool ok;
+    std::vector<uint32_t> bytecode; // As written by write_bytecode
+  };
+  /*
+   * Parse, load and compile a number of statements, reusing one arena from the
+   * thread's pool for all of them. Return the number of statements that were
+   * prepared successfully. The performance counters, if given, are summed over
+   * the batch as described for set_perf_counters.
+   */
+  static uint prepare_batch(BatchStatement* statements,
+                            uint count,
+                            const SchemaCatalog* catalog = NULL,
+                            const PerfCounters* perf_counters = NULL,
+                            PerfCounters::Values* perf_stages = NULL);
+  /*
+   * Prepare a statement, given in the same form as for the constructor, using
+   * a cache of prepared programs. The statement is normalized and looked up
+   * under the version of the catalog, or 0 without a catalog. On a hit, the
+   * cached program is copied to `bytecode` and bound to the literals of the
+   * statement. On a miss, or if binding fails, the statement is parsed, loaded
+   * and compiled in `aalloc`, and after a miss its program is inserted into the
+   * cache. Return false if the statement can't be prepared.
+   */
+  static bool prepare_cached(char* sql_buffer,
+                             size_t sql_len,
+                             ArenaAllocator* aalloc,
+                             PreparedProgramCache* cache,
+                             std::vector<uint32_t>* bytecode,
+                             const SchemaCatalog* catalog = NULL);
+  /*
+   * Bind the literals of a statement, as numbered by
+   * PreparedProgramCache::normalize, to bytecode_len words of bytecode written
+   * by write_bytecode for a statement with the same normalized form. See
+   * AggregationAPICompiler::bind_parameters for when this fails.
+   */
+  static bool bind_parameters(uint32_t* bytecode,
+                              uint bytecode_len,
+                              const LexString* parameters,
+                              uint n_parameters);
   ~RestSQLPreparer();
 };
 
@@ -0,0 +1,180 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include <stdio.h>
+#include <assert.h>
+#include <cstring>
+#include <vector>
+#include "ArenaAllocator.hpp"
+#include "PreparedProgramCache.hpp"
+#include "RestSQLPreparer.hpp"
+#include "SchemaCatalog.hpp"
+
+// A statement in the form required by RestSQLPreparer, with two trailing NULs.
+static std::vector<char>
+sql_buffer(const char* sql)
+{
+  size_t len = strlen(sql);
+  std::vector<char> buffer(sql, sql + len);
+  buffer.push_back('\0');
+  buffer.push_back('\0');
+  return buffer;
+}
+
+// Prepare a statement on its own, using the thread's scanner if it is free.
+static bool
+prepare(const char* sql,
+        const SchemaCatalog* catalog,
+        std::vector<uint32_t>* bytecode)
+{
+  std::vector<char> buffer = sql_buffer(sql);
+  ArenaAllocator aalloc;
+  RestSQLPreparer prepare(buffer.data(), buffer.size(), &aalloc, catalog);
+  if (!(prepare.parse() && prepare.load() && prepare.compile()))
+  {
+    return false;
+  }
+  bytecode->resize(prepare.bytecode_length());
+  prepare.write_bytecode(bytecode->data());
+  return true;
+}
+
+static std::vector<uint32_t>
+prepare_uncached(const char* sql, const SchemaCatalog* catalog)
+{
+  std::vector<uint32_t> bytecode;
+  bool ok = prepare(sql, catalog, &bytecode);
+  assert(ok);
+  return bytecode;
+}
+
+static std::vector<uint32_t>
+prepare_cached(const char* sql,
+               PreparedProgramCache* cache,
+               const SchemaCatalog* catalog)
+{
+  std::vector<char> buffer = sql_buffer(sql);
+  ArenaAllocator aalloc;
+  std::vector<uint32_t> bytecode;
+  bool ok = RestSQLPreparer::prepare_cached(buffer.data(),
+                                            buffer.size(),
+                                            &aalloc,
+                                            cache,
+                                            &bytecode,
+                                            catalog);
+  assert(ok);
+  assert(bytecode == prepare_uncached(sql, catalog));
+  return bytecode;
+}
+
+static void
+assert_stats(PreparedProgramCache* cache,
+             unsigned long int hits,
+             unsigned long int misses,
+             unsigned long int insertions)
+{
+  PreparedProgramCache::Stats stats = cache->get_stats();
+  assert(stats.hits == hits);
+  assert(stats.misses == misses);
+  assert(stats.insertions == insertions);
+}
+
+int
+main(int argc, char** argv)
+{
+  const char* schema =
+    "TABLE t\n"
+    "  a BIGINT NOT NULL\n"
+    "  b BIGINT\n";
+  auto catalog = SchemaCatalog::load(schema, strlen(schema));
+  assert(catalog != NULL);
+
+  // Test that cached programs are bound to the literals of each statement and
+  // come out the same as when prepared from scratch.
+  PreparedProgramCache cache(4);
+  prepare_cached("select a, sum(b+7) from t group by a;", &cache,
+                 catalog.get());
+  assert_stats(&cache, 0, 1, 1);
+  prepare_cached("select a,\n  sum(b+7)\nfrom t group by a;", &cache,
+                 catalog.get());
+  assert_stats(&cache, 1, 1, 1);
+  prepare_cached("select a, sum(b+42) from t group by a;", &cache,
+                 catalog.get());
+  assert_stats(&cache, 2, 1, 1);
+
+  // Test that a program prepared against an older catalog is not reused.
+  auto new_catalog = SchemaCatalog::load(schema, strlen(schema));
+  assert(new_catalog->version() != catalog->version());
+  prepare_cached("select a, sum(b+42) from t group by a;", &cache,
+                 new_catalog.get());
+  assert_stats(&cache, 2, 2, 2);
+
+  // Test that a statement whose literals can't be bound to the cached program
+  // is prepared from scratch. Compiled with 0, the literal shares its constant
+  // with the fixed 0 of the negation, so the program can't take a 5.
+  prepare_cached("select sum(b+0), sum(-b) from t;", &cache,
+                 new_catalog.get());
+  assert_stats(&cache, 2, 3, 3);
+  {
+    std::string normalized;
+    std::vector<LexString> parameters;
+    const char* sql = "select sum(b+5), sum(-b) from t;";
+    bool ok = PreparedProgramCache::normalize(LexString{sql, strlen(sql)},
+                                              &normalized,
+                                              &parameters);
+    assert(ok);
+    PreparedProgramCache::Bytecode program =
+      *cache.lookup(normalized, new_catalog->version());
+    assert(!RestSQLPreparer::bind_parameters(program.data(),
+                                             program.size(),
+                                             parameters.data(),
+                                             parameters.size()));
+  }
+  assert_stats(&cache, 3, 3, 3);
+  prepare_cached("select sum(b+5), sum(-b) from t;", &cache,
+                 new_catalog.get());
+  assert_stats(&cache, 4, 3, 3);
+  prepare_cached("select sum(b+0), sum(-b) from t;", &cache,
+                 new_catalog.get());
+  assert_stats(&cache, 5, 3, 3);
+
+  // Test that the thread's scanner starts each statement in the initial start
+  // condition, also after the previous statement stopped inside a quoted
+  // string. The first of these has valid UTF-8 and uses the rules for
+  // validated input, the second has an illegal byte and uses the detailed
+  // rules. Both print a syntax error.
+  const char* next = "select a, sum(b) from t where b = 'x' group by a;";
+  std::vector<uint32_t> expected = prepare_uncached(next, catalog.get());
+  std::vector<uint32_t> bytecode;
+  assert(!prepare("select a from t where b = 'x", catalog.get(), &bytecode));
+  assert(prepare(next, catalog.get(), &bytecode));
+  assert(bytecode == expected);
+  assert(!prepare("select a from t where b = 'x\377y'", catalog.get(),
+                  &bytecode));
+  assert(prepare(next, catalog.get(), &bytecode));
+  assert(bytecode == expected);
+
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,322 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include <assert.h>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <strings.h>
+#include "SchemaCatalog.hpp"
+using std::cerr;
+using std::endl;
+
+static std::atomic<uint64_t> last_version(0);
+
+std::shared_ptr<const SchemaCatalog>
+SchemaCatalog::load_file(const char* path)
+{
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (!file)
+  {
+    cerr << "Cannot open schema file " << path << endl;
+    return NULL;
+  }
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  std::shared_ptr<SchemaCatalog> catalog(new SchemaCatalog());
+  catalog->m_text = contents.str();
+  if (!catalog->parse(path))
+  {
+    return NULL;
+  }
+  return catalog;
+}
+
+std::shared_ptr<const SchemaCatalog>
+SchemaCatalog::load(const char* text, size_t len)
+{
+  std::shared_ptr<SchemaCatalog> catalog(new SchemaCatalog());
+  catalog->m_text.assign(text, len);
+  if (!catalog->parse("<schema text>"))
+  {
+    return NULL;
+  }
+  return catalog;
+}
+
+static bool
+is_space(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Split a line into words. A parenthesized width becomes a word of its own.
+static void
+split_words(const char* s, size_t len, std::vector<LexString>* words)
+{
+  words->clear();
+  size_t pos = 0;
+  while (pos < len)
+  {
+    if (is_space(s[pos]))
+    {
+      pos++;
+      continue;
+    }
+    if (s[pos] == '#')
+    {
+      return;
+    }
+    size_t end = pos + 1;
+    if (s[pos] != '(' && s[pos] != ')')
+    {
+      while (end < len &&
+             !is_space(s[end]) &&
+             s[end] != '#' &&
+             s[end] != '(' &&
+             s[end] != ')')
+      {
+        end++;
+      }
+    }
+    words->push_back(LexString{&s[pos], end - pos});
+    pos = end;
+  }
+}
+
+static bool
+is_keyword(LexString word, const char* keyword)
+{
+  return word.len == strlen(keyword) &&
+    strncasecmp(word.str, keyword, word.len) == 0;
+}
+
+static const struct
+{
+  const char* name;
+  SchemaCatalog::ColumnType type;
+  uint width;
+} fixed_width_types[] =
+{
+  { "TINYINT", SchemaCatalog::ColumnType::TinyInt, 1 },
+  { "SMALLINT", SchemaCatalog::ColumnType::SmallInt, 2 },
+  { "MEDIUMINT", SchemaCatalog::ColumnType::MediumInt, 3 },
+  { "INT", SchemaCatalog::ColumnType::Int, 4 },
+  { "BIGINT", SchemaCatalog::ColumnType::BigInt, 8 },
+  { "FLOAT", SchemaCatalog::ColumnType::Float, 4 },
+  { "DOUBLE", SchemaCatalog::ColumnType::Double, 8 },
+};
+
+bool
+SchemaCatalog::parse(const char* path)
+{
+  std::vector<LexString> words;
+  const char* s = m_text.c_str();
+  size_t len = m_text.size();
+  size_t line_start = 0;
+  uint line_number = 0;
+  Table* table = NULL;
+  while (line_start < len)
+  {
+    line_number++;
+    size_t line_end = line_start;
+    while (line_end < len && s[line_end] != '\n')
+    {
+      line_end++;
+    }
+    split_words(&s[line_start], line_end - line_start, &words);
+    line_start = line_end + 1;
+    if (words.empty())
+    {
+      continue;
+    }
+#define FAIL(MSG) do \
+    { \
+      cerr << path << ":" << line_number << ": " << MSG << endl; \
+      return false; \
+    } while (0)
+    if (is_keyword(words[0], "TABLE"))
+    {
+      if (words.size() != 2)
+      {
+        FAIL("Expected TABLE <table name>");
+      }
+      if (m_table_index.count(words[1]) != 0)
+      {
+        FAIL("Duplicate table " << words[1]);
+      }
+      m_table_index[words[1]] = m_tables.size();
+      m_tables.push_back(Table());
+      table = &m_tables.back();
+      table->name = words[1];
+      continue;
+    }
+    if (table == NULL)
+    {
+      FAIL("Column declared before the first TABLE");
+    }
+    if (words.size() < 2)
+    {
+      FAIL("Expected <column name> <type>");
+    }
+    Column column;
+    column.name = words[0];
+    column.idx = table->m_columns.size();
+    column.type = ColumnType::Unknown;
+    column.is_unsigned = false;
+    column.nullable = true;
+    column.width = 0;
+    uint next = 2;
+    for (const auto& fixed : fixed_width_types)
+    {
+      if (is_keyword(words[1], fixed.name))
+      {
+        column.type = fixed.type;
+        column.width = fixed.width;
+      }
+    }
+    if (is_keyword(words[1], "VARCHAR"))
+    {
+      if (words.size() < 5 ||
+          !is_keyword(words[2], "(") ||
+          !is_keyword(words[4], ")"))
+      {
+        FAIL("Expected VARCHAR(<width>)");
+      }
+      uint width = 0;
+      for (size_t i = 0; i < words[3].len; i++)
+      {
+        char c = words[3].str[i];
+        if (c < '0' || c > '9' || width > 0xffff)
+        {
+          FAIL("Invalid VARCHAR width " << words[3]);
+        }
+        width = width * 10 + (c - '0');
+      }
+      column.type = ColumnType::Varchar;
+      column.width = width;
+      next = 5;
+    }
+    if (column.type == ColumnType::Unknown)
+    {
+      FAIL("Unknown column type " << words[1]);
+    }
+    if (next < words.size() &&
+        is_keyword(words[next], "UNSIGNED") &&
+        column.type != ColumnType::Varchar)
+    {
+      column.is_unsigned = true;
+      next++;
+    }
+    if (next < words.size() && is_keyword(words[next], "NULL"))
+    {
+      next++;
+    }
+    else if (next + 1 < words.size() &&
+             is_keyword(words[next], "NOT") &&
+             is_keyword(words[next + 1], "NULL"))
+    {
+      column.nullable = false;
+      next += 2;
+    }
+    if (next != words.size())
+    {
+      FAIL("Unexpected " << words[next]);
+    }
+    if (table->m_column_index.count(column.name) != 0)
+    {
+      FAIL("Duplicate column " << column.name << " in table " << table->name);
+    }
+    if (column.idx > 0xffff)
+    {
+      FAIL("Too many columns in table " << table->name);
+    }
+    table->m_column_index[column.name] = column.idx;
+    table->m_columns.push_back(column);
+#undef FAIL
+  }
+  m_version = ++last_version;
+  return true;
+}
+
+const SchemaCatalog::Table*
+SchemaCatalog::find_table(LexString name) const
+{
+  auto it = m_table_index.find(name);
+  if (it == m_table_index.end())
+  {
+    return NULL;
+  }
+  return &m_tables[it->second];
+}
+
+uint64_t
+SchemaCatalog::version() const
+{
+  return m_version;
+}
+
+const char*
+SchemaCatalog::type_name(ColumnType type)
+{
+  switch (type)
+  {
+  case ColumnType::Unknown: return "UNKNOWN";
+  case ColumnType::TinyInt: return "TINYINT";
+  case ColumnType::SmallInt: return "SMALLINT";
+  case ColumnType::MediumInt: return "MEDIUMINT";
+  case ColumnType::Int: return "INT";
+  case ColumnType::BigInt: return "BIGINT";
+  case ColumnType::Float: return "FLOAT";
+  case ColumnType::Double: return "DOUBLE";
+  case ColumnType::Varchar: return "VARCHAR";
+  default: assert(false);
+  }
+  return NULL;
+}
+
+const SchemaCatalog::Column*
+SchemaCatalog::Table::find_column(LexString name) const
+{
+  auto it = m_column_index.find(name);
+  if (it == m_column_index.end())
+  {
+    return NULL;
+  }
+  return &m_columns[it->second];
+}
+
+uint
+SchemaCatalog::Table::number_of_columns() const
+{
+  return m_columns.size();
+}
+
+const SchemaCatalog::Column&
+SchemaCatalog::Table::column(uint idx) const
+{
+  assert(idx < m_columns.size());
+  return m_columns[idx];
+}
@@ -0,0 +1,115 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#ifndef SchemaCatalog_hpp_included
+#define SchemaCatalog_hpp_included 1
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "LexString.hpp"
+
+/*
+ * In-process catalog of table schemas, used by RestSQLPreparer::load to check
+ * that the table and columns of a statement exist, to map column names to
+ * their real indexes and to choose type-specialized column loads.
+ *
+ * A catalog is immutable once loaded, so any number of threads can look up
+ * tables and columns in it without locking. To pick up schema changes, load a
+ * new catalog and swap the shared pointer. Every catalog gets a version number
+ * that is unique within the process, suitable as the schema version in
+ * PreparedProgramCache so that programs prepared against an older catalog are
+ * not reused.
+ *
+ * Schema file format, one declaration per line:
+ *
+ *   # Comment
+ *   TABLE <table name>
+ *   <column name> <type> [UNSIGNED] [NULL | NOT NULL]
+ *
+ * where <type> is one of TINYINT, SMALLINT, MEDIUMINT, INT, BIGINT, FLOAT,
+ * DOUBLE or VARCHAR(<width>). Keywords are case-insensitive, while table and
+ * column names are compared byte by byte like elsewhere in the preparer.
+ * Columns are nullable unless declared NOT NULL, and are numbered from 0 in
+ * order of declaration within their table.
+ */
+class SchemaCatalog
+{
+public:
+  enum class ColumnType : uint8_t
+  {
+    Unknown = 0, // Used for columns not resolved through a catalog
+    TinyInt,
+    SmallInt,
+    MediumInt,
+    Int,
+    BigInt,
+    Float,
+    Double,
+    Varchar,
+  };
+  struct Column
+  {
+    LexString name;
+    uint idx;
+    ColumnType type;
+    bool is_unsigned;
+    bool nullable;
+    uint width; // Size in bytes, or maximum length for VARCHAR
+  };
+  class Table
+  {
+    friend class SchemaCatalog;
+  public:
+    LexString name;
+    const Column* find_column(LexString name) const;
+    uint number_of_columns() const;
+    const Column& column(uint idx) const;
+  private:
+    std::vector<Column> m_columns;
+    std::unordered_map<LexString, uint, LexStringHash> m_column_index;
+  };
+  /*
+   * Parse a schema file, or schema text, into a new catalog. On error, print
+   * a message to stderr and return an empty pointer.
+   */
+  static std::shared_ptr<const SchemaCatalog> load_file(const char* path);
+  static std::shared_ptr<const SchemaCatalog> load(const char* text,
+                                                   size_t len);
+  const Table* find_table(LexString name) const;
+  uint64_t version() const;
+  static const char* type_name(ColumnType type);
+private:
+  SchemaCatalog() = default;
+  bool parse(const char* path);
+  uint64_t m_version = 0;
+  std::string m_text; // All names point into this
+  std::vector<Table> m_tables;
+  std::unordered_map<LexString, uint, LexStringHash> m_table_index;
+};
+
+#endif
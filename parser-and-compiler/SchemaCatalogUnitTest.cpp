@@ -0,0 +1,118 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include <stdio.h>
+#include <assert.h>
+#include <cstring>
+#include "SchemaCatalog.hpp"
+
+static std::shared_ptr<const SchemaCatalog>
+load(const char* text)
+{
+  return SchemaCatalog::load(text, strlen(text));
+}
+
+static LexString
+ls(const char* str)
+{
+  return LexString{str, strlen(str)};
+}
+
+int
+main(int argc, char** argv)
+{
+  auto catalog = load(
+    "# TPC-H\n"
+    "TABLE lineitem\n"
+    "  l_orderkey BIGINT NOT NULL\n"
+    "  l_linenumber int unsigned not null # Comment\n"
+    "  l_quantity DOUBLE NULL\n"
+    "  l_comment VARCHAR(44)\n"
+    "\n"
+    "table nation\r\n"
+    "  n_nationkey INT NOT NULL\r\n"
+    "  n_name VARCHAR (25) NOT NULL\r\n");
+  assert(catalog != NULL);
+  assert(catalog->find_table(ls("orders")) == NULL);
+  assert(catalog->find_table(ls("LINEITEM")) == NULL);
+  const SchemaCatalog::Table* lineitem = catalog->find_table(ls("lineitem"));
+  assert(lineitem != NULL);
+  assert(lineitem->name == ls("lineitem"));
+  assert(lineitem->number_of_columns() == 4);
+  const SchemaCatalog::Column* col = lineitem->find_column(ls("l_linenumber"));
+  assert(col != NULL);
+  assert(col == &lineitem->column(1));
+  assert(col->idx == 1);
+  assert(col->type == SchemaCatalog::ColumnType::Int);
+  assert(col->is_unsigned && !col->nullable && col->width == 4);
+  col = lineitem->find_column(ls("l_quantity"));
+  assert(col->type == SchemaCatalog::ColumnType::Double);
+  assert(!col->is_unsigned && col->nullable && col->width == 8);
+  col = lineitem->find_column(ls("l_comment"));
+  assert(col->idx == 3);
+  assert(col->type == SchemaCatalog::ColumnType::Varchar);
+  assert(col->nullable && col->width == 44);
+  assert(lineitem->find_column(ls("n_name")) == NULL);
+  const SchemaCatalog::Table* nation = catalog->find_table(ls("nation"));
+  assert(nation != NULL);
+  col = nation->find_column(ls("n_name"));
+  assert(col->idx == 1);
+  assert(col->type == SchemaCatalog::ColumnType::Varchar);
+  assert(!col->nullable && col->width == 25);
+
+  // Test that every catalog gets a new version.
+  auto catalog2 = load("TABLE t\n  a INT\n");
+  assert(catalog2 != NULL);
+  assert(catalog2->version() > catalog->version());
+
+  // Test a wide table
+  std::string wide = "TABLE wide\n";
+  for (int i = 0; i < 1000; i++)
+  {
+    wide += "c" + std::to_string(i) + " BIGINT\n";
+  }
+  catalog2 = load(wide.c_str());
+  assert(catalog2 != NULL);
+  const SchemaCatalog::Table* table = catalog2->find_table(ls("wide"));
+  assert(table->number_of_columns() == 1000);
+  for (int i = 0; i < 1000; i++)
+  {
+    std::string name = "c" + std::to_string(i);
+    col = table->find_column(LexString{name.c_str(), name.size()});
+    assert(col != NULL && col->idx == uint(i));
+  }
+
+  // Test errors. They are printed to stderr.
+  assert(load("a INT\n") == NULL);
+  assert(load("TABLE t\n  a INTEGER\n") == NULL);
+  assert(load("TABLE t\n  a VARCHAR\n") == NULL);
+  assert(load("TABLE t\n  a VARCHAR(x)\n") == NULL);
+  assert(load("TABLE t\n  a INT NOT\n") == NULL);
+  assert(load("TABLE t\n  a INT\n  a BIGINT\n") == NULL);
+  assert(load("TABLE t\nTABLE t\n") == NULL);
+  assert(load("TABLE\n") == NULL);
+  assert(SchemaCatalog::load_file("/nonexistent/schema") == NULL);
+  printf("OK\n");
+  return 0;
+}
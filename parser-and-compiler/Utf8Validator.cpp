@@ -0,0 +1,145 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include <cstdint>
+#include <cstring>
+#include "Utf8Validator.hpp"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Validate the multi-byte sequence starting with the non-ASCII byte at s[0].
+ * Return its length, or 0 if it is invalid. The ranges are the same as for
+ * U_2, U_3_LOW, U_3_HIGH and U_4 in RestSQLLexer.l.
+ */
+static inline size_t
+validate_sequence(const uint8_t* s, size_t remaining)
+{
+  uint8_t lead = s[0];
+  size_t len;
+  uint8_t min2 = 0x80; // Allowed range for the second byte
+  uint8_t max2 = 0xbf;
+  if (lead < 0xc2)
+  {
+    // Continuation byte, or lead byte of an overlong 2-byte sequence
+    return 0;
+  }
+  else if (lead < 0xe0)
+  {
+    len = 2;
+  }
+  else if (lead < 0xf0)
+  {
+    len = 3;
+    if (lead == 0xe0)
+    {
+      min2 = 0xa0; // Overlong below this
+    }
+    else if (lead == 0xed)
+    {
+      max2 = 0x9f; // Surrogates above this
+    }
+  }
+  else if (lead < 0xf5)
+  {
+    len = 4;
+    if (lead == 0xf0)
+    {
+      min2 = 0x90; // Overlong below this
+    }
+    else if (lead == 0xf4)
+    {
+      max2 = 0x8f; // Above U+10FFFF above this
+    }
+  }
+  else
+  {
+    // Above U+10FFFF, or illegal byte
+    return 0;
+  }
+  if (remaining < len || s[1] < min2 || s[1] > max2)
+  {
+    return 0;
+  }
+  for (size_t i = 2; i < len; i++)
+  {
+    if ((s[i] & 0xc0) != 0x80)
+    {
+      return 0;
+    }
+  }
+  return len;
+}
+
+bool
+utf8_is_valid(const char* buf, size_t len)
+{
+  const uint8_t* s = reinterpret_cast<const uint8_t*>(buf);
+  size_t pos = 0;
+  while (pos < len)
+  {
+#ifdef __SSE2__
+    while (pos + 16 <= len)
+    {
+      __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&s[pos]));
+      int non_ascii = _mm_movemask_epi8(chunk);
+      if (non_ascii != 0)
+      {
+        pos += __builtin_ctz(non_ascii);
+        break;
+      }
+      pos += 16;
+    }
+#else
+    while (pos + 8 <= len)
+    {
+      uint64_t chunk;
+      memcpy(&chunk, &s[pos], 8);
+      if ((chunk & 0x8080808080808080ULL) != 0)
+      {
+        break;
+      }
+      pos += 8;
+    }
+#endif
+    if (pos >= len)
+    {
+      break;
+    }
+    if (s[pos] < 0x80)
+    {
+      pos++;
+      continue;
+    }
+    size_t seq_len = validate_sequence(&s[pos], len - pos);
+    if (seq_len == 0)
+    {
+      return false;
+    }
+    pos += seq_len;
+  }
+  return true;
+}
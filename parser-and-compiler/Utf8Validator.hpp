@@ -0,0 +1,41 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#ifndef Utf8Validator_hpp_included
+#define Utf8Validator_hpp_included 1
+
+#include <cstddef>
+
+/*
+ * Return true if the buffer is valid UTF-8 in the same sense as in
+ * RestSQLLexer.l, i.e. it contains no illegal bytes, no incomplete or overlong
+ * sequences, no surrogates and nothing above U+10FFFF. NUL bytes are valid.
+ *
+ * Runs of ASCII are skipped 16 bytes at a time using SSE2 where available, and
+ * 8 bytes at a time otherwise, so that the cost for typical SQL is close to
+ * that of reading the buffer once.
+ */
+bool utf8_is_valid(const char* buf, size_t len);
+
+#endif
@@ -0,0 +1,134 @@
+/*
+   Copyright (c) 2024, 2024, Hopsworks and/or its affiliates.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License, version 2.0,
+   as published by the Free Software Foundation.
+
+   This program is also distributed with certain software (including
+   but not limited to OpenSSL) that is licensed under separate terms,
+   as designated in a particular file or component or in included license
+   documentation.  The authors of MySQL hereby grant you an additional
+   permission to link the program and your derivative works with the
+   separately licensed software that they have included with MySQL.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License, version 2.0, for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include <stdio.h>
+#include <assert.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "Utf8Validator.hpp"
+
+/*
+ * Reference implementation: decode code points and check the decoded value
+ * rather than the byte ranges.
+ */
+static bool
+reference_is_valid(const uint8_t* s, size_t len)
+{
+  size_t pos = 0;
+  while (pos < len)
+  {
+    uint8_t lead = s[pos];
+    size_t seq_len;
+    uint32_t cp;
+    uint32_t min_cp;
+    if (lead < 0x80) { seq_len = 1; cp = lead; min_cp = 0; }
+    else if ((lead & 0xe0) == 0xc0) { seq_len = 2; cp = lead & 0x1f; min_cp = 0x80; }
+    else if ((lead & 0xf0) == 0xe0) { seq_len = 3; cp = lead & 0x0f; min_cp = 0x800; }
+    else if ((lead & 0xf8) == 0xf0) { seq_len = 4; cp = lead & 0x07; min_cp = 0x10000; }
+    else return false;
+    if (pos + seq_len > len) return false;
+    for (size_t i = 1; i < seq_len; i++)
+    {
+      if ((s[pos + i] & 0xc0) != 0x80) return false;
+      cp = (cp << 6) | (s[pos + i] & 0x3f);
+    }
+    if (cp < min_cp) return false;
+    if (0xd800 <= cp && cp <= 0xdfff) return false;
+    if (cp > 0x10ffff) return false;
+    pos += seq_len;
+  }
+  return true;
+}
+
+// Check a byte sequence on its own and embedded at various offsets in ASCII.
+static void
+check(const uint8_t* seq, size_t len)
+{
+  bool expected = reference_is_valid(seq, len);
+  assert(utf8_is_valid((const char*)seq, len) == expected);
+  static const size_t offsets[] = { 1, 15, 16, 17, 30 };
+  for (size_t offset : offsets)
+  {
+    std::string buf(offset, 'a');
+    buf.append((const char*)seq, len);
+    buf.append(offset, 'b');
+    assert(utf8_is_valid(buf.data(), buf.size()) == expected);
+    assert(utf8_is_valid(buf.data(), offset + len) == expected);
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  assert(utf8_is_valid("", 0));
+  assert(utf8_is_valid("select a from tbl;\0x", 20));
+  // All sequences of up to three bytes
+  uint8_t seq[4];
+  uint valid_count = 0;
+  for (uint32_t i = 0; i < 0x1000000; i++)
+  {
+    seq[0] = i >> 16;
+    seq[1] = i >> 8;
+    seq[2] = i;
+    bool valid = utf8_is_valid((const char*)seq, 3);
+    assert(valid == reference_is_valid(seq, 3));
+    valid_count += valid;
+    if (i < 0x10000)
+    {
+      seq[0] = i >> 8;
+      seq[1] = i;
+      check(seq, 2);
+    }
+  }
+  assert(valid_count > 0);
+  // Four-byte sequences with every lead byte from 0xf0 and every second byte,
+  // and a sample of third and fourth bytes
+  static const uint8_t tails[] = { 0x00, 0x7f, 0x80, 0xa5, 0xbf, 0xc0, 0xff };
+  for (uint lead = 0xe0; lead <= 0xff; lead++)
+  {
+    for (uint second = 0; second <= 0xff; second++)
+    {
+      for (uint8_t third : tails)
+      {
+        for (uint8_t fourth : tails)
+        {
+          seq[0] = lead;
+          seq[1] = second;
+          seq[2] = third;
+          seq[3] = fourth;
+          check(seq, 4);
+          check(seq, 3);
+        }
+      }
+    }
+  }
+  // The largest code point, and the smallest one above it
+  const uint8_t max_cp[] = { 0xf4, 0x8f, 0xbf, 0xbf };
+  const uint8_t too_high[] = { 0xf4, 0x90, 0x80, 0x80 };
+  assert(utf8_is_valid((const char*)max_cp, 4));
+  assert(!utf8_is_valid((const char*)too_high, 4));
+  printf("OK\n");
+  return 0;
+}
@@ -51,7 +51,14 @@ trap 'rm -f $tmpfile' EXIT
 
 # Unit tests
 
+runtest "Arena allocator unit test" ./ArenaAllocatorUnitTest
+runtest "Date and time unit test" ./DateTimeUnitTest
 runtest "Keywords unit test" ./KeywordsUnitTest
+runtest "Performance counters unit test" ./PerfCountersUnitTest
+runtest "Prepared program cache unit test" ./PreparedProgramCacheUnitTest
+runtest "Preparer unit test" ./RestSQLPreparerUnitTest
+runtest "Schema catalog unit test" ./SchemaCatalogUnitTest
+runtest "UTF-8 validator unit test" ./Utf8ValidatorUnitTest
 
 # Test errors
 
@@ -72,6 +79,7 @@ runtest "Surrogate (U+dead)" ./ParseCompileTest $'select `a\xed\xba\xad` from tb
 # U+ffff < U+204d7 = 𠓗 = 11110000 10100000 10010011 10010111 = f0 a0 93 97
 runtest "Non-BMP UTF-8 in identifier" ./ParseCompileTest $'select `a\xf0\xa0\x93\x97` from tbl;'
 runtest "Unimplemented keyword used as unquoted identifier" ./ParseCompileTest $'select zone from tbl;'
+runtest "Unimplemented keyword in mixed case" ./ParseCompileTest $'select a from tbl LiMiT 1;'
 runtest "Incomplete escape sequence in single-quoted string" ./ParseCompileTest $'select a from tbl where \x27hello\x5c'
 runtest "Unexpected EOI in single-quoted string" ./ParseCompileTest $'select a from tbl where \x27hello'
 runtest "Illegal token" ./ParseCompileTest 'select #a from tbl;'
@@ -92,6 +100,10 @@ runtest "UTF-8 4-byte sequence with illegal 4th byte" ./ParseCompileTest $'selec
 runtest "UTF-8 4-byte sequence at EOI with 2nd byte missing" ./ParseCompileTest $'select `a` from `table\xf0'
 runtest "UTF-8 4-byte sequence at EOI with 3rd byte missing" ./ParseCompileTest $'select `a` from `table\xf0\xa0'
 runtest "UTF-8 4-byte sequence at EOI with 4th byte missing" ./ParseCompileTest $'select `a` from `table\xf0\xa0\x93'
+# ä = U+00e4 = c3 a4. A backslash escapes only the first byte of it, with the
+# same error whether the input passed the bulk UTF-8 validation or not.
+runtest "Escaped UTF-8 character in single-quoted string" ./ParseCompileTest $'select a from tbl where \x27r\\\xc3\xa4k\x27 = b;'
+runtest "Escaped UTF-8 character in single-quoted string, invalid UTF-8 later" ./ParseCompileTest $'select a from tbl where \x27r\\\xc3\xa4k\x27 = b\xff;'
 runtest "Rogue UTF-8 continuation byte" ./ParseCompileTest $'select a\x89 from tbl;'
 runtest "Empty input" ./ParseCompileTest ''
 runtest "Invalid token at beginning" ./ParseCompileTest $'\033select a from tbl;'
@@ -214,14 +226,23 @@ runtest "Single quoted strings" ./ParseCompileTest "$(cat "$tmpfile")"
 runtest "Compound strings" ./ParseCompileTest "
 select col from tbl where 'hello'
   ' world';"
+runtest "UTF-8 in single-quoted string" ./ParseCompileTest $'select col from tbl where \x27r\xc3\xa4ksm\xc3\xb6rg\xc3\xa5s \xe1\x9a\xb1 \xf0\xa0\x93\x97\x27 is not null;'
 runtest "date_add" ./ParseCompileTest $'select col from tbl where date_add(col1, interval 1 day) is not null;'
 runtest "date_sub" ./ParseCompileTest $'select col from tbl where date_add(\x272024-05-06\x27, interval 23 microsecond) > col2;'
 runtest "extract" ./ParseCompileTest $'select col from tbl where extract(year from \x272024-05-06\x27) <= col2;'
+runtest "Folded date arithmetic" ./ParseCompileTest $'
+select col from tbl
+where col1 >= date_add(\x272024-01-31\x27, interval 1 month)
+  and col2 < date_sub(\x272024-03-01 00:00:00\x27, interval \x271 2\x27 day_hour)
+  and col3 = extract(day from date_sub(\x272024-03-01\x27, interval 1 day))
+  and col4 = date_add(\x272024-02-30\x27, interval 1 day)
+  and col5 = date_add(col6, interval 1 day);'
 runtest "order by" ./ParseCompileTest $'select col1 from tbl order by col1;'
 runtest "order by 2 columns" ./ParseCompileTest $'select col1 from tbl order by col1, col2;'
 runtest "group and order by" ./ParseCompileTest $'select col1, `col #2`, max(col3) from tbl group by col1, `col #2` order by col1, `col #2`;'
 runtest "order by ASC/DESC" ./ParseCompileTest $'select col1 from tbl order by col1, col2 ASC, col3 DESC, col4;'
 runtest "Unimplemented keyword used as quoted identifier" ./ParseCompileTest $'select `zone` from tbl;'
+runtest "Keywords in mixed case and keyword-like identifiers" ./ParseCompileTest $'SeLeCt selects, sel, CoUnT(minute_microseconds) FROM tbl GrOuP bY selects, sel;'
 runtest "Negation" ./ParseCompileTest $'
 select col1
       ,min(-543)
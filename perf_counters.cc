@@ -0,0 +1,136 @@
+/*
+ * Copyright [2024] <Copyright Hopsworks AB>
+ *
+ * Author: Zhao Song
+ */
+#include "perf_counters.h"
+#include "perf_events.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__linux__)
+static const struct {
+  uint32_t type;
+  uint64_t config;
+} kEvents[] = {
+  PERF_EVENTS(PERF_EVENT_ATTR)
+};
+static_assert(sizeof(kEvents) / sizeof(kEvents[0]) == kPerfEventTotal,
+              "PerfEvent does not match PERF_EVENTS");
+#endif
+
+PerfCounters::PerfCounters() {
+  for (uint32_t i = 0; i < kPerfEventTotal; i++) {
+    fds_[i] = -1;
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  for (uint32_t i = 0; i < kPerfEventTotal; i++) {
+    if (fds_[i] >= 0) {
+      close(fds_[i]);
+    }
+  }
+}
+
+bool PerfCounters::Open() {
+  bool opened = false;
+#if defined(__linux__)
+  for (uint32_t i = 0; i < kPerfEventTotal; i++) {
+    if (fds_[i] >= 0) {
+      opened = true;
+      continue;
+    }
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = kEvents[i].type;
+    attr.config = kEvents[i].config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // The calling thread on any CPU
+    fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+                                       0));
+    opened |= fds_[i] >= 0;
+  }
+#endif
+  return opened;
+}
+
+void PerfCounters::Read(PerfValues* values) const {
+  for (uint32_t i = 0; i < kPerfEventTotal; i++) {
+    values->value[i] = 0;
+    if (fds_[i] < 0) {
+      continue;
+    }
+    // value, time enabled, time running
+    uint64_t buf[3];
+    if (read(fds_[i], buf, sizeof(buf)) != sizeof(buf) || buf[2] == 0) {
+      continue;
+    }
+    values->value[i] = buf[2] < buf[1] ?
+      static_cast<uint64_t>(static_cast<double>(buf[0]) * buf[1] / buf[2]) :
+      buf[0];
+  }
+}
+
+const char* PerfCounters::EventName(PerfEvent event) {
+  static const char* names[] = {
+    PERF_EVENTS(PERF_EVENT_NAME)
+  };
+  static_assert(sizeof(names) / sizeof(names[0]) == kPerfEventTotal,
+                "PerfEvent does not match PERF_EVENTS");
+  return names[event];
+}
+
+static double Ratio(uint64_t a, uint64_t b) {
+  return b ? static_cast<double>(a) / b : 0.0;
+}
+
+void PerfCounters::Print(const PerfValues& values, uint64_t rows,
+                         const char* indent) const {
+  bool any = false;
+  for (uint32_t i = 0; i < kPerfEventTotal; i++) {
+    PerfEvent event = static_cast<PerfEvent>(i);
+    if (!available(event)) {
+      continue;
+    }
+    any = true;
+    uint64_t v = values.value[i];
+    printf("%s%-17s %14lu  %10.2f/row", indent, EventName(event), v,
+           Ratio(v, rows));
+    switch (event) {
+      case kPerfInstructions:
+        if (available(kPerfCycles)) {
+          printf("  %.2f IPC", Ratio(v, values.value[kPerfCycles]));
+        }
+        break;
+      case kPerfBranchMisses:
+        if (available(kPerfBranches)) {
+          printf("  %.2f%% of branches",
+                 100 * Ratio(v, values.value[kPerfBranches]));
+        }
+        break;
+      case kPerfCacheMisses:
+        if (available(kPerfCacheReferences)) {
+          printf("  %.2f%% of references",
+                 100 * Ratio(v, values.value[kPerfCacheReferences]));
+        }
+        break;
+      default:
+        break;
+    }
+    printf("\n");
+  }
+  if (!any) {
+    printf("%sNo performance counters are available\n", indent);
+  }
+}
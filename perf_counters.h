@@ -0,0 +1,85 @@
+/*
+ * Copyright [2024] <Copyright Hopsworks AB>
+ *
+ * Author: Zhao Song
+ */
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include <cstdint>
+
+// In the order of PERF_EVENTS, see perf_events.h
+enum PerfEvent {
+  kPerfTaskClock = 0,     // Nanoseconds on the CPU
+  kPerfPageFaults,
+  kPerfCycles,
+  kPerfInstructions,
+  kPerfBranches,
+  kPerfBranchMisses,
+  kPerfCacheReferences,   // Last level cache
+  kPerfCacheMisses,
+  kPerfL1dReadMisses,
+  kPerfEventTotal
+};
+
+struct PerfValues {
+  uint64_t value[kPerfEventTotal];
+
+  PerfValues() {
+    for (uint32_t i = 0; i < kPerfEventTotal; i++) {
+      value[i] = 0;
+    }
+  }
+  PerfValues& operator+=(const PerfValues& other) {
+    for (uint32_t i = 0; i < kPerfEventTotal; i++) {
+      value[i] += other.value[i];
+    }
+    return *this;
+  }
+  PerfValues operator-(const PerfValues& other) const {
+    PerfValues res;
+    for (uint32_t i = 0; i < kPerfEventTotal; i++) {
+      res.value[i] = value[i] >= other.value[i] ? value[i] - other.value[i] : 0;
+    }
+    return res;
+  }
+};
+
+/*
+ * Counters of the calling thread in user space, opened with Linux
+ * perf_event_open. The counters run from Open() on, and the cost of a piece
+ * of work is the difference between a Read() before and one after it, so a
+ * reading should cover many rows rather than one.
+ *
+ * Events the CPU or the kernel doesn't provide, e.g. hardware events in most
+ * virtual machines, are not available and read as 0. When the kernel
+ * multiplexes more events than the CPU has counters, the values are scaled
+ * by the fraction of time each event was counted.
+ */
+class PerfCounters {
+ public:
+  PerfCounters();
+  ~PerfCounters();
+  /*
+   * Open the counters. Return false if none of the events is available,
+   * e.g. because of /proc/sys/kernel/perf_event_paranoid.
+   */
+  bool Open();
+  bool available(PerfEvent event) const {
+    return fds_[event] >= 0;
+  }
+  void Read(PerfValues* values) const;
+
+  static const char* EventName(PerfEvent event);
+  /*
+   * Print the values, per row and as rates such as instructions per cycle
+   * and miss ratios, one event per line with the given indent.
+   */
+  void Print(const PerfValues& values, uint64_t rows,
+             const char* indent) const;
+
+ private:
+  int fds_[kPerfEventTotal];
+};
+
+#endif  // PERF_COUNTERS_H_
@@ -0,0 +1,38 @@
+/*
+ * Copyright [2024] <Copyright Hopsworks AB>
+ *
+ * Author: Zhao Song
+ */
+#ifndef PERF_EVENTS_H_
+#define PERF_EVENTS_H_
+
+/*
+ * The events counted by PerfCounters, here and in parser-and-compiler, in
+ * the order of their enums:
+ *
+ *   EVENT(name, type, config)
+ *
+ * with the name perf(1) gives the event and the type and config of its
+ * struct perf_event_attr. Both builds expand this one list into their
+ * names and attributes, so that they count the same events. type and
+ * config are only used where <linux/perf_event.h> is included.
+ */
+#define PERF_EVENTS(EVENT)                                                   \
+  EVENT("task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK)          \
+  EVENT("page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS)        \
+  EVENT("cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES)              \
+  EVENT("instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS)      \
+  EVENT("branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS)   \
+  EVENT("branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES)    \
+  EVENT("cache-references", PERF_TYPE_HARDWARE,                              \
+        PERF_COUNT_HW_CACHE_REFERENCES)                                      \
+  EVENT("cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES)      \
+  EVENT("L1d-read-misses", PERF_TYPE_HW_CACHE,                               \
+        PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |         \
+        PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+
+// Expansions of PERF_EVENTS into the names and the attributes
+#define PERF_EVENT_NAME(name, type, config) name,
+#define PERF_EVENT_ATTR(name, type, config) {type, config},
+
+#endif  // PERF_EVENTS_H_
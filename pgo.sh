@@ -0,0 +1,59 @@
+#!/usr/bin/env bash
+
+# Copyright [2024] <Copyright Hopsworks AB>
+#
+# Author: Zhao Song
+
+# Profile guided optimization of the interpreter and the preparer.
+#
+# Usage: ./pgo.sh [all|interpreter|preparer]
+#
+# Each part is built instrumented, trained on its workload and rebuilt with
+# the profile and link time optimization:
+# - The interpreter is trained on bench (see bench/bench.cc) and ends up in
+#   _pgo_build/.
+# - The preparer is trained on parser-and-compiler/test.sh and ends up in
+#   parser-and-compiler/libRestSQLPreparer.a.
+
+set -euo pipefail
+
+root="$(cd "$(dirname "$0")" && pwd)"
+what="${1:-all}"
+jobs="$(nproc)"
+
+interpreter()
+{
+    local build="$root/_pgo_build"
+    local profile="$build/pgo-profile"
+    rm -rf "$profile"
+    cmake -S "$root" -B "$build" -DCMAKE_BUILD_TYPE=Release \
+          -DAGG_PGO=GENERATE -DAGG_PGO_DIR="$profile" -DAGG_LTO=OFF
+    cmake --build "$build" --clean-first -j"$jobs"
+    # The training runs cover the interpreter and the JIT, small and large
+    # group counts, skew and NULLs.
+    "$build/bench" --rows 500000 --groups 1000 > /dev/null
+    "$build/bench" --rows 500000 --groups 100000 --skew 1.1 --nulls 0.05 \
+                   > /dev/null
+    "$build/bench" --rows 500000 --groups 1000 --jit > /dev/null
+    cmake -S "$root" -B "$build" -DAGG_PGO=USE -DAGG_LTO=ON
+    cmake --build "$build" --clean-first -j"$jobs"
+}
+
+preparer()
+{
+    local dir="$root/parser-and-compiler"
+    local profile="$dir/pgo-profile"
+    rm -rf "$profile"
+    make -C "$dir" clean
+    make -C "$dir" -j"$jobs" BUILD=release PGO=generate PGO_DIR="$profile"
+    (cd "$dir" && ./test.sh > /dev/null)
+    make -C "$dir" clean
+    make -C "$dir" -j"$jobs" BUILD=release PGO=use PGO_DIR="$profile" LTO=1
+}
+
+case "$what" in
+    all) interpreter; preparer;;
+    interpreter) interpreter;;
+    preparer) preparer;;
+    *) echo "Usage: $0 [all|interpreter|preparer]" >&2; exit 1;;
+esac
@@ -6,10 +6,27 @@
 #include <stdio.h>
 
 #include "record.h"
+#include "temporal.h"
+
+const ColumnType Record::cols_type_[Record::n_cols] = {
+  kTypeBigInt,
+  kTypeDouble,
+  kTypeBigInt,
+  kTypeDouble,
+  kTypeVarchar,
+  kTypeDatetime
+};
 
 void Record::Print() {
+  char buf[32];
   printf("------Record------\n");
-  for (int i = 0; i < n_cols; i++) {
+  for (uint32_t i = 0; i < n_cols; i++) {
+    if (cols_[i]->is_null()) {
+      printf("  column [%u], raw_length: %u, encoded_length: %u, "
+             "value: NULL\n", i,
+             cols_[i]->raw_length(), cols_[i]->encoded_length());
+      continue;
+    }
     switch (cols_type_[i]) {
       case kTypeBigInt:
         if (cols_[i]->is_unsigned()) {
@@ -35,6 +52,15 @@ void Record::Print() {
                "type: VARCHAR, value: %12s\n", i,
                cols_[i]->raw_length(), cols_[i]->encoded_length(),
                cols_[i]->data());
+        break;
+      case kTypeDatetime:
+        FormatTemporal(cols_[i]->type(),
+                       *reinterpret_cast<const int64_t* >(cols_[i]->data()),
+                       buf, sizeof(buf));
+        printf("  column [%u], raw_length: %u, encoded_length: %u, "
+               "type: DATETIME, value: %s\n", i,
+               cols_[i]->raw_length(), cols_[i]->encoded_length(), buf);
+        break;
       default:
         break;
     }
@@ -0,0 +1,60 @@
+/*
+ * Copyright [2024] <Copyright Hopsworks AB>
+ *
+ * Author: Zhao Song
+ */
+#include "shared_scan.h"
+
+#include <algorithm>
+
+bool SharedScan::Attach(AggInterpreter* agg) {
+  if (agg == nullptr || !agg->inited() || attached(agg)) {
+    return false;
+  }
+  aggs_.push_back(agg);
+  UpdateColMask();
+  return true;
+}
+
+bool SharedScan::Detach(AggInterpreter* agg) {
+  auto iter = std::find(aggs_.begin(), aggs_.end(), agg);
+  if (iter == aggs_.end()) {
+    return false;
+  }
+  aggs_.erase(iter);
+  UpdateColMask();
+  return true;
+}
+
+bool SharedScan::attached(const AggInterpreter* agg) const {
+  return std::find(aggs_.begin(), aggs_.end(), agg) != aggs_.end();
+}
+
+void SharedScan::UpdateColMask() {
+  col_mask_ = 0;
+  for (AggInterpreter* agg : aggs_) {
+    col_mask_ |= agg->col_mask();
+  }
+}
+
+bool SharedScan::ProcessRecs(Record* const* recs, uint32_t n_recs) {
+  bool ok = true;
+  uint32_t done = 0;
+  while (done < n_recs) {
+    uint32_t n = batch_->Load(recs + done, n_recs - done, col_mask_);
+    for (uint32_t i = 0; i < aggs_.size();) {
+      if (aggs_[i]->ProcessBatch(*batch_)) {
+        i++;
+      } else {
+        aggs_.erase(aggs_.begin() + i);
+        ok = false;
+      }
+    }
+    if (!ok) {
+      UpdateColMask();
+    }
+    done += n;
+  }
+  rows_scanned_ += n_recs;
+  return ok;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright [2024] <Copyright Hopsworks AB>
+ *
+ * Author: Zhao Song
+ */
+#ifndef SHARED_SCAN_H_
+#define SHARED_SCAN_H_
+
+#include <vector>
+
+#include "column_batch.h"
+#include "interpreter.h"
+
+/*
+ * Feeds one stream of records to several interpreters, e.g. the aggregates
+ * of a dashboard over the same table. Each batch of records is loaded once
+ * into a ColumnBatch, with the union of the columns that the attached
+ * interpreters read, and then every attached interpreter processes it.
+ *
+ * Interpreters can be attached and detached between calls to
+ * ProcessRecs(). An interpreter sees the records from the time it is
+ * attached until it is detached, so one attached mid-scan has only
+ * aggregated the rows from rows_scanned() at the time of Attach().
+ */
+class SharedScan {
+ public:
+  SharedScan() : col_mask_(0), rows_scanned_(0), batch_(new ColumnBatch) {}
+  ~SharedScan() {
+    delete batch_;
+  }
+
+  /*
+   * Attach an interpreter for which Init() has succeeded. Return false if
+   * it is not initialized or is already attached.
+   */
+  bool Attach(AggInterpreter* agg);
+  bool Detach(AggInterpreter* agg);
+  bool attached(const AggInterpreter* agg) const;
+  uint32_t n_attached() const {
+    return aggs_.size();
+  }
+
+  /*
+   * Process the records with every attached interpreter. If an interpreter
+   * fails, e.g. because it can't spill, it is detached and the others go
+   * on, and false is returned.
+   */
+  bool ProcessRecs(Record* const* recs, uint32_t n_recs);
+
+  uint64_t rows_scanned() const {
+    return rows_scanned_;
+  }
+
+ private:
+  std::vector<AggInterpreter*> aggs_;
+  uint32_t col_mask_;  // Union of the column masks of aggs_
+  uint64_t rows_scanned_;
+  ColumnBatch* batch_;
+
+  void UpdateColMask();
+};
+
+#endif  // SHARED_SCAN_H_
@@ -0,0 +1,59 @@
+/*
+ * Copyright [2024] <Copyright Hopsworks AB>
+ *
+ * Author: Zhao Song
+ */
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <time.h>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ * Read the CPU's time stamp counter, or a nanosecond clock on platforms
+ * without one. Only differences between two readings are meaningful.
+ */
+static inline uint64_t ReadCycleCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/*
+ * Execution statistics of an AggInterpreter, collected when enabled with
+ * set_collect_stats(). The group map is an ordered map, so instead of
+ * hash collisions it counts the key comparisons made by the lookups, as
+ * well as those of the radix partition tables, made on equal hashes.
+ */
+struct AggStats {
+  uint64_t rows;
+  uint64_t group_probes;      // Lookups of the group of a row
+  uint64_t group_inserts;     // Lookups that created a new group
+  uint64_t key_compares;      // Key comparisons made by the lookups
+  uint64_t spills;            // Group maps spilled and spill files split
+  uint64_t tuple_merges;      // Tuple buffers merged into their partition
+  uint64_t tuple_hits;        // Rows aggregated into a tuple already buffered
+  uint64_t partition_splits;  // Radix partitions split into twice as many
+  uint64_t peak_state_bytes;  // Largest size of the in-memory groups
+  uint64_t group_cycles;      // Building the key and looking up the group
+  uint64_t program_cycles;    // Executing the instructions
+  // Per decoded instruction, in program order
+  std::vector<uint64_t> instr_count;
+  std::vector<uint64_t> instr_cycles;
+
+  AggStats() : rows(0), group_probes(0), group_inserts(0), key_compares(0),
+               spills(0), tuple_merges(0), tuple_hits(0),
+               partition_splits(0), peak_state_bytes(0),
+               group_cycles(0), program_cycles(0) {}
+};
+
+#endif  // STATS_H_
@@ -0,0 +1,186 @@
+/*
+ * Copyright [2024] <Copyright Hopsworks AB>
+ *
+ * Author: Zhao Song
+ */
+#include <assert.h>
+#include <stdio.h>
+
+#include "temporal.h"
+
+static const int64_t kMicrosPerSecond = 1000000LL;
+static const int64_t kMicrosPerMinute = 60 * kMicrosPerSecond;
+static const int64_t kMicrosPerHour = 60 * kMicrosPerMinute;
+static const int64_t kMicrosPerDay = 24 * kMicrosPerHour;
+
+// Bit positions in the packed DATETIME format
+static const int kSecondShift = 24;
+static const int kMinuteShift = 30;
+static const int kHourShift = 36;
+static const int kDayShift = 41;
+
+bool IsTemporalType(int32_t type) {
+  return type == kTypeDate || type == kTypeDatetime ||
+         type == kTypeTimestamp;
+}
+
+const char* TemporalUnitName(TemporalUnit unit) {
+  static const char* names[kUnitTotal] = {
+    "NONE", "YEAR", "QUARTER", "MONTH", "DAY", "HOUR", "MINUTE", "SECOND"
+  };
+  assert(unit < kUnitTotal);
+  return names[unit];
+}
+
+int64_t PackDatetime(const DatetimeParts& parts) {
+  int64_t ymd = ((static_cast<int64_t>(parts.year) * 13 + parts.month) << 5) |
+                parts.day;
+  int64_t hms = (parts.hour << 12) | (parts.minute << 6) | parts.second;
+  return (((ymd << 17) | hms) << 24) + parts.microsecond;
+}
+
+void UnpackDatetime(int64_t packed, DatetimeParts* parts) {
+  parts->microsecond = packed & 0xFFFFFF;
+  int64_t ymdhms = packed >> 24;
+  int64_t ymd = ymdhms >> 17;
+  int64_t hms = ymdhms & 0x1FFFF;
+  parts->day = ymd & 0x1F;
+  parts->month = (ymd >> 5) % 13;
+  parts->year = (ymd >> 5) / 13;
+  parts->second = hms & 0x3F;
+  parts->minute = (hms >> 6) & 0x3F;
+  parts->hour = hms >> 12;
+}
+
+/*
+ * Days since 1970-01-01 of a date in the proleptic Gregorian calendar, and
+ * the inverse. See http://howardhinnant.github.io/date_algorithms.html
+ */
+static int64_t DaysFromCivil(int64_t y, uint32_t m, uint32_t d) {
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const uint32_t yoe = static_cast<uint32_t>(y - era * 400);
+  const uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+static void CivilFromDays(int64_t z, DatetimeParts* parts) {
+  z += 719468;
+  const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  const uint32_t doe = static_cast<uint32_t>(z - era * 146097);
+  const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const uint32_t mp = (5 * doy + 2) / 153;
+  parts->day = doy - (153 * mp + 2) / 5 + 1;
+  parts->month = mp < 10 ? mp + 3 : mp - 9;
+  parts->year = static_cast<uint32_t>(yoe + era * 400 + (parts->month <= 2));
+}
+
+static int64_t FloorDiv(int64_t a, int64_t b) {
+  int64_t q = a / b;
+  return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+int64_t PackTimestamp(const DatetimeParts& parts) {
+  int64_t days = DaysFromCivil(parts.year, parts.month, parts.day);
+  return days * kMicrosPerDay + parts.hour * kMicrosPerHour +
+         parts.minute * kMicrosPerMinute + parts.second * kMicrosPerSecond +
+         parts.microsecond;
+}
+
+void UnpackTimestamp(int64_t timestamp, DatetimeParts* parts) {
+  int64_t days = FloorDiv(timestamp, kMicrosPerDay);
+  int64_t micros = timestamp - days * kMicrosPerDay;
+  CivilFromDays(days, parts);
+  parts->hour = micros / kMicrosPerHour;
+  parts->minute = micros / kMicrosPerMinute % 60;
+  parts->second = micros / kMicrosPerSecond % 60;
+  parts->microsecond = micros % kMicrosPerSecond;
+}
+
+/*
+ * Truncate to the start of the year, quarter or month by rebuilding the
+ * value from its parts.
+ */
+static void TruncateParts(TemporalUnit unit, DatetimeParts* parts) {
+  switch (unit) {
+    case kUnitYear:
+      parts->month = 1;
+      break;
+    case kUnitQuarter:
+      parts->month = (parts->month - 1) / 3 * 3 + 1;
+      break;
+    case kUnitMonth:
+      break;
+    default:
+      assert(0);
+  }
+  parts->day = 1;
+  parts->hour = 0;
+  parts->minute = 0;
+  parts->second = 0;
+  parts->microsecond = 0;
+}
+
+int64_t TruncateTemporal(int32_t type, int64_t value, TemporalUnit unit) {
+  assert(IsTemporalType(type));
+  if (unit == kUnitNone) {
+    return value;
+  }
+  DatetimeParts parts;
+  if (type == kTypeTimestamp) {
+    switch (unit) {
+      case kUnitSecond:
+        return FloorDiv(value, kMicrosPerSecond) * kMicrosPerSecond;
+      case kUnitMinute:
+        return FloorDiv(value, kMicrosPerMinute) * kMicrosPerMinute;
+      case kUnitHour:
+        return FloorDiv(value, kMicrosPerHour) * kMicrosPerHour;
+      case kUnitDay:
+        return FloorDiv(value, kMicrosPerDay) * kMicrosPerDay;
+      default:
+        UnpackTimestamp(value, &parts);
+        TruncateParts(unit, &parts);
+        return PackTimestamp(parts);
+    }
+  }
+  // The fields of the packed DATETIME format are bit fields, so truncating
+  // to a time unit or to the day is a mask.
+  switch (unit) {
+    case kUnitSecond:
+      return value & ~((1LL << kSecondShift) - 1);
+    case kUnitMinute:
+      return value & ~((1LL << kMinuteShift) - 1);
+    case kUnitHour:
+      return value & ~((1LL << kHourShift) - 1);
+    case kUnitDay:
+      return value & ~((1LL << kDayShift) - 1);
+    default:
+      UnpackDatetime(value, &parts);
+      TruncateParts(unit, &parts);
+      return PackDatetime(parts);
+  }
+}
+
+int FormatTemporal(int32_t type, int64_t value, char* buf, size_t size) {
+  assert(IsTemporalType(type));
+  DatetimeParts parts;
+  if (type == kTypeTimestamp) {
+    UnpackTimestamp(value, &parts);
+  } else {
+    UnpackDatetime(value, &parts);
+  }
+  if (type == kTypeDate) {
+    return snprintf(buf, size, "%04u-%02u-%02u",
+                    parts.year, parts.month, parts.day);
+  }
+  if (parts.microsecond == 0) {
+    return snprintf(buf, size, "%04u-%02u-%02u %02u:%02u:%02u",
+                    parts.year, parts.month, parts.day,
+                    parts.hour, parts.minute, parts.second);
+  }
+  return snprintf(buf, size, "%04u-%02u-%02u %02u:%02u:%02u.%06u",
+                  parts.year, parts.month, parts.day,
+                  parts.hour, parts.minute, parts.second, parts.microsecond);
+}
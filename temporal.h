@@ -0,0 +1,72 @@
+/*
+ * Copyright [2024] <Copyright Hopsworks AB>
+ *
+ * Author: Zhao Song
+ */
+#ifndef TEMPORAL_H_
+#define TEMPORAL_H_
+
+#include <stddef.h>
+#include <cstdint>
+
+#include "column.h"
+
+/*
+ * Temporal columns are stored as order-preserving int64 values, so that
+ * comparisons, MIN/MAX and grouping work on them as on integers:
+ *
+ * - DATE and DATETIME use MySQL's packed DATETIME format
+ *     ((((year * 13 + month) << 5 | day) << 17 |
+ *       hour << 12 | minute << 6 | second) << 24) + microsecond
+ *   where a DATE is a DATETIME at midnight. Values of the two types can
+ *   therefore be compared with each other directly.
+ * - TIMESTAMP is the number of microseconds since 1970-01-01 00:00:00 UTC.
+ */
+
+/*
+ * Unit that a temporal group by column is truncated to, e.g. kUnitDay groups
+ * by date and kUnitHour by hour.
+ */
+enum TemporalUnit {
+  kUnitNone = 0,
+  kUnitYear,
+  kUnitQuarter,
+  kUnitMonth,
+  kUnitDay,
+  kUnitHour,
+  kUnitMinute,
+  kUnitSecond,
+  kUnitTotal
+};
+
+struct DatetimeParts {
+  uint32_t year;
+  uint32_t month;
+  uint32_t day;
+  uint32_t hour;
+  uint32_t minute;
+  uint32_t second;
+  uint32_t microsecond;
+};
+
+bool IsTemporalType(int32_t type);
+const char* TemporalUnitName(TemporalUnit unit);
+
+int64_t PackDatetime(const DatetimeParts& parts);
+void UnpackDatetime(int64_t packed, DatetimeParts* parts);
+int64_t PackTimestamp(const DatetimeParts& parts);
+void UnpackTimestamp(int64_t timestamp, DatetimeParts* parts);
+
+/*
+ * Truncate a packed value of the given temporal type to the start of its
+ * year, quarter, month, day, hour, minute or second.
+ */
+int64_t TruncateTemporal(int32_t type, int64_t value, TemporalUnit unit);
+
+/*
+ * Format as YYYY-MM-DD for DATE, and as YYYY-MM-DD hh:mm:ss[.ffffff] for
+ * DATETIME and TIMESTAMP (in UTC). Return the length as snprintf does.
+ */
+int FormatTemporal(int32_t type, int64_t value, char* buf, size_t size);
+
+#endif  // TEMPORAL_H_
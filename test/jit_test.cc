@@ -0,0 +1,314 @@
+/*
+ * Copyright [2024] <Copyright Hopsworks AB>
+ *
+ * Author: Zhao Song
+ */
+/*
+ * Differential test of the JIT against the interpreter.
+ *
+ * Random programs over the table of record.h run over the same random
+ * records with and without the JIT, and the test fails unless the JIT
+ * compiled every program and both ended with exactly the same aggregation
+ * state. A failing program is printed with its seed:
+ *
+ *   jit_test [--seed N] [--programs N] [--rows N]
+ *
+ * Since an overflow asserts in the interpreter as well as in the JIT, the
+ * programs only combine values in ways that cannot overflow with the
+ * generated data. Everything else is fair game, including the NULLs,
+ * unsigned values, divisions by zero and mixed types that leave the
+ * inline code of the JIT for the kernels.
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+#include "../interpreter.h"
+#include "../temporal.h"
+
+/*
+ * What a register holds as far as overflows go. The unsigned flag of a
+ * BIGINT decides which combinations the kernels reject, and e.g. x % 0 is
+ * an unsigned 0 when x >= 0, so the result of % may have either flag.
+ */
+enum ValueKind {
+  kSigned,
+  kUnsigned,
+  kMaybeUnsigned,
+  kReal,
+  kTemporal
+};
+
+class ProgramGen {
+ public:
+  explicit ProgramGen(uint64_t seed) : rng_(seed) {}
+
+  std::vector<uint32_t> Generate();
+
+ private:
+  std::mt19937_64 rng_;
+  std::vector<uint32_t> instrs_;
+  std::vector<DataType> agg_types_;
+
+  uint32_t Uniform(uint32_t n) {
+    return rng_() % n;
+  }
+  void Emit(uint8_t op, uint8_t raw_type, uint32_t reg, uint32_t index) {
+    instrs_.push_back(static_cast<uint32_t>(op) << 26 |
+                      static_cast<uint32_t>(raw_type) << 21 |
+                      reg << 16 | index);
+  }
+  void EmitOp(uint8_t op, uint32_t reg1, uint32_t reg2) {
+    instrs_.push_back(static_cast<uint32_t>(op) << 26 | reg1 << 12 |
+                      reg2 << 8);
+  }
+  void EmitConst(uint32_t reg, DataType type, uint64_t value) {
+    Emit(kOpLoadConst, type, reg, 0);
+    instrs_.push_back(static_cast<uint32_t>(value));
+    instrs_.push_back(static_cast<uint32_t>(value >> 32));
+  }
+  ValueKind Leaf(uint32_t reg);
+  ValueKind Expr(uint32_t depth, uint32_t reg);
+  ValueKind TemporalExpr(uint32_t reg);
+  bool Aggregate(ValueKind kind, uint32_t reg);
+};
+
+static DataType TypeOf(ValueKind kind) {
+  return kind == kReal ? kTypeDouble :
+         kind == kTemporal ? kTypeDatetime : kTypeBigInt;
+}
+
+static int64_t RandomDatetime(std::mt19937_64* rng) {
+  DatetimeParts parts{2024, 3, static_cast<uint32_t>(1 + (*rng)() % 3),
+                      static_cast<uint32_t>((*rng)() % 24),
+                      static_cast<uint32_t>((*rng)() % 60), 0, 0};
+  return PackDatetime(parts);
+}
+
+ValueKind ProgramGen::Leaf(uint32_t reg) {
+  switch (Uniform(6)) {
+    case 0:
+      Emit(kOpLoadCol, kTypeBigInt, reg, 0);
+      return kSigned;
+    case 1:
+      Emit(kOpLoadCol, kTypeDouble, reg, 1);
+      return kReal;
+    case 2:
+      Emit(kOpLoadCol, 0x10 | kTypeBigInt, reg, 2);
+      return kUnsigned;
+    case 3:
+      Emit(kOpLoadCol, kTypeDouble, reg, 3);
+      return kReal;
+    case 4: {
+      static const int64_t kSpecial[] = {0, 1, -1};
+      int64_t value = Uniform(4) == 0 ? kSpecial[Uniform(3)] :
+                      static_cast<int64_t>(Uniform(2001)) - 1000;
+      EmitConst(reg, kTypeBigInt, static_cast<uint64_t>(value));
+      return kSigned;
+    }
+    default: {
+      double value = Uniform(4) == 0 ? 0.0 :
+                     (static_cast<int32_t>(Uniform(20001)) - 10000) / 100.0;
+      uint64_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      EmitConst(reg, kTypeDouble, bits);
+      return kReal;
+    }
+  }
+}
+
+/*
+ * Compute a random expression of at most depth levels of ops into reg,
+ * using the registers after it for the operands. With at most four leaves
+ * of at most 1000 a BIGINT stays far from overflowing.
+ */
+ValueKind ProgramGen::Expr(uint32_t depth, uint32_t reg) {
+  if (depth == 0 || Uniform(3) == 0) {
+    return Leaf(reg);
+  }
+  ValueKind a = Expr(depth - 1, reg);
+  ValueKind b = Expr(depth - 1, reg + 1);
+  uint8_t op = kOpPlus + Uniform(5);
+  ValueKind res;
+  if (a == kReal || b == kReal) {
+    res = kReal;
+  } else if (a == kSigned && b == kSigned) {
+    res = op == kOpMod ? kMaybeUnsigned : kSigned;
+  } else if (a == kUnsigned && b == kUnsigned && op == kOpPlus) {
+    res = kSigned;
+  } else {
+    op = kOpTotal;
+  }
+  if (op == kOpTotal || Uniform(4) == 0) {
+    op = kOpEq + Uniform(6);
+    res = kSigned;
+  }
+  EmitOp(op, reg, reg + 1);
+  return res;
+}
+
+// A DATETIME column or constant, or a comparison of the column with one
+ValueKind ProgramGen::TemporalExpr(uint32_t reg) {
+  if (Uniform(2) == 0) {
+    Emit(kOpLoadCol, kTypeDatetime, reg, 5);
+    return kTemporal;
+  }
+  if (Uniform(3) == 0) {
+    EmitConst(reg, kTypeDatetime, RandomDatetime(&rng_));
+    return kTemporal;
+  }
+  Emit(kOpLoadCol, kTypeDatetime, reg, 5);
+  EmitConst(reg + 1, Uniform(2) ? kTypeDate : kTypeDatetime,
+            RandomDatetime(&rng_));
+  EmitOp(kOpEq + Uniform(6), reg, reg + 1);
+  return kSigned;
+}
+
+/*
+ * Aggregate reg into a new aggregation result. Return false if the kind of
+ * aggregation that was picked cannot take the value.
+ */
+bool ProgramGen::Aggregate(ValueKind kind, uint32_t reg) {
+  uint8_t op = kOpSum + Uniform(4);
+  DataType type = TypeOf(kind);
+  if (op == kOpCount) {
+    type = kTypeBigInt;
+  } else if (op == kOpSum) {
+    if (kind == kMaybeUnsigned || kind == kTemporal) {
+      return false;
+    }
+    if (Uniform(4) == 0) {
+      type = kTypeDouble;
+    }
+  }
+  Emit(op, type, reg, agg_types_.size());
+  agg_types_.push_back(type);
+  return true;
+}
+
+std::vector<uint32_t> ProgramGen::Generate() {
+  static const uint32_t kGroupBy[] = {0, 2, kUnitDay << 16 | 5,
+                                      kUnitHour << 16 | 5, 4};
+  instrs_.clear();
+  agg_types_.clear();
+
+  uint32_t n_gb_cols = Uniform(2);
+  uint32_t gb_col = kGroupBy[Uniform(5)];
+  uint32_t n_aggs = 1 + Uniform(6);
+  while (agg_types_.size() < n_aggs) {
+    uint32_t reg = Uniform(kRegTotal - 3);
+    ValueKind kind = Uniform(5) == 0 ? TemporalExpr(reg) : Expr(2, reg);
+    // Up to two aggregations of the same value
+    uint32_t n = 1 + Uniform(2);
+    for (uint32_t i = 0; i < n && agg_types_.size() < n_aggs; i++) {
+      while (!Aggregate(kind, reg)) {
+      }
+    }
+  }
+
+  std::vector<uint32_t> prog;
+  uint32_t len = 2 + n_gb_cols + n_aggs + instrs_.size();
+  prog.push_back(0x0721 << 16 | len);
+  prog.push_back(n_gb_cols << 16 | n_aggs);
+  if (n_gb_cols) {
+    prog.push_back(gb_col);
+  }
+  prog.insert(prog.end(), agg_types_.begin(), agg_types_.end());
+  prog.insert(prog.end(), instrs_.begin(), instrs_.end());
+  return prog;
+}
+
+static const char* g_chars =
+  "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz";
+
+/*
+ * Run prog over n_rows records of the given seed with and without the JIT.
+ * Return false and print the program if the JIT did not compile it or the
+ * results differ.
+ */
+static bool CheckProgram(const std::vector<uint32_t>& prog, uint64_t seed,
+                         uint32_t n_rows) {
+  AggInterpreter interpreted(prog.data(), prog.size());
+  AggInterpreter compiled(prog.data(), prog.size());
+  compiled.set_use_jit(true);
+  if (!interpreted.Init() || !compiled.Init()) {
+    printf("Init failed: %s\n", interpreted.init_error());
+    return false;
+  }
+
+  std::mt19937_64 rng(seed);
+  for (uint32_t i = 0; i < n_rows; i++) {
+    int64_t a = rng() % 10 == 0 ? 0 : static_cast<int64_t>(rng() % 2001) - 1000;
+    double b = rng() % 10 == 0 ? 0.0 :
+               (static_cast<int64_t>(rng() % 2001) - 1000) / 100.0;
+    uint64_t c = rng() % 10 == 0 ? 0 : rng() % 1000;
+    double d = rng() % 10 == 0 ? 0.0 :
+               (static_cast<int64_t>(rng() % 2001) - 1000) / 100.0;
+    uint32_t null_bits = 0;
+    for (uint32_t col = 0; col < Record::n_cols; col++) {
+      if (rng() % 10 == 0) {
+        null_bits |= 1 << col;
+      }
+    }
+    Record rec(a, b, c, d, g_chars + rng() % 40, 12, RandomDatetime(&rng),
+               null_bits);
+    interpreted.ProcessRec(&rec);
+    compiled.ProcessRec(&rec);
+  }
+
+  if (compiled.jit_compiled() && interpreted.SameResults(compiled)) {
+    return true;
+  }
+  printf("Seed %llu: %s\n", static_cast<unsigned long long>(seed),
+         compiled.jit_compiled() ? "results DIFFER from the interpreter" :
+                                   "JIT not supported");
+  for (uint32_t i = 0; i < prog.size(); i++) {
+    printf("  0x%08x\n", prog[i]);
+  }
+  return false;
+}
+
+int main(int argc, char** argv) {
+  uint64_t seed = 1;
+  uint32_t n_programs = 1000;
+  uint32_t n_rows = 200;
+
+  static const struct option kOptions[] = {
+    {"seed", required_argument, nullptr, 's'},
+    {"programs", required_argument, nullptr, 'p'},
+    {"rows", required_argument, nullptr, 'r'},
+    {nullptr, 0, nullptr, 0}
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "", kOptions, nullptr)) != -1) {
+    switch (opt) {
+      case 's':
+        seed = strtoull(optarg, nullptr, 10);
+        break;
+      case 'p':
+        n_programs = strtoul(optarg, nullptr, 10);
+        break;
+      case 'r':
+        n_rows = strtoul(optarg, nullptr, 10);
+        break;
+      default:
+        fprintf(stderr,
+                "Usage: %s [--seed N] [--programs N] [--rows N]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  uint32_t n_failed = 0;
+  for (uint32_t i = 0; i < n_programs; i++) {
+    ProgramGen gen(seed + i);
+    if (!CheckProgram(gen.Generate(), seed + i, n_rows)) {
+      n_failed++;
+    }
+  }
+  printf("JIT differential test: %u programs, %u rows each, %u failed\n",
+         n_programs, n_rows, n_failed);
+  return n_failed ? 1 : 0;
+}